@@ -6,6 +6,7 @@
 
 #include "bricks/core/copypointer.h"
 #include "bricks/collections/array.h"
+#include "bricks/collections/smallarray.h"
 
 namespace Bricks { namespace IO { class Stream; } }
 
@@ -31,7 +32,7 @@ namespace Bricks { namespace Audio {
 		s64 currentTime;
 
 		Bricks::Collections::Array<AVPacket> packetQueue;
-		Bricks::Collections::Array<int> openStreams;
+		Bricks::Collections::SmallArray<int, 4> openStreams;
 
 	public:
 		FFmpegDecoder(IO::Stream* stream);
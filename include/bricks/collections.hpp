@@ -6,9 +6,13 @@
 #include "bricks/collections/list.h"
 
 #include "bricks/collections/array.h"
+#include "bricks/collections/smallarray.h"
+#include "bricks/collections/soaarray.h"
 #include "bricks/collections/dictionary.h"
+#include "bricks/collections/cache.h"
 #include "bricks/collections/stack.h"
 #include "bricks/collections/queue.h"
+#include "bricks/collections/priorityqueue.h"
 #include "bricks/collections/autoarray.h"
 
 #include "bricks/collections/listguard.h"
@@ -8,6 +8,7 @@
 
 #include "bricks/collections/list.h"
 #include "bricks/collections/comparison.h"
+#include "bricks/collections/radixsort_internal.h"
 
 #include <vector>
 #include <algorithm>
@@ -44,12 +45,6 @@ namespace Bricks { namespace Collections {
 
 		friend class Internal::ArrayIterator<T>;
 
-		struct StlCompare {
-			AutoPointer<ValueComparison<T> > comparison;
-			StlCompare(ValueComparison<T>* comparison) : comparison(comparison) { }
-			bool operator ()(T v1, T v2) const { return comparison->Compare(v1, v2) == ComparisonResult::Less; }
-		};
-
 		iterator IteratorOfItem(const T& value) {
 			for (iterator iter = vector.begin(); iter != vector.end(); iter++) {
 				if (!comparison->Compare(*iter, value))
@@ -74,14 +69,28 @@ namespace Bricks { namespace Collections {
 		// Iterator
 		virtual ReturnPointer<Iterator<T> > GetIterator() const { return autonew Internal::ArrayIterator<T>(const_cast<Array<T>&>(*this)); }
 		Internal::ArrayIterator<T> GetIteratorFast() const { return Internal::ArrayIterator<T>(const_cast<Array<T>&>(*this)); }
+		virtual const T* GetContiguousItems(long& count) const { count = vector.size(); return GetData(); }
 
 		// Collection
 		virtual long GetCount() const { return vector.size(); }
 
 		virtual bool ContainsItem(const T& value) const { return IteratorOfItem(value) != vector.end(); }
 
+		virtual void Reserve(long size) { vector.reserve(size); }
+		virtual long GetCapacity() const { return vector.capacity(); }
+		virtual void ShrinkToFit() { std::vector<T>(vector).swap(vector); }
+
 		virtual void AddItem(const T& value) { vector.push_back(value); }
-		virtual void AddItems(Iterable<T>* values) { BRICKS_FOR_EACH (const T& item, values) AddItem(item); }
+		virtual void AddRange(const T* values, long count) { Array<T>::InsertRange(vector.size(), values, count); }
+		virtual void AddItems(Iterable<T>* values)
+		{
+			long count;
+			const T* items = values->GetContiguousItems(count);
+			if (items)
+				AddRange(items, count);
+			else
+				BRICKS_FOR_EACH (const T& item, values) AddItem(item);
+		}
 		virtual bool RemoveItem(const T& value)
 		{
 			iterator iter = IteratorOfItem(value);
@@ -105,16 +114,44 @@ namespace Bricks { namespace Collections {
 		}
 
 		virtual void InsertItem(long index, const T& value) { vector.insert(vector.begin() + index, value); }
+		virtual void InsertRange(long index, const T* values, long count)
+		{
+			// Growing would invalidate a range that lies inside this array, so such a range is copied out first.
+			if (!vector.empty() && values >= &vector[0] && values < &vector[0] + vector.size()) {
+				std::vector<T> copy(values, values + count);
+				vector.insert(vector.begin() + index, copy.begin(), copy.end());
+			} else
+				vector.insert(vector.begin() + index, values, values + count);
+		}
 		virtual void RemoveItemAt(long index) { vector.erase(vector.begin() + index); }
 
+		ValueComparison<T>* GetComparison() const { return comparison; }
+
+		T* GetData() { return vector.empty() ? NULL : &vector[0]; }
+		const T* GetData() const { return vector.empty() ? NULL : &vector[0]; }
+
 		virtual void Sort(ValueComparison<T>* sortComparison = NULL)
 		{
-			std::sort(vector.begin(), vector.end(), StlCompare(sortComparison ?: comparison.GetValue()));
+			ValueComparison<T>* sortWith = sortComparison ?: comparison.GetValue();
+			if (Internal::IsOperatorComparison(sortWith))
+				std::sort(vector.begin(), vector.end(), Internal::OperatorLess<T>());
+			else
+				std::sort(vector.begin(), vector.end(), Internal::ComparisonLess<T>(sortWith));
 		}
 
 		virtual void StableSort(ValueComparison<T>* sortComparison = NULL)
 		{
-			std::stable_sort(vector.begin(), vector.end(), StlCompare(sortComparison ?: comparison.GetValue()));
+			ValueComparison<T>* sortWith = sortComparison ?: comparison.GetValue();
+			if (Internal::IsOperatorComparison(sortWith))
+				std::stable_sort(vector.begin(), vector.end(), Internal::OperatorLess<T>());
+			else
+				std::stable_sort(vector.begin(), vector.end(), Internal::ComparisonLess<T>(sortWith));
 		}
+
+		// Stable LSD radix sort on the element's bit pattern; floats order as numbers, and strings order bytewise.
+		void RadixSort() { Internal::RadixValueSorter<T>::Sort(GetData(), GetCount(), Internal::RadixRangeSorter()); }
+		// Sorts stably by an extracted integer, floating point or string key, evaluated once per element.
+		template<typename TKey> void RadixSort(TKey (*key)(const T&)) { Internal::RadixSortKeys<TKey>(GetData(), GetCount(), key, Internal::RadixRangeSorter()); }
+		template<typename F> void RadixSort(const F& key, typename F::KeyType* = NULL) { Internal::RadixSortKeys<typename F::KeyType>(GetData(), GetCount(), key, Internal::RadixRangeSorter()); }
 	};
 } }
@@ -22,6 +22,7 @@ namespace Bricks { namespace Collections {
 		AutoArray& operator =(const AutoArray<T>& array) { Array<T*> toRelease(*this); Array<T*>::operator=(array); RetainAll(); BRICKS_FOR_EACH (T*const& item, toRelease) Release(item); return *this; }
 
 		void AddItem(T*const& value) { Array<T*>::AddItem(value); Retain(value); }
+		void AddRange(T*const* values, long count) { for (long i = 0; i < count; i++) Retain(values[i]); Array<T*>::AddRange(values, count); }
 		bool RemoveItem(T*const& value) { long index = Array<T*>::IndexOfItem(value); if (index >= 0) { T* item = Array<T*>::GetItem(index); Array<T*>::RemoveItemAt(index); Release(item); return true; } return false; }
 		void RemoveItems(T*const& value) { Retain(value); while (RemoveItem(value)) ; Release(value); }
 
@@ -30,6 +31,7 @@ namespace Bricks { namespace Collections {
 		void SetItem(long index, T*const& value) { T* item = Array<T*>::GetItem(index);Array<T*>::SetItem(index, value); Release(item); Retain(value); }
 
 		void InsertItem(long index, T*const& value) { Array<T*>::InsertItem(index, value); Retain(value); }
+		void InsertRange(long index, T*const* values, long count) { for (long i = 0; i < count; i++) Retain(values[i]); Array<T*>::InsertRange(index, values, count); }
 		void RemoveItemAt(long index) { T* item = Array<T*>::GetItem(index); Array<T*>::RemoveItemAt(index); Release(item); }
 	};
 } }
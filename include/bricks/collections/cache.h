@@ -0,0 +1,271 @@
+#pragma once
+
+#include "bricks/config.h"
+
+#if !BRICKS_CONFIG_STL
+#error libbricks must be configured to use the STL
+#endif
+
+#include "bricks/core/object.h"
+#include "bricks/core/copypointer.h"
+#include "bricks/core/delegate.h"
+#include "bricks/core/string.h"
+#include "bricks/collections/comparison.h"
+
+#include <map>
+#include <list>
+#include <vector>
+#include <string.h>
+
+namespace Bricks { namespace Collections {
+	namespace CachePolicy {
+		enum Enum {
+			// Evicts the least recently used item.
+			LeastRecentlyUsed = 0,
+			// LRU eviction, but a new item only displaces the eviction candidate if it has been requested more often recently (TinyLFU admission).
+			FrequencyAdmission
+		};
+	}
+
+	struct CacheStatistics
+	{
+		u64 hits;
+		u64 misses;
+		u64 evictions;
+		u64 rejections;
+
+		CacheStatistics() : hits(0), misses(0), evictions(0), rejections(0) { }
+
+		CacheStatistics& operator +=(const CacheStatistics& statistics) { hits += statistics.hits; misses += statistics.misses; evictions += statistics.evictions; rejections += statistics.rejections; return *this; }
+	};
+
+	namespace Internal {
+		// FNV-1a over the key's bytes; keys that own out-of-line data need a specialization.
+		template<typename T>
+		struct CacheHash
+		{
+			u32 operator ()(const T& value) const
+			{
+				u8 bytes[sizeof(T)];
+				memcpy(bytes, &value, sizeof(T));
+				u32 hash = 2166136261u;
+				for (size_t i = 0; i < sizeof(T); i++)
+					hash = (hash ^ bytes[i]) * 16777619u;
+				return hash;
+			}
+		};
+
+		template<>
+		struct CacheHash<String>
+		{
+			u32 operator ()(const String& value) const
+			{
+				const u8* data = (const u8*)value.CString();
+				u32 hash = 2166136261u;
+				for (size_t i = 0; i < value.GetSize(); i++)
+					hash = (hash ^ data[i]) * 16777619u;
+				return hash;
+			}
+		};
+
+		// Count-min sketch of recent request frequencies: four rows of saturating 4-bit counts, halved periodically so old popularity fades.
+		class CacheFrequencySketch
+		{
+		protected:
+			static const int Rows = 4;
+			static const u8 MaximumCount = 15;
+
+			std::vector<u8> counts;
+			u32 mask;
+			long additions;
+			long sampleSize;
+
+			static u32 Mix(u32 hash, int row) { hash = (hash ^ (hash >> 16)) * (0x45d9f3bu + row * 0x9e3779b8u); return hash ^ (hash >> 13); }
+			u8& Count(u32 hash, int row) { return counts[row * (mask + 1) + (Mix(hash, row) & mask)]; }
+
+		public:
+			CacheFrequencySketch() : mask(0), additions(0), sampleSize(0) { Resize(64); }
+
+			void Resize(long size)
+			{
+				u32 width = 64;
+				while ((long)width < size)
+					width <<= 1;
+				if (width == mask + 1)
+					return;
+				mask = width - 1;
+				counts.assign(Rows * width, 0);
+				sampleSize = width * 10;
+				additions = 0;
+			}
+
+			long GetWidth() const { return mask + 1; }
+
+			void Increment(u32 hash)
+			{
+				for (int row = 0; row < Rows; row++) {
+					u8& count = Count(hash, row);
+					if (count < MaximumCount)
+						count++;
+				}
+				if (++additions >= sampleSize) {
+					for (size_t i = 0; i < counts.size(); i++)
+						counts[i] >>= 1;
+					additions /= 2;
+				}
+			}
+
+			u8 Estimate(u32 hash)
+			{
+				u8 estimate = MaximumCount;
+				for (int row = 0; row < Rows; row++) {
+					u8 count = Count(hash, row);
+					if (count < estimate)
+						estimate = count;
+				}
+				return estimate;
+			}
+		};
+	}
+
+	// A bounded key/value cache. Each item's cost comes from the cost delegate (1 per item if none is set), and items are evicted
+	// once the total exceeds the budget. The eviction delegate is called for every item the cache drops to make room.
+	// Not thread-safe; see Threading::ConcurrentCache.
+	template<typename TKey, typename TValue>
+	class Cache : public Object, NoCopy
+	{
+	public:
+		typedef Delegate<size_t(const TKey&, const TValue&)> CostDelegate;
+		typedef Delegate<void(const TKey&, const TValue&)> EvictionDelegate;
+
+	protected:
+		struct Entry
+		{
+			TKey key;
+			TValue value;
+			size_t cost;
+
+			Entry(const TKey& key, const TValue& value, size_t cost) : key(key), value(value), cost(cost) { }
+		};
+		typedef typename std::list<Entry> EntryList;
+		typedef typename EntryList::iterator EntryIterator;
+		typedef typename std::map<TKey, EntryIterator, Internal::ComparisonLess<TKey> > EntryMap;
+
+		AutoPointer<ValueComparison<TKey> > keycomparison;
+		CachePolicy::Enum policy;
+		size_t budget;
+		size_t cost;
+		EntryList entries;
+		EntryMap map;
+		CostDelegate costDelegate;
+		EvictionDelegate evictionDelegate;
+		CacheStatistics statistics;
+		Internal::CacheFrequencySketch sketch;
+
+		u32 Hash(const TKey& key) const { return Internal::CacheHash<TKey>()(key); }
+
+		void Record(const TKey& key)
+		{
+			if (policy == CachePolicy::FrequencyAdmission)
+				sketch.Increment(Hash(key));
+		}
+
+		void Erase(EntryIterator entry)
+		{
+			cost -= entry->cost;
+			map.erase(entry->key);
+			entries.erase(entry);
+		}
+
+		void Evict(size_t required)
+		{
+			while (!entries.empty() && cost + required > budget) {
+				EntryIterator victim = --entries.end();
+				Entry evicted = *victim;
+				Erase(victim);
+				statistics.evictions++;
+				if (evictionDelegate)
+					evictionDelegate.Call(evicted.key, evicted.value);
+			}
+		}
+
+		// An entry being replaced neither counts against the budget nor competes as the eviction victim.
+		bool Admit(const TKey& key, size_t itemCost, EntryIterator replaced)
+		{
+			if (itemCost > budget)
+				return false;
+			size_t remaining = cost - (replaced != entries.end() ? replaced->cost : 0);
+			if (policy != CachePolicy::FrequencyAdmission || remaining + itemCost <= budget)
+				return true;
+			EntryIterator victim = --entries.end();
+			if (victim == replaced)
+				--victim;
+			return sketch.Estimate(Hash(key)) > sketch.Estimate(Hash(victim->key));
+		}
+
+	public:
+		Cache(size_t budget, CachePolicy::Enum policy = CachePolicy::LeastRecentlyUsed, ValueComparison<TKey>* keycomparison = autonew OperatorValueComparison<TKey>()) : keycomparison(keycomparison), policy(policy), budget(budget), cost(0), map(Internal::ComparisonLess<TKey>(keycomparison)) { }
+		~Cache() { Clear(); }
+
+		void SetCostDelegate(const CostDelegate& value) { costDelegate = value; }
+		void SetEvictionDelegate(const EvictionDelegate& value) { evictionDelegate = value; }
+
+		CachePolicy::Enum GetPolicy() const { return policy; }
+		size_t GetBudget() const { return budget; }
+		void SetBudget(size_t value) { budget = value; Evict(0); }
+		size_t GetCost() const { return cost; }
+		long GetCount() const { return map.size(); }
+
+		const CacheStatistics& GetStatistics() const { return statistics; }
+		void ResetStatistics() { statistics = CacheStatistics(); }
+
+		// Looks up an item and marks it as recently used.
+		bool TryGetItem(const TKey& key, TValue& value)
+		{
+			Record(key);
+			typename EntryMap::iterator iter = map.find(key);
+			if (iter == map.end()) {
+				statistics.misses++;
+				return false;
+			}
+			statistics.hits++;
+			entries.splice(entries.begin(), entries, iter->second);
+			value = iter->second->value;
+			return true;
+		}
+
+		bool ContainsKey(const TKey& key) const { return map.find(key) != map.end(); }
+
+		// Inserts or replaces an item, evicting others as needed. Returns false if the policy declined to cache it, in which
+		// case any item already cached under the key is kept.
+		bool Add(const TKey& key, const TValue& value)
+		{
+			size_t itemCost = costDelegate ? costDelegate.Call(key, value) : 1;
+			typename EntryMap::iterator existing = map.find(key);
+			if (policy == CachePolicy::FrequencyAdmission && (long)map.size() >= sketch.GetWidth())
+				sketch.Resize(map.size() * 2);
+			if (!Admit(key, itemCost, existing != map.end() ? existing->second : entries.end())) {
+				statistics.rejections++;
+				return false;
+			}
+			if (existing != map.end())
+				Erase(existing->second);
+			Evict(itemCost);
+			entries.push_front(Entry(key, value, itemCost));
+			map.insert(std::make_pair(key, entries.begin()));
+			cost += itemCost;
+			return true;
+		}
+
+		bool RemoveKey(const TKey& key)
+		{
+			typename EntryMap::iterator iter = map.find(key);
+			if (iter == map.end())
+				return false;
+			Erase(iter->second);
+			return true;
+		}
+
+		void Clear() { entries.clear(); map.clear(); cost = 0; }
+	};
+} }
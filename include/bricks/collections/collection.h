@@ -2,7 +2,28 @@
 
 #include "bricks/collections/iterator.h"
 
+#include <new>
+#include <string.h>
+
 namespace Bricks { namespace Collections {
+	namespace Internal {
+		// Types whose copies may be made with memcpy. Other types can specialize this where the compiler cannot tell.
+#if BRICKS_ENV_GCC
+		template<typename T> struct IsTriviallyCopyable { static const bool Value = __has_trivial_copy(T) && __has_trivial_assign(T) && __has_trivial_destructor(T); };
+#else
+		template<typename T> struct IsTriviallyCopyable { static const bool Value = SFINAE::IsIntegerNumber<T>::Value || SFINAE::IsFloatingPointNumber<T>::Value; };
+#endif
+		template<typename T> struct IsTriviallyCopyable<T*> { static const bool Value = true; };
+		template<> struct IsTriviallyCopyable<bool> { static const bool Value = true; };
+		template<> struct IsTriviallyCopyable<char> { static const bool Value = true; };
+
+		// Copy-constructs count items into uninitialized storage.
+		template<typename T>
+		static inline typename SFINAE::EnableIf<IsTriviallyCopyable<T>::Value>::Type CopyConstructItems(T* destination, const T* source, long count) { if (count) memcpy(destination, source, count * sizeof(T)); }
+		template<typename T>
+		static inline typename SFINAE::DisableIf<IsTriviallyCopyable<T>::Value>::Type CopyConstructItems(T* destination, const T* source, long count) { for (long i = 0; i < count; i++) ::new (destination + i) T(source[i]); }
+	}
+
 	template<typename T>
 	class Collection : public Iterable< T >
 	{
@@ -11,8 +32,14 @@ namespace Bricks { namespace Collections {
 
 		virtual bool ContainsItem(const T& value) const = 0;
 
+		// Capacity hints; collections without preallocated storage ignore them.
+		virtual void Reserve(long size) { }
+		virtual long GetCapacity() const { return GetCount(); }
+		virtual void ShrinkToFit() { }
+
 		virtual void AddItem(const T& value) = 0;
-		virtual void AddItems(Iterable<T>* values) { BRICKS_FOR_EACH (const T& value, values) AddItem(value); }
+		virtual void AddRange(const T* values, long count) { Reserve(GetCount() + count); for (long i = 0; i < count; i++) AddItem(values[i]); }
+		virtual void AddItems(Iterable<T>* values) { long count; const T* items = values->GetContiguousItems(count); if (items) AddRange(items, count); else BRICKS_FOR_EACH (const T& value, values) AddItem(value); }
 		virtual bool RemoveItem(const T& value) = 0;
 		virtual void RemoveItems(const T& value) { while (RemoveItem(value)) ; }
 		virtual void Clear() = 0;
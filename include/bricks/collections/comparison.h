@@ -4,6 +4,10 @@
 #include "bricks/core/object.h"
 #include "bricks/core/autopointer.h"
 
+#if BRICKS_CONFIG_RTTI
+#include <typeinfo>
+#endif
+
 namespace Bricks { namespace Collections {
 	namespace ComparisonResult {
 		enum Enum {
@@ -59,4 +63,39 @@ namespace Bricks { namespace Collections {
 		PointerValueComparison(ValueComparison<T>* comparison = autonew OperatorValueComparison<T>()) : comparison(comparison) { }
 		ComparisonResult::Enum Compare(T*const& v1, T*const& v2) { return comparison->Compare(*v1, *v2); }
 	};
+
+	namespace Internal {
+		// STL-style strict weak ordering functors. OperatorLess bypasses ValueComparison entirely and is only
+		// used when the comparison in effect is the stock OperatorValueComparison<T>.
+		template<typename T, typename V = void>
+		struct OperatorLess
+		{
+			static const bool Available = false;
+			bool operator ()(const T& v1, const T& v2) const { return false; }
+		};
+
+		template<typename T>
+		struct OperatorLess<T, typename SFINAE::EnableIf<SFINAE::HasGreaterThanOperator<T>::Value && SFINAE::HasLessThanOperator<T>::Value>::Type>
+		{
+			static const bool Available = true;
+			bool operator ()(const T& v1, const T& v2) const { return v1 < v2; }
+		};
+
+		template<typename T>
+		struct ComparisonLess
+		{
+			ValueComparison<T>* comparison;
+			ComparisonLess(ValueComparison<T>* comparison) : comparison(comparison) { }
+			bool operator ()(const T& v1, const T& v2) const { return comparison->Compare(v1, v2) == ComparisonResult::Less; }
+		};
+
+		template<typename T> static inline bool IsOperatorComparison(const ValueComparison<T>* comparison)
+		{
+#if BRICKS_CONFIG_RTTI
+			return OperatorLess<T>::Available && comparison && typeid(*comparison) == typeid(OperatorValueComparison<T>);
+#else
+			return false;
+#endif
+		}
+	}
 } }
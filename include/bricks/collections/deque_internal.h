@@ -9,10 +9,11 @@
 #include "bricks/core/object.h"
 #include "bricks/core/autopointer.h"
 #include "bricks/core/exception.h"
+#include "bricks/core/math.h"
 #include "bricks/collections/comparison.h"
 #include "bricks/collections/collection.h"
 
-#include <deque>
+#include <new>
 
 namespace Bricks { namespace Collections {
 	class QueueEmptyException : public Exception
@@ -23,57 +24,171 @@ namespace Bricks { namespace Collections {
 
 	template<typename T> class DequeIterator;
 
+	// Items live in a single power-of-two ring that doubles when full, so steady pushing and popping never allocates.
 	template<typename T>
 	class Deque : public Object, public Collection<T>, public IterableFast<DequeIterator<T> >
 	{
 	protected:
+		static const long MinimumCapacity = 8;
+
 		AutoPointer<ValueComparison<T> > comparison;
-		typename std::deque<T> queue;
-		typedef typename std::deque<T>::iterator iterator;
-		typedef typename std::deque<T>::const_iterator const_iterator;
+		T* items;
+		long capacity;
+		long head;
+		long count;
 
 		friend class DequeIterator<T>;
 
-		const_iterator IteratorOfItem(const T& value) const {
-			for (const_iterator iter = queue.begin(); iter != queue.end(); iter++) {
-				if (!comparison->Compare(*iter, value))
-					return iter;
+		long SlotOf(long index) const { return (head + index) & (capacity - 1); }
+		T& ItemAt(long index) const { return items[SlotOf(index)]; }
+
+		void Grow(long minimum)
+		{
+			long size = capacity;
+			if (!size)
+				size = MinimumCapacity;
+			while (size < minimum)
+				size <<= 1;
+			if (size != capacity)
+				Resize(size);
+		}
+
+		void Resize(long size)
+		{
+			T* resized = static_cast<T*>(::operator new(size * sizeof(T)));
+			for (long i = 0; i < count; i++) {
+				T& item = ItemAt(i);
+				::new (resized + i) T(item);
+				item.~T();
+			}
+			::operator delete(items);
+			items = resized;
+			capacity = size;
+			head = 0;
+		}
+
+		void PushBack(const T& value)
+		{
+			if (count == capacity) {
+				T copy(value);
+				Grow(count + 1);
+				::new (items + SlotOf(count)) T(copy);
+			} else
+				::new (items + SlotOf(count)) T(value);
+			count++;
+		}
+
+		void PushFront(const T& value)
+		{
+			if (count == capacity) {
+				T copy(value);
+				Grow(count + 1);
+				head = (head - 1) & (capacity - 1);
+				::new (items + head) T(copy);
+			} else {
+				head = (head - 1) & (capacity - 1);
+				::new (items + head) T(value);
 			}
-			return queue.end();
+			count++;
+		}
+
+		void PopFront()
+		{
+			if (!count)
+				BRICKS_FEATURE_RELEASE_THROW(QueueEmptyException());
+			items[head].~T();
+			head = (head + 1) & (capacity - 1);
+			count--;
+		}
+
+		T& Front() const
+		{
+			if (!count)
+				BRICKS_FEATURE_RELEASE_THROW(QueueEmptyException());
+			return items[head];
 		}
-		
-		iterator IteratorOfItem(const T& value) {
-			for (iterator iter = queue.begin(); iter != queue.end(); iter++) {
-				if (!comparison->Compare(*iter, value))
-					return iter;
+
+		void CopyFrom(const Deque<T>& queue)
+		{
+			Reserve(queue.count);
+			for (long i = 0; i < queue.count; i++)
+				PushBack(queue.ItemAt(i));
+		}
+
+		long IndexOfItem(const T& value) const {
+			for (long i = 0; i < count; i++) {
+				if (!comparison->Compare(ItemAt(i), value))
+					return i;
 			}
-			return queue.end();
+			return -1;
 		}
-		
+
 	public:
-		Deque(ValueComparison<T>* comparison = autonew OperatorValueComparison<T>()) : comparison(comparison) { }
-		Deque(const Deque<T>& queue, ValueComparison<T>* comparison = autonew OperatorValueComparison< T >()) : comparison(comparison ?: queue.comparison.GetValue()), queue(queue.queue) { }
-		Deque(Iterable<T>* iterable, ValueComparison<T>* comparison = autonew OperatorValueComparison<T>()) : comparison(comparison) { AddItems(iterable); }
+		Deque(ValueComparison<T>* comparison = autonew OperatorValueComparison<T>()) : comparison(comparison), items(NULL), capacity(0), head(0), count(0) { }
+		Deque(const Deque<T>& queue, ValueComparison<T>* comparison = autonew OperatorValueComparison< T >()) : comparison(comparison ?: queue.comparison.GetValue()), items(NULL), capacity(0), head(0), count(0) { CopyFrom(queue); }
+		Deque(Iterable<T>* iterable, ValueComparison<T>* comparison = autonew OperatorValueComparison<T>()) : comparison(comparison), items(NULL), capacity(0), head(0), count(0) { AddItems(iterable); }
+		~Deque() { Clear(); ::operator delete(items); }
+
+		Deque& operator =(const Deque<T>& queue)
+		{
+			if (&queue != this) {
+				Clear();
+				comparison = queue.comparison;
+				CopyFrom(queue);
+			}
+			return *this;
+		}
 
 		virtual void Push(const T& value) = 0;
 
+		// Pushes each value in order, as if by Push.
+		virtual void PushRange(const T* values, long size) { Reserve(count + size); for (long i = 0; i < size; i++) Push(values[i]); }
+		// Pops up to size items into values in the order Pop would remove them, returning how many were taken.
+		long PopRange(T* values, long size)
+		{
+			size = Math::Min(size, count);
+			for (long i = 0; i < size; i++) {
+				values[i] = items[head];
+				PopFront();
+			}
+			return size;
+		}
+
+		virtual void Reserve(long size) { if (size > capacity) Grow(size); }
+		virtual long GetCapacity() const { return capacity; }
+		virtual void ShrinkToFit()
+		{
+			long size = MinimumCapacity;
+			while (size < count)
+				size <<= 1;
+			if (size < capacity)
+				Resize(size);
+		}
+
 		// Iterator
 		virtual ReturnPointer<Iterator<T> > GetIterator() const { return autonew DequeIterator<T>(const_cast<Deque<T>&>(*this)); }
 		DequeIterator<T> GetIteratorFast() const { return DequeIterator<T>(const_cast<Deque<T>&>(*this)); }
 
 		// Collection
-		virtual long GetCount() const { return queue.size(); };
+		virtual long GetCount() const { return count; };
 
-		virtual bool ContainsItem(const T& value) const { return IteratorOfItem(value) != queue.end(); }
+		virtual bool ContainsItem(const T& value) const { return IndexOfItem(value) >= 0; }
 
 		virtual void AddItem(const T& value) { Push(value); }
-		virtual void AddItems(Iterable<T>* values) { BRICKS_FOR_EACH (const T& item, values) AddItem(item); }
-		virtual void Clear() { queue.clear(); }
+		virtual void AddRange(const T* values, long size) { PushRange(values, size); }
+		virtual void Clear() {
+			for (long i = 0; i < count; i++)
+				ItemAt(i).~T();
+			head = 0;
+			count = 0;
+		}
 		virtual bool RemoveItem(const T& value) {
-			iterator iter = IteratorOfItem(value);
-			if (iter == queue.end())
+			long index = IndexOfItem(value);
+			if (index < 0)
 				return false;
-			queue.erase(iter);
+			for (long i = index + 1; i < count; i++)
+				ItemAt(i - 1) = ItemAt(i);
+			ItemAt(--count).~T();
 			return true;
 		}
 	};
@@ -82,14 +197,16 @@ namespace Bricks { namespace Collections {
 	class DequeIterator : public Iterator<T>
 	{
 	private:
-		typename Deque<T>::iterator position;
-		typename Deque<T>::iterator end;
+		T* items;
+		long mask;
+		long position;
+		long end;
 
 		friend class Deque<T>;
 
 	public:
-		DequeIterator(Deque<T>& queue) : position(queue.queue.begin() - 1), end(queue.queue.end()) { }
-		T& GetCurrent() const { return *position; }
+		DequeIterator(Deque<T>& queue) : items(queue.items), mask(queue.capacity - 1), position(queue.head - 1), end(queue.head + queue.count) { }
+		T& GetCurrent() const { return items[position & mask]; }
 		bool MoveNext() { return ++position < end; }
 	};
 } }
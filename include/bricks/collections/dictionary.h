@@ -41,7 +41,7 @@ namespace Bricks { namespace Collections {
 		struct StlCompare {
 			AutoPointer<ValueComparison<TKey> > comparison;
 			StlCompare(ValueComparison<TKey>* comparison) : comparison(comparison) { }
-			bool operator ()(TKey v1, TKey v2) const { return comparison->Compare(v1, v2) == ComparisonResult::Less; }
+			bool operator ()(const TKey& v1, const TKey& v2) const { return comparison->Compare(v1, v2) == ComparisonResult::Less; }
 		};
 		StlCompare keycomparison;
 		AutoPointer<ValueComparison<TValue> > comparison;
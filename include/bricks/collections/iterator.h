@@ -41,6 +41,8 @@ namespace Bricks { namespace Collections {
 		typedef T IteratorType;
 
 		virtual ReturnPointer< Iterator< IteratorType > > GetIterator() const = 0;
+		// Iterables backed by one array expose it so bulk copies can skip the iterator.
+		virtual const T* GetContiguousItems(long& count) const { count = 0; return NULL; }
 
 		void Iterate(const Delegate<bool(IteratorType&)>& delegate) const;
 		void Iterate(const Delegate<void(IteratorType&)>& delegate) const;
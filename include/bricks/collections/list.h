@@ -13,6 +13,7 @@ namespace Bricks { namespace Collections {
 		virtual long IndexOfItem(const T& value) const = 0;
 
 		virtual void InsertItem(long index, const T& value) = 0;
+		virtual void InsertRange(long index, const T* values, long count) { this->Reserve(this->GetCount() + count); for (long i = 0; i < count; i++) InsertItem(index + i, values[i]); }
 		virtual void RemoveItemAt(long index) = 0;
 
 		virtual const T& operator[](long index) const { return GetItem(index); }
@@ -5,6 +5,7 @@
 #include "bricks/core/copypointer.h"
 
 #include "bricks/collections/list.h"
+#include "bricks/collections/smallarray.h"
 
 namespace Bricks { namespace Collections {
 	template<typename T> class ListGuardBase;
@@ -16,34 +17,15 @@ namespace Bricks { namespace Collections {
 		template<typename T> struct ListGuardArray<T, typename SFINAE::DisableIf<SFINAE::IsCompatibleType<AutoArray<typename SFINAE::MakeValueType<typename T::IteratorType>::Type>, T>::Value>::Type> { typedef Array<typename T::IteratorType> Type; };
 		template<typename T> struct ListGuardArray<T, typename SFINAE::EnableIf<SFINAE::IsCompatibleType<AutoArray<typename SFINAE::MakeValueType<typename T::IteratorType>::Type>, T>::Value>::Type> { typedef AutoArray<typename SFINAE::MakeValueType<typename T::IteratorType>::Type> Type; };
 
-		template<typename T, typename E = void> class ListGuardIteratorHolder;
-
-		template<typename T>
-		class ListGuardIteratorHolder<T, typename SFINAE::EnableIf<SFINAE::IsCompatibleType<IterableFastBase, T>::Value >::Type >
+		// A run of the items an iterator still has to visit: either live indices into the guarded list, or indices into
+		// the iterator's stash of items that were removed or replaced after the iterator was created.
+		struct ListGuardSegment
 		{
-			protected:
-				typedef typename T::IteratorType I;
-				typename T::IteratorFastType iterator;
-
-			public:
-				ListGuardIteratorHolder(ListGuardBase<T>* list) : iterator(list->list->GetIteratorFast()) { }
-
-				I& GetCurrent() const { return iterator.GetCurrent(); }
-				bool MoveNext() { return iterator.MoveNext(); }
-		};
-
-		template<typename T>
-		class ListGuardIteratorHolder<T, typename SFINAE::DisableIf<SFINAE::IsCompatibleType<IterableFastBase, T>::Value >::Type >
-		{
-			protected:
-				typedef typename T::IteratorType I;
-				AutoPointer<Iterator<I> > iterator;
+			long begin;
+			long end;
+			bool stashed;
 
-			public:
-				ListGuardIteratorHolder(ListGuardBase<T>* list) : iterator(list->list->GetIterator()) { }
-
-				I& GetCurrent() const { return iterator->GetCurrent(); }
-				bool MoveNext() const { return iterator->MoveNext(); }
+			ListGuardSegment(long begin = 0, long end = 0, bool stashed = false) : begin(begin), end(end), stashed(stashed) { }
 		};
 
 		template<typename T>
@@ -54,33 +36,92 @@ namespace Bricks { namespace Collections {
 				typedef typename ListGuardArray<T>::Type CacheType;
 
 				ListGuardBase<T>* list;
-				ListGuardIteratorHolder<T> iterator;
-
-				AutoPointer<CacheType> listCache;
-				AutoPointer<typename Array<I>::IteratorFastType> iteratorCache;
+				SmallArray<ListGuardSegment, 4> segments;
+				AutoPointer<CacheType> stash;
 				bool status;
 
 				ListGuardIterator(const ListGuardBase<T>* list) :
 					list(const_cast<ListGuardBase<T>*>(list)),
-					iterator(this->list),
 					status(false)
 				{
+					long count = this->list->list->GetCount();
+					if (count)
+						segments.AddItem(ListGuardSegment(0, count));
 					this->list->IteratorRegister(this);
 				}
 
-				void ListChanged()
+				// Cuts a live segment at index, optionally stashing the item there, and resumes at [resume, resumeEnd).
+				void Split(long segment, long index, long resume, long resumeEnd, long stashIndex = -1)
+				{
+					ListGuardSegment after(resume, resumeEnd);
+					segments[segment].end = index;
+					long position = segment + 1;
+					if (stashIndex >= 0)
+						segments.InsertItem(position++, ListGuardSegment(stashIndex, stashIndex + 1, true));
+					if (after.begin < after.end)
+						segments.InsertItem(position, after);
+					if (segments[segment].begin == segments[segment].end)
+						segments.RemoveItemAt(segment);
+				}
+
+				long Stash(long index)
+				{
+					if (!stash)
+						stash = autonew CacheType();
+					stash->AddItem(list->list->GetItem(index));
+					return stash->GetCount() - 1;
+				}
+
+				// The list calls these before it performs the corresponding change.
+				void ItemInserting(long index)
+				{
+					for (long i = 0; i < segments.GetCount(); i++) {
+						ListGuardSegment& segment = segments[i];
+						if (segment.stashed || index >= segment.end)
+							continue;
+						if (index <= segment.begin) {
+							segment.begin++;
+							segment.end++;
+						} else {
+							Split(i, index, index + 1, segment.end + 1);
+							i++;
+						}
+					}
+				}
+
+				void ItemRemoving(long index, bool replacing)
 				{
-					if (iteratorCache || !list)
-						return;
-					listCache = autonew CacheType();
-					if (status || !iterator.MoveNext()) {
-						do
-							listCache->AddItem(iterator.GetCurrent());
-						while (iterator.MoveNext());
+					for (long i = 0; i < segments.GetCount(); i++) {
+						ListGuardSegment& segment = segments[i];
+						if (segment.stashed || index >= segment.end)
+							continue;
+						if (index < segment.begin) {
+							if (!replacing) {
+								segment.begin--;
+								segment.end--;
+							}
+						} else {
+							long count = segments.GetCount();
+							if (replacing)
+								Split(i, index, index + 1, segment.end, Stash(index));
+							else
+								Split(i, index, index, segment.end - 1, Stash(index));
+							i += segments.GetCount() - count;
+						}
+					}
+				}
+
+				void ListChanging()
+				{
+					for (long i = 0; i < segments.GetCount(); i++) {
+						ListGuardSegment& segment = segments[i];
+						if (segment.stashed)
+							continue;
+						long begin = stash ? stash->GetCount() : 0;
+						for (long index = segment.begin; index < segment.end; index++)
+							Stash(index);
+						segment = ListGuardSegment(begin, begin + segment.end - segment.begin, true);
 					}
-					iteratorCache = autonew typename Array<I>::IteratorFastType(listCache->GetIteratorFast());
-					if (status)
-						iteratorCache->MoveNext();
 				}
 
 				friend class ListGuardBase<T>;
@@ -88,12 +129,17 @@ namespace Bricks { namespace Collections {
 			public:
 				I& GetCurrent() const
 				{
-					return iteratorCache ? iteratorCache->GetCurrent() : iterator.GetCurrent();
+					const ListGuardSegment& segment = segments[0];
+					return segment.stashed ? stash->GetItem(segment.begin) : list->list->GetItem(segment.begin);
 				}
 
 				bool MoveNext()
 				{
-					if (iteratorCache ? iteratorCache->MoveNext() : iterator.MoveNext())
+					if (status && segments.GetCount()) {
+						if (++segments[0].begin == segments[0].end)
+							segments.RemoveItemAt(0);
+					}
+					if (segments.GetCount())
 						return status = true;
 					if (list)
 						list->IteratorUnregister(this);
@@ -106,9 +152,8 @@ namespace Bricks { namespace Collections {
 					if (list)
 						list->IteratorUnregister(this);
 					list = copy.list;
-					iterator = copy.iterator;
-					listCache = copy.listCache;
-					iteratorCache = copy.iteratorCache;
+					segments = copy.segments;
+					stash = copy.stash;
 					status = copy.status;
 					if (list)
 						list->IteratorRegister(this);
@@ -117,12 +162,12 @@ namespace Bricks { namespace Collections {
 
 				ListGuardIterator(const ListGuardIterator& copy) :
 					list(copy.list),
-					iterator(copy.iterator),
-					listCache(copy.listCache),
-					iteratorCache(copy.iteratorCache),
+					segments(copy.segments),
+					stash(copy.stash),
 					status(copy.status)
 				{
-					list->IteratorRegister(this);
+					if (list)
+						list->IteratorRegister(this);
 				}
 
 				~ListGuardIterator()
@@ -133,6 +178,8 @@ namespace Bricks { namespace Collections {
 		};
 	}
 
+	// Guards a list against changes made through it while it is being iterated. Iterators keep visiting exactly the items
+	// that were in the list when they were created; they track changes by index and only keep copies of removed or replaced items.
 	template<typename T>
 	class ListGuardBase : public List<typename T::IteratorType>, public IterableFast< Internal::ListGuardIterator<T> >
 	{
@@ -141,18 +188,30 @@ namespace Bricks { namespace Collections {
 		typedef typename T::IteratorType I;
 
 		AutoPointer<T> list;
-		Array<GuardIterator*> iterators;
+		SmallArray<GuardIterator*, 4> iterators;
 
-		void GuardIterators()
+		void ItemInserting(long index)
 		{
 			BRICKS_FOR_EACH (GuardIterator* iterator, iterators)
-				iterator->ListChanged();
+				iterator->ItemInserting(index);
+		}
+
+		void ItemRemoving(long index, bool replacing = false)
+		{
+			BRICKS_FOR_EACH (GuardIterator* iterator, iterators)
+				iterator->ItemRemoving(index, replacing);
+		}
+
+		void ListChanging()
+		{
+			BRICKS_FOR_EACH (GuardIterator* iterator, iterators)
+				iterator->ListChanging();
 		}
 
 		void DestroyIterators()
 		{
 			BRICKS_FOR_EACH (GuardIterator* iterator, iterators) {
-				iterator->ListChanged();
+				iterator->ListChanging();
 				iterator->list = NULL;
 			}
 		}
@@ -161,39 +220,74 @@ namespace Bricks { namespace Collections {
 		void IteratorUnregister(GuardIterator* iterator) { iterators.RemoveItem(iterator); }
 
 		friend class Internal::ListGuardIterator<T>;
-		friend class Internal::ListGuardIteratorHolder<T>;
 
 	public:
 		ListGuardBase(T* list) : list(list) { }
 		ListGuardBase(const ListGuardBase& list) : list(list.list) { }
 		~ListGuardBase() { DestroyIterators(); }
 
-		virtual ListGuardBase& operator =(const ListGuardBase& copy) { GuardIterators(); list = copy.list; return *this; }
+		virtual ListGuardBase& operator =(const ListGuardBase& copy) { ListChanging(); list = copy.list; return *this; }
 
 		// Collection
 		virtual long GetCount() const { return list->GetCount(); }
 
 		virtual bool ContainsItem(const I& value) const { return list->ContainsItem(value); }
 
-		virtual void AddItem(const I& value) { GuardIterators(); list->AddItem(value); }
-		virtual void AddItems(Iterable<I>* values) { GuardIterators(); list->AddItems(values); }
-		virtual bool RemoveItem(const I& value) { GuardIterators(); return list->RemoveItem(value); }
-		virtual void RemoveItems(const I& value) { GuardIterators(); list->RemoveItems(value); }
-		virtual void Clear() { GuardIterators(); list->Clear(); }
+		virtual void Reserve(long size) { list->Reserve(size); }
+		virtual long GetCapacity() const { return list->GetCapacity(); }
+		virtual void ShrinkToFit() { list->ShrinkToFit(); }
+
+		virtual void AddItem(const I& value) { if (IsGuarding()) ItemInserting(list->GetCount()); list->AddItem(value); }
+		virtual void AddRange(const I* values, long count)
+		{
+			for (long i = 0, index = list->GetCount(); IsGuarding() && i < count; i++)
+				ItemInserting(index + i);
+			list->AddRange(values, count);
+		}
+		virtual void AddItems(Iterable<I>* values) { if (!IsGuarding()) list->AddItems(values); else BRICKS_FOR_EACH (const I& value, values) AddItem(value); }
+		virtual bool RemoveItem(const I& value)
+		{
+			if (!IsGuarding())
+				return list->RemoveItem(value);
+			long index = list->IndexOfItem(value);
+			if (index < 0)
+				return false;
+			RemoveItemAt(index);
+			return true;
+		}
+		virtual void RemoveItems(const I& value)
+		{
+			if (!IsGuarding()) {
+				list->RemoveItems(value);
+				return;
+			}
+			// Hold on to the value in case it is one of the items being removed.
+			typename Internal::ListGuardArray<T>::Type hold;
+			hold.AddItem(value);
+			while (RemoveItem(hold[0])) ;
+		}
+		virtual void Clear() { ListChanging(); list->Clear(); }
 
 		// List
-		virtual void SetItem(long index, const I& value) { GuardIterators(); list->SetItem(index, value); }
+		virtual void SetItem(long index, const I& value) { ItemRemoving(index, true); list->SetItem(index, value); }
 
 		virtual const I& GetItem(long index) const { return list->GetItem(index); }
 		virtual I& GetItem(long index) { return list->GetItem(index); }
 		virtual long IndexOfItem(const I& value) const { return list->IndexOfItem(value); }
 
-		virtual void InsertItem(long index, const I& value) { GuardIterators(); list->InsertItem(index, value); }
-		virtual void RemoveItemAt(long index) { GuardIterators(); list->RemoveItemAt(index); }
+		virtual void InsertItem(long index, const I& value) { ItemInserting(index); list->InsertItem(index, value); }
+		virtual void InsertRange(long index, const I* values, long count)
+		{
+			for (long i = 0; IsGuarding() && i < count; i++)
+				ItemInserting(index + i);
+			list->InsertRange(index, values, count);
+		}
+		virtual void RemoveItemAt(long index) { ItemRemoving(index); list->RemoveItemAt(index); }
 
 		// Iterator
 		virtual ReturnPointer<Iterator<I> > GetIterator() const { return autonew GuardIterator(this); }
 		virtual GuardIterator GetIteratorFast() const { return GuardIterator(this); }
+		virtual const I* GetContiguousItems(long& count) const { return list->GetContiguousItems(count); }
 
 		bool IsGuarding() const { return iterators.GetCount(); }
 	};
@@ -0,0 +1,237 @@
+#pragma once
+
+#include "bricks/config.h"
+
+#if !BRICKS_CONFIG_STL
+#error libbricks must be configured to use the STL
+#endif
+
+#include "bricks/collections/deque_internal.h"
+
+#include <vector>
+
+namespace Bricks { namespace Collections {
+	namespace Internal {
+		template<typename T>
+		struct PriorityQueueEntry
+		{
+			T value;
+			long handle;
+
+			PriorityQueueEntry(const T& value, long handle) : value(value), handle(handle) { }
+		};
+
+		template<typename T>
+		class PriorityQueueIterator : public Iterator<T>
+		{
+			private:
+				PriorityQueueEntry<T>* position;
+				PriorityQueueEntry<T>* end;
+
+			public:
+				PriorityQueueIterator(PriorityQueueEntry<T>* begin, PriorityQueueEntry<T>* end) : position(begin - 1), end(end) { }
+				T& GetCurrent() const { return position->value; }
+				bool MoveNext() { return ++position < end; }
+		};
+	}
+
+	// A 4-ary min-heap: Peek returns the item that compares Less than all others.
+	// Push returns a handle that stays valid until that item leaves the queue, and can be used to change its priority.
+	// Iteration visits items in heap order, not priority order.
+	template<typename T>
+	class PriorityQueue : public Object, public Collection<T>, public IterableFast<Internal::PriorityQueueIterator<T> >
+	{
+	public:
+		typedef long Handle;
+
+	protected:
+		typedef Internal::PriorityQueueEntry<T> Entry;
+		static const long Arity = 4;
+
+		AutoPointer<ValueComparison<T> > comparison;
+		bool operatorComparison;
+		std::vector<Entry> heap;
+		std::vector<long> positions;
+		std::vector<Handle> freeHandles;
+
+		bool IsLess(const T& v1, const T& v2) const
+		{
+			if (operatorComparison)
+				return Internal::OperatorLess<T>()(v1, v2);
+			return comparison->Compare(v1, v2) == ComparisonResult::Less;
+		}
+
+		void Place(long index, const Entry& entry)
+		{
+			heap[index] = entry;
+			positions[entry.handle] = index;
+		}
+
+		void SiftUp(long index)
+		{
+			Entry entry = heap[index];
+			while (index > 0) {
+				long parent = (index - 1) / Arity;
+				if (!IsLess(entry.value, heap[parent].value))
+					break;
+				Place(index, heap[parent]);
+				index = parent;
+			}
+			Place(index, entry);
+		}
+
+		void SiftDown(long index)
+		{
+			long count = heap.size();
+			Entry entry = heap[index];
+			while (true) {
+				long first = index * Arity + 1;
+				if (first >= count)
+					break;
+				long last = Math::Min(first + Arity, count);
+				long child = first;
+				for (long i = first + 1; i < last; i++) {
+					if (IsLess(heap[i].value, heap[child].value))
+						child = i;
+				}
+				if (!IsLess(heap[child].value, entry.value))
+					break;
+				Place(index, heap[child]);
+				index = child;
+			}
+			Place(index, entry);
+		}
+
+		void Heapify()
+		{
+			// Division truncates toward zero, so an empty heap would otherwise start at index 0.
+			if (heap.size() < 2)
+				return;
+			for (long i = ((long)heap.size() - 2) / Arity; i >= 0; i--)
+				SiftDown(i);
+		}
+
+		Handle AllocateHandle()
+		{
+			if (freeHandles.empty()) {
+				positions.push_back(-1);
+				return positions.size() - 1;
+			}
+			Handle handle = freeHandles.back();
+			freeHandles.pop_back();
+			return handle;
+		}
+
+		Handle Append(const T& value)
+		{
+			Handle handle = AllocateHandle();
+			positions[handle] = heap.size();
+			heap.push_back(Entry(value, handle));
+			return handle;
+		}
+
+		void RemoveAt(long index)
+		{
+			Handle handle = heap[index].handle;
+			positions[handle] = -1;
+			freeHandles.push_back(handle);
+
+			long last = heap.size() - 1;
+			if (index != last) {
+				Place(index, heap[last]);
+				heap.pop_back();
+				if (index > 0 && IsLess(heap[index].value, heap[(index - 1) / Arity].value))
+					SiftUp(index);
+				else
+					SiftDown(index);
+			} else
+				heap.pop_back();
+		}
+
+		long IndexOfItem(const T& value) const
+		{
+			for (size_t i = 0; i < heap.size(); i++) {
+				if (!comparison->Compare(heap[i].value, value))
+					return i;
+			}
+			return -1;
+		}
+
+		void Initialize() { operatorComparison = Internal::IsOperatorComparison(comparison.GetValue()); }
+
+	public:
+		PriorityQueue(ValueComparison<T>* comparison = autonew OperatorValueComparison<T>()) : comparison(comparison) { Initialize(); }
+		PriorityQueue(const PriorityQueue<T>& queue, ValueComparison<T>* comparison = NULL) : comparison(comparison ?: queue.comparison.GetValue()), heap(queue.heap), positions(queue.positions), freeHandles(queue.freeHandles) { Initialize(); if (comparison) Heapify(); }
+		PriorityQueue(Iterable<T>* iterable, ValueComparison<T>* comparison = autonew OperatorValueComparison<T>()) : comparison(comparison) { Initialize(); AddItems(iterable); }
+
+		Handle Push(const T& value)
+		{
+			Handle handle = Append(value);
+			SiftUp(heap.size() - 1);
+			return handle;
+		}
+		void Pop() { if (heap.empty()) BRICKS_FEATURE_RELEASE_THROW(QueueEmptyException()); RemoveAt(0); }
+		T PopItem() { if (heap.empty()) BRICKS_FEATURE_RELEASE_THROW(QueueEmptyException()); T value = heap[0].value; RemoveAt(0); return value; }
+		const T& Peek() const { if (heap.empty()) BRICKS_FEATURE_RELEASE_THROW(QueueEmptyException()); return heap[0].value; }
+		Handle PeekHandle() const { if (heap.empty()) BRICKS_FEATURE_RELEASE_THROW(QueueEmptyException()); return heap[0].handle; }
+
+		bool ContainsHandle(Handle handle) const { return handle >= 0 && handle < (long)positions.size() && positions[handle] >= 0; }
+		const T& GetItem(Handle handle) const { return heap[positions[handle]].value; }
+		// Replaces the item behind a handle and restores heap order, in either direction.
+		void UpdateItem(Handle handle, const T& value)
+		{
+			long index = positions[handle];
+			bool decreased = IsLess(value, heap[index].value);
+			heap[index].value = value;
+			if (decreased)
+				SiftUp(index);
+			else
+				SiftDown(index);
+		}
+		void RemoveHandle(Handle handle) { RemoveAt(positions[handle]); }
+
+		virtual void Reserve(long size) { heap.reserve(size); positions.reserve(size); }
+		virtual long GetCapacity() const { return heap.capacity(); }
+		virtual void ShrinkToFit() { std::vector<Entry>(heap).swap(heap); std::vector<long>(positions).swap(positions); }
+
+		// Iterator
+		virtual ReturnPointer<Iterator<T> > GetIterator() const { return autonew Internal::PriorityQueueIterator<T>(GetIteratorFast()); }
+		Internal::PriorityQueueIterator<T> GetIteratorFast() const { Entry* entries = heap.empty() ? NULL : const_cast<Entry*>(&heap[0]); return Internal::PriorityQueueIterator<T>(entries, entries + heap.size()); }
+
+		// Collection
+		virtual long GetCount() const { return heap.size(); }
+
+		virtual bool ContainsItem(const T& value) const { return IndexOfItem(value) >= 0; }
+
+		virtual void AddItem(const T& value) { Push(value); }
+		// Bulk additions append every item and then restore heap order once, in linear time.
+		virtual void AddRange(const T* values, long count)
+		{
+			Reserve(heap.size() + count);
+			for (long i = 0; i < count; i++)
+				Append(values[i]);
+			Heapify();
+		}
+		virtual void AddItems(Iterable<T>* values)
+		{
+			long count;
+			const T* items = values->GetContiguousItems(count);
+			if (items) {
+				AddRange(items, count);
+				return;
+			}
+			BRICKS_FOR_EACH (const T& value, values)
+				Append(value);
+			Heapify();
+		}
+		virtual bool RemoveItem(const T& value)
+		{
+			long index = IndexOfItem(value);
+			if (index < 0)
+				return false;
+			RemoveAt(index);
+			return true;
+		}
+		virtual void Clear() { heap.clear(); positions.clear(); freeHandles.clear(); }
+	};
+} }
@@ -0,0 +1,219 @@
+#pragma once
+
+#include "bricks/core/types.h"
+#include "bricks/core/string.h"
+
+#include <vector>
+#include <algorithm>
+#include <string.h>
+
+namespace Bricks { namespace Collections { namespace Internal {
+	// Maps a key onto an unsigned integer whose natural ordering matches the key's ordering.
+	// Inexact keys (string prefixes) only order by their leading bytes, and ties are resolved by comparing whole keys.
+	template<typename T> struct RadixKey { static const bool Available = false; };
+
+#define BRICKS_INTERNAL_RADIX_UNSIGNED(t) template<> struct RadixKey<t> { \
+		typedef t Type; static const bool Available = true; static const bool Exact = true; \
+		static Type Bits(t value) { return value; } \
+	}
+#define BRICKS_INTERNAL_RADIX_SIGNED(t, u) template<> struct RadixKey<t> { \
+		typedef u Type; static const bool Available = true; static const bool Exact = true; \
+		static Type Bits(t value) { return (u)value ^ ((u)1 << (sizeof(u) * 8 - 1)); } \
+	}
+#define BRICKS_INTERNAL_RADIX_FLOAT(t, u) template<> struct RadixKey<t> { \
+		typedef u Type; static const bool Available = true; static const bool Exact = true; \
+		static Type Bits(t value) { u bits; memcpy(&bits, &value, sizeof(bits)); return (bits >> (sizeof(u) * 8 - 1)) ? ~bits : bits | ((u)1 << (sizeof(u) * 8 - 1)); } \
+	}
+	BRICKS_INTERNAL_RADIX_UNSIGNED(u8);
+	BRICKS_INTERNAL_RADIX_UNSIGNED(u16);
+	BRICKS_INTERNAL_RADIX_UNSIGNED(u32);
+	BRICKS_INTERNAL_RADIX_UNSIGNED(u64);
+	BRICKS_INTERNAL_RADIX_SIGNED(s8, u8);
+	BRICKS_INTERNAL_RADIX_SIGNED(s16, u16);
+	BRICKS_INTERNAL_RADIX_SIGNED(s32, u32);
+	BRICKS_INTERNAL_RADIX_SIGNED(s64, u64);
+	BRICKS_INTERNAL_RADIX_FLOAT(f32, u32);
+	BRICKS_INTERNAL_RADIX_FLOAT(f64, u64);
+#undef BRICKS_INTERNAL_RADIX_UNSIGNED
+#undef BRICKS_INTERNAL_RADIX_SIGNED
+#undef BRICKS_INTERNAL_RADIX_FLOAT
+
+	template<> struct RadixKey<String>
+	{
+		typedef u64 Type;
+		static const bool Available = true;
+		static const bool Exact = false;
+		static Type Bits(const String& value) {
+			const u8* data = (const u8*)value.CString();
+			size_t size = value.GetSize();
+			Type bits = 0;
+			for (size_t i = 0; i < sizeof(Type); i++)
+				bits = (bits << 8) | (i < size ? data[i] : 0);
+			return bits;
+		}
+	};
+
+	static const int RadixDigitBits = 8;
+	static const int RadixBuckets = 1 << RadixDigitBits;
+
+	template<typename T> struct RadixValueKey
+	{
+		typedef typename RadixKey<T>::Type Type;
+		Type operator ()(const T& value) const { return RadixKey<T>::Bits(value); }
+	};
+
+	template<typename B> struct RadixEntry
+	{
+		B key;
+		long index;
+	};
+
+	template<typename B> struct RadixEntryKey
+	{
+		typedef B Type;
+		B operator ()(const RadixEntry<B>& entry) const { return entry.key; }
+	};
+
+	template<typename TKey, typename B> struct RadixEntryLess
+	{
+		const TKey* keys;
+		RadixEntryLess(const TKey* keys) : keys(keys) { }
+		bool operator ()(const RadixEntry<B>& v1, const RadixEntry<B>& v2) const { return keys[v1.index] < keys[v2.index]; }
+	};
+
+	template<typename T, typename K>
+	struct RadixPass
+	{
+		typedef typename K::Type B;
+		static const int Digits = sizeof(B);
+
+		// Counts every digit in a single read of the data; the totals don't depend on element order.
+		static void Histogram(const T* begin, const T* end, const K& key, long* histograms)
+		{
+			for (const T* item = begin; item != end; item++) {
+				B bits = key(*item);
+				for (int digit = 0; digit < Digits; digit++)
+					histograms[digit * RadixBuckets + (int)((bits >> (digit * RadixDigitBits)) & (RadixBuckets - 1))]++;
+			}
+		}
+
+		static void Histogram(const T* begin, const T* end, const K& key, int digit, long* histogram)
+		{
+			for (const T* item = begin; item != end; item++)
+				histogram[(int)((key(*item) >> (digit * RadixDigitBits)) & (RadixBuckets - 1))]++;
+		}
+
+		static void Scatter(const T* begin, const T* end, const K& key, int digit, long* offsets, T* output)
+		{
+			for (const T* item = begin; item != end; item++)
+				output[offsets[(int)((key(*item) >> (digit * RadixDigitBits)) & (RadixBuckets - 1))]++] = *item;
+		}
+
+		static bool IsTrivialDigit(const long* histogram, long count)
+		{
+			for (int bucket = 0; bucket < RadixBuckets; bucket++) {
+				if (histogram[bucket])
+					return histogram[bucket] == count;
+			}
+			return true;
+		}
+	};
+
+	template<typename T, typename K>
+	static void RadixSortRange(T* data, long count, const K& key)
+	{
+		typedef RadixPass<T, K> Pass;
+
+		std::vector<long> histograms(Pass::Digits * RadixBuckets);
+		Pass::Histogram(data, data + count, key, &histograms[0]);
+
+		std::vector<T> buffer;
+		T* source = data;
+		T* destination = NULL;
+		for (int digit = 0; digit < Pass::Digits; digit++) {
+			long* histogram = &histograms[digit * RadixBuckets];
+			if (Pass::IsTrivialDigit(histogram, count))
+				continue;
+
+			if (!destination) {
+				buffer.resize(count);
+				destination = &buffer[0];
+			}
+
+			long offset = 0;
+			for (int bucket = 0; bucket < RadixBuckets; bucket++) {
+				long size = histogram[bucket];
+				histogram[bucket] = offset;
+				offset += size;
+			}
+			Pass::Scatter(source, source + count, key, digit, histogram, destination);
+			std::swap(source, destination);
+		}
+
+		if (source != data)
+			std::copy(source, source + count, data);
+	}
+
+	struct RadixRangeSorter
+	{
+		template<typename T, typename K> void operator ()(T* data, long count, const K& key) const { RadixSortRange(data, count, key); }
+	};
+
+	// Sorts by a key extracted once per element. Entries carry the original index, so the LSD passes only move
+	// (key, index) pairs and the elements themselves are gathered into place at the end.
+	template<typename TKey, typename T, typename F, typename S>
+	static void RadixSortKeys(T* data, long count, const F& extract, const S& sorter)
+	{
+		typedef RadixKey<TKey> Traits;
+		typedef typename Traits::Type B;
+
+		if (count < 2)
+			return;
+
+		std::vector<RadixEntry<B> > entries(count);
+		std::vector<TKey> keys;
+		if (!Traits::Exact)
+			keys.reserve(count);
+		for (long i = 0; i < count; i++) {
+			TKey key = extract(data[i]);
+			entries[i].key = Traits::Bits(key);
+			entries[i].index = i;
+			if (!Traits::Exact)
+				keys.push_back(key);
+		}
+
+		sorter(&entries[0], count, RadixEntryKey<B>());
+
+		if (!Traits::Exact) {
+			for (long i = 0; i < count;) {
+				long end = i + 1;
+				while (end < count && entries[end].key == entries[i].key)
+					end++;
+				if (end - i > 1)
+					std::stable_sort(&entries[i], &entries[end], RadixEntryLess<TKey, B>(&keys[0]));
+				i = end;
+			}
+		}
+
+		std::vector<T> sorted;
+		sorted.reserve(count);
+		for (long i = 0; i < count; i++)
+			sorted.push_back(data[entries[i].index]);
+		std::copy(sorted.begin(), sorted.end(), data);
+	}
+
+	template<typename T> struct RadixIdentity
+	{
+		const T& operator ()(const T& value) const { return value; }
+	};
+
+	template<typename T, bool Exact = RadixKey<T>::Exact> struct RadixValueSorter
+	{
+		template<typename S> static void Sort(T* data, long count, const S& sorter) { sorter(data, count, RadixValueKey<T>()); }
+	};
+
+	template<typename T> struct RadixValueSorter<T, false>
+	{
+		template<typename S> static void Sort(T* data, long count, const S& sorter) { RadixSortKeys<T>(data, count, RadixIdentity<T>(), sorter); }
+	};
+} } }
@@ -0,0 +1,235 @@
+#pragma once
+
+#include "bricks/collections/list.h"
+#include "bricks/collections/comparison.h"
+#include "bricks/core/math.h"
+
+#include <new>
+#include <algorithm>
+
+namespace Bricks { namespace Collections {
+	template<typename T, int N> class SmallArray;
+
+	namespace Internal {
+		template<typename T>
+		class SmallArrayIterator : public Iterator<T>
+		{
+			private:
+				T* position;
+				T* end;
+
+			public:
+				SmallArrayIterator(T* begin, T* end) : position(begin - 1), end(end) { }
+				T& GetCurrent() const { return *position; }
+				bool MoveNext() { return ++position < end; }
+		};
+	}
+
+	// An array that keeps its first N items inline and only moves them to the heap once it outgrows them.
+	// Without an explicit comparison, items are compared with their own operators.
+	template<typename T, int N>
+	class SmallArray : public Object, public List<T>, public IterableFast<Internal::SmallArrayIterator<T> >
+	{
+	private:
+		union Storage {
+			char data[N * sizeof(T)];
+			long double alignDouble;
+			s64 alignInteger;
+			void* alignPointer;
+		};
+
+		AutoPointer<ValueComparison<T> > comparison;
+		Storage storage;
+		T* data;
+		long count;
+		long capacity;
+
+		T* GetInline() { return reinterpret_cast<T*>(storage.data); }
+		bool IsInline() const { return data == reinterpret_cast<const T*>(storage.data); }
+
+		void Relocate(T* storage, long size)
+		{
+			Internal::CopyConstructItems(storage, data, count);
+			for (long i = 0; i < count; i++)
+				data[i].~T();
+			if (!IsInline())
+				::operator delete(data);
+			data = storage;
+			capacity = size;
+		}
+
+		void Grow(long minimum)
+		{
+			long size = Math::Max(capacity * 2, minimum);
+			Relocate(static_cast<T*>(::operator new(size * sizeof(T))), size);
+		}
+
+		bool Contains(const T* values) const { return values >= data && values < data + count; }
+
+		void Destroy()
+		{
+			for (long i = 0; i < count; i++)
+				data[i].~T();
+			count = 0;
+		}
+
+		long IndexOfItem(const T& value, ValueComparison<T>* compare) const
+		{
+			for (long i = 0; i < count; i++) {
+				if (!compare->Compare(data[i], value))
+					return i;
+			}
+			return -1;
+		}
+
+		long FindItem(const T& value) const
+		{
+			if (comparison)
+				return IndexOfItem(value, comparison);
+			OperatorValueComparison<T> compare;
+			return IndexOfItem(value, &compare);
+		}
+
+	public:
+		SmallArray(ValueComparison<T>* comparison = NULL) : comparison(comparison), data(GetInline()), count(0), capacity(N) { }
+		SmallArray(const SmallArray<T, N>& array, ValueComparison<T>* comparison = NULL) : comparison(comparison ?: array.comparison.GetValue()), data(GetInline()), count(0), capacity(N) { AddRange(array.data, array.count); }
+		SmallArray(Iterable<T>* iterable, ValueComparison<T>* comparison = NULL) : comparison(comparison), data(GetInline()), count(0), capacity(N) { AddItems(iterable); }
+		~SmallArray() { Destroy(); if (!IsInline()) ::operator delete(data); }
+
+		SmallArray& operator =(const SmallArray<T, N>& array)
+		{
+			if (&array != this) {
+				Destroy();
+				comparison = array.comparison;
+				AddRange(array.data, array.count);
+			}
+			return *this;
+		}
+
+		// Iterator
+		virtual ReturnPointer<Iterator<T> > GetIterator() const { return autonew Internal::SmallArrayIterator<T>(data, data + count); }
+		Internal::SmallArrayIterator<T> GetIteratorFast() const { return Internal::SmallArrayIterator<T>(data, data + count); }
+		virtual const T* GetContiguousItems(long& count) const { count = this->count; return GetData(); }
+
+		// Collection
+		virtual long GetCount() const { return count; }
+
+		virtual bool ContainsItem(const T& value) const { return FindItem(value) >= 0; }
+
+		virtual void AddItem(const T& value)
+		{
+			if (count == capacity) {
+				T copy(value);
+				Grow(count + 1);
+				::new (data + count) T(copy);
+			} else
+				::new (data + count) T(value);
+			count++;
+		}
+		virtual void AddRange(const T* values, long size)
+		{
+			if (Contains(values)) {
+				SmallArray<T, N> copy;
+				copy.AddRange(values, size);
+				AddRange(copy.data, size);
+				return;
+			}
+			Reserve(count + size);
+			Internal::CopyConstructItems(data + count, values, size);
+			count += size;
+		}
+		virtual bool RemoveItem(const T& value)
+		{
+			long index = FindItem(value);
+			if (index < 0)
+				return false;
+			RemoveItemAt(index);
+			return true;
+		}
+
+		virtual void Clear() { Destroy(); }
+
+		// List
+		virtual void SetItem(long index, const T& value) { data[index] = value; }
+		virtual const T& GetItem(long index) const { return data[index]; }
+		virtual T& GetItem(long index) { return data[index]; }
+		virtual long IndexOfItem(const T& value) const { return FindItem(value); }
+
+		virtual void InsertItem(long index, const T& value)
+		{
+			if (index == count) {
+				AddItem(value);
+				return;
+			}
+			T copy(value);
+			AddItem(data[count - 1]);
+			std::copy_backward(data + index, data + count - 2, data + count - 1);
+			data[index] = copy;
+		}
+		virtual void InsertRange(long index, const T* values, long size)
+		{
+			if (Contains(values)) {
+				SmallArray<T, N> copy;
+				copy.AddRange(values, size);
+				InsertRange(index, copy.data, size);
+				return;
+			}
+			Reserve(count + size);
+			for (long i = count + size - 1; i >= index + size; i--) {
+				if (i >= count)
+					::new (data + i) T(data[i - size]);
+				else
+					data[i] = data[i - size];
+			}
+			for (long i = 0; i < size; i++) {
+				if (index + i >= count)
+					::new (data + index + i) T(values[i]);
+				else
+					data[index + i] = values[i];
+			}
+			count += size;
+		}
+		virtual void RemoveItemAt(long index)
+		{
+			std::copy(data + index + 1, data + count, data + index);
+			data[--count].~T();
+		}
+
+		ValueComparison<T>* GetComparison() const { return comparison; }
+
+		T* GetData() { return count ? data : NULL; }
+		const T* GetData() const { return count ? data : NULL; }
+
+		virtual long GetCapacity() const { return capacity; }
+		bool IsSpilled() const { return !IsInline(); }
+		virtual void Reserve(long size) { if (size > capacity) Grow(size); }
+		// Moves the items back inline if they fit, or trims the heap allocation to the current count.
+		virtual void ShrinkToFit()
+		{
+			if (IsInline() || count == capacity)
+				return;
+			if (count <= N)
+				Relocate(GetInline(), N);
+			else
+				Relocate(static_cast<T*>(::operator new(count * sizeof(T))), count);
+		}
+
+		void Sort(ValueComparison<T>* sortComparison = NULL)
+		{
+			ValueComparison<T>* sortWith = sortComparison ?: comparison.GetValue();
+			if (!sortWith || Internal::IsOperatorComparison(sortWith))
+				std::sort(data, data + count, Internal::OperatorLess<T>());
+			else
+				std::sort(data, data + count, Internal::ComparisonLess<T>(sortWith));
+		}
+
+		void StableSort(ValueComparison<T>* sortComparison = NULL)
+		{
+			ValueComparison<T>* sortWith = sortComparison ?: comparison.GetValue();
+			if (!sortWith || Internal::IsOperatorComparison(sortWith))
+				std::stable_sort(data, data + count, Internal::OperatorLess<T>());
+			else
+				std::stable_sort(data, data + count, Internal::ComparisonLess<T>(sortWith));
+		}
+	};
+} }
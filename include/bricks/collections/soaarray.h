@@ -0,0 +1,216 @@
+#pragma once
+
+#include "bricks/core/object.h"
+#include "bricks/core/copypointer.h"
+#include "bricks/core/math.h"
+#include "bricks/collections/collection.h"
+
+#include <new>
+#include <algorithm>
+
+namespace Bricks { namespace Collections {
+	namespace Internal {
+		// Fills the unused field slots of an SoAArray; its columns take no storage and ignore every operation.
+		struct SoANone { };
+
+		template<int I, typename T0, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7>
+		struct SoAFieldType { typedef typename SoAFieldType<I - 1, T1, T2, T3, T4, T5, T6, T7, SoANone>::Type Type; };
+		template<typename T0, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7>
+		struct SoAFieldType<0, T0, T1, T2, T3, T4, T5, T6, T7> { typedef T0 Type; };
+
+		template<typename T> struct SoAIsField { static const int Value = 1; };
+		template<> struct SoAIsField<SoANone> { static const int Value = 0; };
+
+		// One field's items, kept contiguous at a fixed alignment so column kernels can use aligned vector loads.
+		template<typename T>
+		class SoAColumn
+		{
+		protected:
+			void* allocation;
+			T* data;
+			void* previousAllocation;
+			T* previousData;
+
+		public:
+			static const size_t Alignment = 32;
+
+			SoAColumn() : allocation(NULL), data(NULL), previousAllocation(NULL), previousData(NULL) { }
+
+			T* GetData() const { return data; }
+
+			// Copies the items into new storage but keeps the old items alive until Release, so values that refer into them
+			// can still be read meanwhile.
+			void Resize(long count, long capacity)
+			{
+				void* resizedAllocation = ::operator new(capacity * sizeof(T) + Alignment - 1);
+				T* resized = reinterpret_cast<T*>(((size_t)resizedAllocation + Alignment - 1) & ~(Alignment - 1));
+				CopyConstructItems(resized, data, count);
+				previousAllocation = allocation;
+				previousData = data;
+				allocation = resizedAllocation;
+				data = resized;
+			}
+
+			void Release(long count)
+			{
+				for (long i = 0; i < count; i++)
+					previousData[i].~T();
+				::operator delete(previousAllocation);
+				previousAllocation = NULL;
+				previousData = NULL;
+			}
+
+			void Free() { ::operator delete(allocation); allocation = NULL; data = NULL; }
+
+			void Construct(long index, const T& value) { ::new (data + index) T(value); }
+			void Destroy(long index, long count) { for (long i = index; i < index + count; i++) data[i].~T(); }
+			void Remove(long index, long count) { std::copy(data + index + 1, data + count, data + index); data[count - 1].~T(); }
+		};
+
+		template<>
+		class SoAColumn<SoANone>
+		{
+		public:
+			SoANone* GetData() const { return NULL; }
+			void Resize(long count, long capacity) { }
+			void Release(long count) { }
+			void Free() { }
+			void Construct(long index, const SoANone& value) { }
+			void Destroy(long index, long count) { }
+			void Remove(long index, long count) { }
+		};
+
+		// Column members are laid out by field index; reaching one by a compile-time index goes through these accessors.
+		template<int I, typename TArray> struct SoAColumnOf;
+#define BRICKS_SOA_COLUMN_OF(n) \
+		template<typename TArray> struct SoAColumnOf<n, TArray> { static SoAColumn<typename TArray::template Field<n>::Type>& Get(TArray& array) { return array.column ## n; } };
+		BRICKS_SOA_COLUMN_OF(0) BRICKS_SOA_COLUMN_OF(1) BRICKS_SOA_COLUMN_OF(2) BRICKS_SOA_COLUMN_OF(3)
+		BRICKS_SOA_COLUMN_OF(4) BRICKS_SOA_COLUMN_OF(5) BRICKS_SOA_COLUMN_OF(6) BRICKS_SOA_COLUMN_OF(7)
+#undef BRICKS_SOA_COLUMN_OF
+	}
+
+	// A contiguous view of one SoAArray column. It stays valid until the array is resized.
+	template<typename T>
+	struct SoASpan
+	{
+		T* data;
+		long count;
+
+		SoASpan(T* data, long count) : data(data), count(count) { }
+
+		T& operator [](long index) const { return data[index]; }
+		T* begin() const { return data; }
+		T* end() const { return data + count; }
+	};
+
+	template<typename T0, typename T1 = Internal::SoANone, typename T2 = Internal::SoANone, typename T3 = Internal::SoANone, typename T4 = Internal::SoANone, typename T5 = Internal::SoANone, typename T6 = Internal::SoANone, typename T7 = Internal::SoANone>
+	class SoAArray;
+
+	// A list of records stored as one aligned, contiguous column per field (structure of arrays), for up to eight fields.
+	// Rows are reached through a lightweight proxy; whole columns are exposed as spans for loops that touch a single field.
+	template<typename T0, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7>
+	class SoAArray : public Object, NoCopy
+	{
+	public:
+		template<int I>
+		struct Field { typedef typename Internal::SoAFieldType<I, T0, T1, T2, T3, T4, T5, T6, T7>::Type Type; };
+
+		static const int FieldCount = Internal::SoAIsField<T0>::Value + Internal::SoAIsField<T1>::Value + Internal::SoAIsField<T2>::Value + Internal::SoAIsField<T3>::Value +
+			Internal::SoAIsField<T4>::Value + Internal::SoAIsField<T5>::Value + Internal::SoAIsField<T6>::Value + Internal::SoAIsField<T7>::Value;
+
+		class Row
+		{
+		protected:
+			SoAArray* array;
+			long index;
+
+		public:
+			Row(SoAArray* array, long index) : array(array), index(index) { }
+
+			long GetIndex() const { return index; }
+
+			template<int I> typename Field<I>::Type& Get() const { return array->template GetColumnData<I>()[index]; }
+			template<int I> void Set(const typename Field<I>::Type& value) const { this->template Get<I>() = value; }
+		};
+
+	protected:
+		Internal::SoAColumn<T0> column0;
+		Internal::SoAColumn<T1> column1;
+		Internal::SoAColumn<T2> column2;
+		Internal::SoAColumn<T3> column3;
+		Internal::SoAColumn<T4> column4;
+		Internal::SoAColumn<T5> column5;
+		Internal::SoAColumn<T6> column6;
+		Internal::SoAColumn<T7> column7;
+		long count;
+		long capacity;
+
+		static const long MinimumCapacity = 8;
+
+		template<int I, typename TArray> friend struct Internal::SoAColumnOf;
+
+		void Resize(long size)
+		{
+			column0.Resize(count, size); column1.Resize(count, size); column2.Resize(count, size); column3.Resize(count, size);
+			column4.Resize(count, size); column5.Resize(count, size); column6.Resize(count, size); column7.Resize(count, size);
+			capacity = size;
+		}
+
+		void Release(long count)
+		{
+			column0.Release(count); column1.Release(count); column2.Release(count); column3.Release(count);
+			column4.Release(count); column5.Release(count); column6.Release(count); column7.Release(count);
+		}
+
+		void Destroy()
+		{
+			column0.Destroy(0, count); column1.Destroy(0, count); column2.Destroy(0, count); column3.Destroy(0, count);
+			column4.Destroy(0, count); column5.Destroy(0, count); column6.Destroy(0, count); column7.Destroy(0, count);
+			count = 0;
+		}
+
+	public:
+		SoAArray() : count(0), capacity(0) { }
+		~SoAArray()
+		{
+			Destroy();
+			column0.Free(); column1.Free(); column2.Free(); column3.Free();
+			column4.Free(); column5.Free(); column6.Free(); column7.Free();
+		}
+
+		long GetCount() const { return count; }
+		long GetCapacity() const { return capacity; }
+		void Reserve(long size) { if (size > capacity) { Resize(size); Release(count); } }
+
+		// Appends a row, leaving any fields that aren't given default-constructed.
+		long AddItem(const T0& value0 = T0(), const T1& value1 = T1(), const T2& value2 = T2(), const T3& value3 = T3(), const T4& value4 = T4(), const T5& value5 = T5(), const T6& value6 = T6(), const T7& value7 = T7())
+		{
+			// The values may refer into the array, so the old columns are only released once the row is built.
+			bool resized = count == capacity;
+			if (resized)
+				Resize(capacity ? capacity * 2 : MinimumCapacity);
+			column0.Construct(count, value0); column1.Construct(count, value1); column2.Construct(count, value2); column3.Construct(count, value3);
+			column4.Construct(count, value4); column5.Construct(count, value5); column6.Construct(count, value6); column7.Construct(count, value7);
+			if (resized)
+				Release(count);
+			return count++;
+		}
+
+		void RemoveItemAt(long index)
+		{
+			column0.Remove(index, count); column1.Remove(index, count); column2.Remove(index, count); column3.Remove(index, count);
+			column4.Remove(index, count); column5.Remove(index, count); column6.Remove(index, count); column7.Remove(index, count);
+			count--;
+		}
+
+		void Clear() { Destroy(); }
+
+		Row GetRow(long index) { return Row(this, index); }
+		Row operator [](long index) { return Row(this, index); }
+
+		template<int I> typename Field<I>::Type* GetColumnData() { return Internal::SoAColumnOf<I, SoAArray>::Get(*this).GetData(); }
+		template<int I> const typename Field<I>::Type* GetColumnData() const { return Internal::SoAColumnOf<I, SoAArray>::Get(const_cast<SoAArray&>(*this)).GetData(); }
+		template<int I> SoASpan<typename Field<I>::Type> GetColumn() { return SoASpan<typename Field<I>::Type>(GetColumnData<I>(), count); }
+		template<int I> SoASpan<const typename Field<I>::Type> GetColumn() const { return SoASpan<const typename Field<I>::Type>(GetColumnData<I>(), count); }
+	};
+} }
@@ -17,10 +17,11 @@ namespace Bricks { namespace Collections {
 		Stack(const Stack<T>& stack, ValueComparison<T>* comparison = autonew OperatorValueComparison< T >()) : Deque<T>(stack, comparison) { }
 		Stack(Iterable<T>* iterable, ValueComparison<T>* comparison = autonew OperatorValueComparison<T>()) : Deque<T>(iterable, comparison) { }
 
-		virtual void Push(const T& value) { this->queue.push_front(value); }
-		virtual void Pop() { if (this->queue.empty()) BRICKS_FEATURE_RELEASE_THROW(QueueEmptyException()); this->queue.pop_front(); }
-		virtual T PopItem() { if (this->queue.empty()) BRICKS_FEATURE_RELEASE_THROW(QueueEmptyException()); T value = this->queue.front(); this->queue.pop_front(); return value; }
-		virtual T& Peek() { if (this->queue.empty()) BRICKS_FEATURE_RELEASE_THROW(QueueEmptyException()); return this->queue.front(); }
-		virtual const T& Peek() const { if (this->queue.empty()) BRICKS_FEATURE_RELEASE_THROW(QueueEmptyException()); return this->queue.front(); }
+		virtual void Push(const T& value) { this->PushFront(value); }
+		virtual void PushRange(const T* values, long size) { this->Reserve(this->count + size); for (long i = 0; i < size; i++) this->PushFront(values[i]); }
+		virtual void Pop() { this->PopFront(); }
+		virtual T PopItem() { T value = this->Front(); this->PopFront(); return value; }
+		virtual T& Peek() { return this->Front(); }
+		virtual const T& Peek() const { return this->Front(); }
 	};
 } }
@@ -4,5 +4,6 @@
 #include "bricks.hpp"
 
 #include "bricks/compression/zipfilesystem.h"
+#include "bricks/compression/deflatestream.h"
 
 #endif
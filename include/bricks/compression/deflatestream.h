@@ -0,0 +1,138 @@
+#pragma once
+
+#include "bricks/core/object.h"
+#include "bricks/core/exception.h"
+#include "bricks/core/autopointer.h"
+#include "bricks/core/copypointer.h"
+#include "bricks/io/stream.h"
+
+#include <map>
+#include <vector>
+
+struct z_stream_s;
+
+namespace Bricks { namespace Threading { class Mutex; } }
+
+namespace Bricks { namespace Compression {
+
+#if BRICKS_CONFIG_COMPRESSION_ZLIB
+	namespace DeflateFormat { enum Enum {
+		// Bare deflate data with no header or checksum.
+		Raw = 0,
+		// A two byte header and an Adler-32 trailer (RFC 1950).
+		Zlib,
+		// A gzip member header and a CRC-32 trailer (RFC 1952).
+		Gzip,
+		// Inflating only: zlib or gzip, whichever the header says.
+		Automatic
+	}; }
+
+	class ZlibException : public Exception
+	{
+	protected:
+		int error;
+
+	public:
+		ZlibException(int error, const String& message = String::Empty) : Exception(message), error(error) { }
+
+		int GetErrorCode() const { return error; }
+	};
+
+	// Keeps freed blocks by size for reuse. Deflate and inflate streams allocate their I/O buffers and all of zlib's internal
+	// state from a pool, so opening a stream with the same settings as one already closed allocates nothing.
+	class DeflateBufferPool : public Object, NoCopy
+	{
+	protected:
+		AutoPointer<Threading::Mutex> lock;
+		std::map<size_t, std::vector<u8*> > buffers;
+		size_t retained;
+		size_t limit;
+
+	public:
+		// Blocks released beyond limit bytes of retained memory are freed instead.
+		DeflateBufferPool(size_t limit = 0x1000000);
+		~DeflateBufferPool();
+
+		static DeflateBufferPool* GetDefault();
+
+		void* Acquire(size_t size);
+		void Release(void* buffer);
+
+		size_t GetRetainedSize() const { return retained; }
+	};
+
+	// Compresses everything written to it into another stream. The compressed data is only complete once Finish is called
+	// or the stream is destroyed; Flush ends the current deflate block so a reader can decode everything written so far.
+	// Destroying an unfinished stream finishes it but loses any error doing so, so call Finish to see them.
+	class DeflateStream : public IO::Stream, NoCopy
+	{
+	protected:
+		AutoPointer<IO::Stream> stream;
+		AutoPointer<DeflateBufferPool> pool;
+		z_stream_s* zstream;
+		u8* buffer;
+		size_t bufferSize;
+		bool finished;
+
+		void Deflate(int flush);
+
+	public:
+		// level runs from 0 (stored) to 9 (smallest), or -1 for zlib's default; windowBits from 9 to 15 sets a window of
+		// 2^windowBits bytes, which the inflating side must match or exceed.
+		DeflateStream(IO::Stream* stream, DeflateFormat::Enum format = DeflateFormat::Zlib, int level = -1, int windowBits = 15, size_t bufferSize = 0x10000, DeflateBufferPool* pool = NULL);
+		~DeflateStream();
+
+		void Finish();
+		bool IsFinished() const { return finished; }
+
+		u64 GetUncompressedSize() const;
+		u64 GetCompressedSize() const;
+
+		size_t Read(void* buffer, size_t size) { BRICKS_FEATURE_THROW(NotSupportedException()); }
+		size_t Write(const void* buffer, size_t size);
+		u64 GetLength() const { return GetUncompressedSize(); }
+		void SetLength(u64 length) { BRICKS_FEATURE_THROW(NotSupportedException()); }
+		u64 GetPosition() const { return GetUncompressedSize(); }
+		void SetPosition(u64 position) { BRICKS_FEATURE_THROW(NotSupportedException()); }
+		void Flush();
+		bool CanSeek() const { return false; }
+		bool CanRead() const { return false; }
+	};
+
+	// Decompresses another stream as it is read. The source is read a buffer at a time; once the compressed data ends, a
+	// seekable source is moved back to just past it. The length is not known in advance, so GetLength reports the bytes
+	// decoded so far, and only equals the position once the data has ended.
+	class InflateStream : public IO::Stream, NoCopy
+	{
+	protected:
+		AutoPointer<IO::Stream> stream;
+		AutoPointer<DeflateBufferPool> pool;
+		z_stream_s* zstream;
+		u8* input;
+		u8* output;
+		size_t bufferSize;
+		const u8* outputCursor;
+		const u8* outputEnd;
+		u64 position;
+		bool finished;
+
+		size_t Inflate(void* buffer, size_t size);
+		void FillOutput();
+
+	public:
+		InflateStream(IO::Stream* stream, DeflateFormat::Enum format = DeflateFormat::Automatic, int windowBits = 15, size_t bufferSize = 0x10000, DeflateBufferPool* pool = NULL);
+		~InflateStream();
+
+		bool IsFinished() const { return finished && outputCursor == outputEnd; }
+
+		size_t Read(void* buffer, size_t size);
+		size_t Write(const void* buffer, size_t size) { BRICKS_FEATURE_THROW(NotSupportedException()); }
+		u64 GetLength() const;
+		void SetLength(u64 length) { BRICKS_FEATURE_THROW(NotSupportedException()); }
+		u64 GetPosition() const { return position; }
+		void SetPosition(u64 position) { BRICKS_FEATURE_THROW(NotSupportedException()); }
+		bool CanSeek() const { return false; }
+		bool CanWrite() const { return false; }
+	};
+#endif
+} }
@@ -23,6 +23,9 @@ namespace Bricks {
 
 		~Data();
 
+		// Takes ownership of a buffer allocated with new u8[], which may be larger than length.
+		void Adopt(u8* value, size_t length);
+
 		void CopyFrom(const void* value, size_t len, size_t offset = 0);
 		void CopyFrom(const Data& value, size_t offset = 0);
 
@@ -23,6 +23,8 @@ namespace Bricks {
 		TypeInfo& operator =(const TypeInfo& rhs) { type = rhs.type; return *this; }
 
 		String GetName() const { return type->name(); }
+		// Identifies the type for hashing. Equal types in different shared objects may still have different addresses.
+		const std::type_info* GetTypeID() const { return type; }
 
 		template<typename T> static TypeInfo OfType() { return typeid(T); }
 
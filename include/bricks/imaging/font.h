@@ -3,7 +3,7 @@
 #include "bricks/core/returnpointer.h"
 #include "bricks/core/string.h"
 #include "bricks/imaging/image.h"
-#include "bricks/collections/dictionary.h"
+#include "bricks/collections/cache.h"
 
 namespace Bricks { namespace Imaging {
 	class FontGlyph;
@@ -31,17 +31,21 @@ namespace Bricks { namespace Imaging {
 	class Font : public Object
 	{
 	protected:
-		Collections::Dictionary<String::Character, AutoPointer<FontGlyph> > glyphCache;
+		static const size_t DefaultCacheBudget = 0x400000;
+
+		Collections::Cache<String::Character, AutoPointer<FontGlyph> > glyphCache;
 		u32 width;
 		u32 height;
 
 		virtual ReturnPointer<FontGlyph> LoadGlyph(String::Character character) = 0;
 		virtual ReturnPointer<Image> RenderGlyph(FontGlyph* glyph) = 0;
 
+		static size_t GlyphCost(const String::Character& character, const AutoPointer<FontGlyph>& glyph);
+
 		friend class FontGlyph;
 
 	public:
-		Font() : width(0), height(0) { }
+		Font() : glyphCache(DefaultCacheBudget), width(0), height(0) { glyphCache.SetCostDelegate(&GlyphCost); }
 
 		virtual void SetPixelSize(int pixelWidth, int pixelHeight = 0) { width = pixelWidth; height = pixelHeight ?: pixelWidth; }
 		virtual void SetPointSize(int pointWidth, int pointHeight = 0, int dpiWidth = 0, int dpiHeight = 0) { width = pointWidth; height = pointHeight ?: pointWidth; }
@@ -57,7 +61,10 @@ namespace Bricks { namespace Imaging {
 		ReturnPointer<Image> DrawString(const String& value, FontAlignment::Enum alignment = FontAlignment::Left);
 
 		void ClearCache() { glyphCache.Clear(); }
-		ReturnPointer<FontGlyph> GetGlyph(String::Character character, bool cache = true) { if (glyphCache.ContainsKey(character)) return glyphCache[character]; AutoPointer<FontGlyph> glyph = LoadGlyph(character); if (cache) glyphCache.Add(character, glyph); return glyph; }
+		// Glyphs are charged for their rendered RGBA size whether or not they have been drawn yet.
+		void SetCacheBudget(size_t budget) { glyphCache.SetBudget(budget); }
+		const Collections::CacheStatistics& GetCacheStatistics() const { return glyphCache.GetStatistics(); }
+		ReturnPointer<FontGlyph> GetGlyph(String::Character character, bool cache = true) { AutoPointer<FontGlyph> glyph; if (glyphCache.TryGetItem(character, glyph)) return glyph; glyph = LoadGlyph(character); if (cache) glyphCache.Add(character, glyph); return glyph; }
 
 		virtual s32 GetKerning(FontGlyph* glyph, FontGlyph* previous) { return 0; }
 	};
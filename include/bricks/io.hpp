@@ -15,6 +15,10 @@
 #include "bricks/io/filenode.h"
 #include "bricks/io/filesystem.h"
 #include "bricks/io/filestream.h"
+#include "bricks/io/filemapping.h"
+#include "bricks/io/mappedfilestream.h"
+#include "bricks/io/mappedarray.h"
+#include "bricks/io/asyncfilesystem.h"
 
 #include "bricks/io/endian.h"
 #include "bricks/io/streamnavigator.h"
@@ -24,5 +28,8 @@
 #include "bricks/io/console.h"
 
 #include "bricks/io/serializer.h"
+#include "bricks/io/serializationreader.h"
+#include "bricks/io/serializationwriter.h"
+#include "bricks/io/serializationview.h"
 
 #endif
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "bricks/core/object.h"
+#include "bricks/core/autopointer.h"
+#include "bricks/core/copypointer.h"
+#include "bricks/core/delegate.h"
+#include "bricks/core/returnpointer.h"
+#include "bricks/io/filestream.h"
+
+#include <vector>
+
+namespace Bricks { namespace Threading { class Mutex; class Condition; } }
+
+namespace Bricks { namespace IO {
+	class AsyncFilesystem;
+
+	namespace Internal { class AsyncEngineBase; }
+
+	namespace AsyncEngine { enum Enum {
+		// io_uring where the kernel allows it, worker threads otherwise.
+		Automatic = 0,
+		Uring,
+		Threads
+	}; }
+
+	// One positional read or write. The delegate runs on an I/O thread before Wait returns, so it must not retain the request.
+	class AsyncRequest : public Object, NoCopy
+	{
+	public:
+		typedef Delegate<void(AsyncRequest*)> CompletionDelegate;
+
+	protected:
+		AsyncFilesystem* owner;
+		CompletionDelegate delegate;
+		FileHandle handle;
+		IOVector vector;
+		u64 offset;
+		bool write;
+		volatile bool submitted;
+		volatile bool completed;
+		s64 result;
+
+		friend class AsyncFilesystem;
+		friend class Internal::AsyncEngineBase;
+
+	public:
+		AsyncRequest(AsyncFilesystem* owner, FileHandle handle, const IOVector& vector, u64 offset, bool write, const CompletionDelegate& delegate);
+
+		FileHandle GetHandle() const { return handle; }
+		void* GetBuffer() const { return vector.data; }
+		size_t GetSize() const { return vector.size; }
+		u64 GetOffset() const { return offset; }
+		bool IsWrite() const { return write; }
+
+		bool IsCompleted() const { return completed; }
+		// Bytes transferred, or zero if the request failed.
+		size_t GetResult() const { return result > 0 ? result : 0; }
+		// The errno the request failed with, or zero.
+		int GetError() const { return result < 0 ? -result : 0; }
+
+		// Blocks until the request completes, submitting it first if it is still batched. Throws ErrnoException on failure.
+		size_t Wait();
+	};
+
+	// Positional file I/O that completes in the background: io_uring with batched submission on Linux, or a pool of
+	// worker threads making blocking calls anywhere else. Buffers must stay valid until their request completes.
+	// Object reference counts are not atomic, so the filesystem only releases its references to finished requests when the
+	// next request is queued and when it is destroyed. Requests must be queued from one thread at a time, the thread that
+	// holds them; Wait may be called from any thread.
+	class AsyncFilesystem : public Object, NoCopy
+	{
+	protected:
+		AutoPointer<Filesystem> filesystem;
+		AutoPointer<Internal::AsyncEngineBase> engine;
+		AutoPointer<Threading::Mutex> submitLock;
+		AutoPointer<Threading::Condition> completion;
+		std::vector<AsyncRequest*> pending;
+		std::vector<AsyncRequest*> finished;
+		int batchDepth;
+
+		ReturnPointer<AsyncRequest> Queue(FileHandle handle, const IOVector& vector, u64 offset, bool write, const AsyncRequest::CompletionDelegate& delegate);
+		void ReleaseFinished();
+		void Finish(AsyncRequest* request, s64 result);
+
+		friend class AsyncRequest;
+		friend class Internal::AsyncEngineBase;
+
+	public:
+		// queueDepth sizes the io_uring submission ring, or the number of worker threads (at most 64).
+		AsyncFilesystem(Filesystem* filesystem = NULL, int queueDepth = 64, AsyncEngine::Enum engine = AsyncEngine::Automatic);
+		~AsyncFilesystem();
+
+		// Whether this kernel accepts io_uring at all; it may be compiled out or blocked by a sandbox.
+		static bool IsUringSupported();
+
+		AsyncEngine::Enum GetEngine() const;
+		Filesystem* GetFilesystem() const { return filesystem; }
+
+		ReturnPointer<AsyncRequest> Read(FileHandle handle, void* buffer, size_t size, u64 offset, const AsyncRequest::CompletionDelegate& delegate = AsyncRequest::CompletionDelegate());
+		ReturnPointer<AsyncRequest> Write(FileHandle handle, const void* buffer, size_t size, u64 offset, const AsyncRequest::CompletionDelegate& delegate = AsyncRequest::CompletionDelegate());
+
+		// Requests made inside a batch are held back and submitted together when the outermost batch ends.
+		void BeginBatch();
+		void EndBatch();
+		void Submit();
+	};
+
+	// A file stream position driven through an AsyncFilesystem. Each call starts a request at the current position and advances
+	// past it immediately, so sequential calls may be in flight together.
+	class AsyncStream : public Object, NoCopy
+	{
+	protected:
+		AutoPointer<FileStream> stream;
+		AutoPointer<AsyncFilesystem> filesystem;
+		u64 position;
+
+	public:
+		AsyncStream(FileStream* stream, AsyncFilesystem* filesystem) : stream(stream), filesystem(filesystem), position(stream->GetPosition()) { }
+
+		u64 GetPosition() const { return position; }
+		void SetPosition(u64 value) { position = value; }
+		u64 GetLength() const { return stream->GetLength(); }
+
+		FileStream* GetStream() const { return stream; }
+		AsyncFilesystem* GetFilesystem() const { return filesystem; }
+
+		ReturnPointer<AsyncRequest> Read(void* buffer, size_t size, const AsyncRequest::CompletionDelegate& delegate = AsyncRequest::CompletionDelegate()) { u64 offset = position; position += size; return ReadAt(offset, buffer, size, delegate); }
+		ReturnPointer<AsyncRequest> Write(const void* buffer, size_t size, const AsyncRequest::CompletionDelegate& delegate = AsyncRequest::CompletionDelegate()) { u64 offset = position; position += size; return WriteAt(offset, buffer, size, delegate); }
+		ReturnPointer<AsyncRequest> ReadAt(u64 offset, void* buffer, size_t size, const AsyncRequest::CompletionDelegate& delegate = AsyncRequest::CompletionDelegate()) { return filesystem->Read(stream->GetHandle(), buffer, size, offset, delegate); }
+		ReturnPointer<AsyncRequest> WriteAt(u64 offset, const void* buffer, size_t size, const AsyncRequest::CompletionDelegate& delegate = AsyncRequest::CompletionDelegate()) { return filesystem->Write(stream->GetHandle(), buffer, size, offset, delegate); }
+	};
+} }
@@ -1,35 +1,68 @@
 #pragma once
 
 #include "bricks/core/copypointer.h"
+#include "bricks/collections/cache.h"
 #include "bricks/io/stream.h"
 
+#include <vector>
+
 namespace Bricks { namespace IO {
+	// Caches an inner stream in fixed-size pages with least recently used eviction.
+	// Sequential reads trigger read-ahead that doubles with each consecutive miss. Writes stay in their pages until Flush,
+	// eviction or destruction writes them back; errors during destruction are lost, so call Flush to see them. The inner stream
+	// must not be used directly while it is wrapped.
 	class CacheStream : public Stream, NoCopy
 	{
 	private:
+		struct Page
+		{
+			u64 index;
+			u8* data;
+			u32 length;
+			bool valid;
+			bool dirty;
+			u64 lastUsed;
+		};
+
 		AutoPointer<Stream> stream;
 		u32 cacheSize;
+		u32 pageCount;
 		u64 position;
 		u64 length;
+		u64 streamPosition;
+		u64 streamLength;
 		u8* cache;
-		bool cacheDirty;
-		u32 cacheOffset;
-		u32 cacheLength;
-		u64 cachePosition;
+		std::vector<Page> pages;
+		u64 useCounter;
+		u64 lastPage;
+		u32 readAhead;
+		Collections::CacheStatistics statistics;
 
-		void FillCache();
-		void DirtyCache();
-		void FlushCache();
+		Page* FindPage(u64 index);
+		Page* AllocatePage(u64 index);
+		Page* GetPage(u64 index, bool fill, bool prefetch);
+		void FillPage(Page* page);
+		void PrefetchPages(u64 index);
+		void WritePage(Page* page);
+		void WritePages();
+		void SeekStream(u64 position);
+
+		static bool PageIndexLess(const Page* page1, const Page* page2) { return page1->index < page2->index; }
 
 	public:
-		CacheStream(Stream* stream, u32 cacheSize = 0x10000);
+		CacheStream(Stream* stream, u32 cacheSize = 0x10000, u32 pageCount = 8);
 		~CacheStream();
 
 		u32 GetCacheSize() { return cacheSize; }
+		u32 GetPageCount() { return pageCount; }
 		Stream* GetStream() { return stream; }
 
+		// Hits and misses count page lookups; evictions count pages dropped to make room.
+		const Collections::CacheStatistics& GetStatistics() const { return statistics; }
+		void ResetStatistics() { statistics = Collections::CacheStatistics(); }
+
 		u64 GetLength() const { return length; }
-		void SetLength(u64 value) { length = value; }
+		void SetLength(u64 value);
 		u64 GetPosition() const { return position; }
 		void SetPosition(u64 value) { position = value; }
 
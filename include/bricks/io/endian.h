@@ -4,6 +4,8 @@
 #include "bricks/core/pointer.h"
 #include "bricks/core/exception.h"
 
+#include <string.h>
+
 #if BRICKS_ENV_MINGW
 #include <sys/param.h>
 #endif
@@ -38,7 +40,7 @@ namespace Bricks { namespace IO {
 #else
 #define BRICKS_ENDIAN_SWAP16(num) \
 	((num << 8) | (num >> 8))
-#if __GNUC__ >= 4 && __GNUC_MINOR__ >= 3
+#if __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 3)
 #define BRICKS_ENDIAN_SWAP32(num) \
 	__builtin_bswap32(num)
 #define BRICKS_ENDIAN_SWAP64(num) \
@@ -65,18 +67,21 @@ namespace Bricks { namespace IO {
 	}
 	static inline bool IsBigEndian() { return !IsLittleEndian(); }
 
+// Buffers may hold fields at any alignment, so values are copied in and out rather than dereferenced.
 #define BRICKS_ENDIAN_CONVERT(bits) \
 	inline u##bits EndianConvertBE##bits(const void* data) { \
-		const u##bits* const src = CastToRaw<const u##bits>(data); \
+		u##bits value; \
+		memcpy(&value, data, sizeof(value)); \
 		if (IsBigEndian()) \
-			return *src; \
-		return BRICKS_ENDIAN_SWAP##bits(*src); \
+			return value; \
+		return BRICKS_ENDIAN_SWAP##bits(value); \
 	} \
 	inline u##bits EndianConvertLE##bits(const void* data) { \
-		const u##bits* const src = CastToRaw<const u##bits>(data); \
+		u##bits value; \
+		memcpy(&value, data, sizeof(value)); \
 		if (IsLittleEndian()) \
-			return *src; \
-		return BRICKS_ENDIAN_SWAP##bits(*src); \
+			return value; \
+		return BRICKS_ENDIAN_SWAP##bits(value); \
 	} \
 	template<typename T> \
 	inline T EndianConvert##bits(Endian::Enum endianness, const void* data) { \
@@ -87,10 +92,12 @@ namespace Bricks { namespace IO {
 		BRICKS_FEATURE_THROW(InvalidArgumentException()); \
 	} \
 	inline void EndianConvertBE##bits(void* dest, u##bits value) { \
-		*CastToRaw<u##bits>(dest) = IsBigEndian() ? value : BRICKS_ENDIAN_SWAP##bits(value); \
+		u##bits converted = IsBigEndian() ? value : BRICKS_ENDIAN_SWAP##bits(value); \
+		memcpy(dest, &converted, sizeof(converted)); \
 	} \
 	inline void EndianConvertLE##bits(void* dest, u##bits value) { \
-		*CastToRaw<u##bits>(dest) = IsLittleEndian() ? value : BRICKS_ENDIAN_SWAP##bits(value); \
+		u##bits converted = IsLittleEndian() ? value : BRICKS_ENDIAN_SWAP##bits(value); \
+		memcpy(dest, &converted, sizeof(converted)); \
 	} \
 	inline void EndianConvert##bits(Endian::Enum endianness, void* data, u##bits value) { \
 		if (endianness == Endian::BigEndian || (endianness == Endian::Native && IsBigEndian())) \
@@ -105,6 +112,56 @@ BRICKS_ENDIAN_CONVERT(32)
 BRICKS_ENDIAN_CONVERT(64)
 
 #undef BRICKS_ENDIAN_CONVERT
+
+	static inline bool EndianRequiresSwap(Endian::Enum endianness)
+	{
+		if (endianness == Endian::Native)
+			return false;
+		else if (endianness == Endian::BigEndian)
+			return IsLittleEndian();
+		else if (endianness == Endian::LittleEndian)
+			return IsBigEndian();
+		BRICKS_FEATURE_THROW(InvalidArgumentException());
+	}
+
+	namespace Internal {
+		// Resolves whether data in a given byte order needs swapping at compile time wherever the host order is known.
+		template<Endian::Enum E> struct EndianTraits { static bool RequiresSwap() { return EndianRequiresSwap(E); } };
+		template<> struct EndianTraits<Endian::Native> { static bool RequiresSwap() { return false; } };
+#if BRICKS_ENV_ENDIAN_LITTLE
+		template<> struct EndianTraits<Endian::LittleEndian> { static bool RequiresSwap() { return false; } };
+		template<> struct EndianTraits<Endian::BigEndian> { static bool RequiresSwap() { return true; } };
+#elif BRICKS_ENV_ENDIAN_BIG
+		template<> struct EndianTraits<Endian::LittleEndian> { static bool RequiresSwap() { return true; } };
+		template<> struct EndianTraits<Endian::BigEndian> { static bool RequiresSwap() { return false; } };
+#endif
+	}
+
+	// Reverses the bytes of count elements from src into dest, which may be the same buffer. Uses SSSE3 or AVX2 shuffles on
+	// processors that have them.
+	void EndianSwapArray16(void* dest, const void* src, size_t count);
+	void EndianSwapArray32(void* dest, const void* src, size_t count);
+	void EndianSwapArray64(void* dest, const void* src, size_t count);
+
+#define BRICKS_ENDIAN_CONVERT_ARRAY(bits) \
+	template<Endian::Enum E> inline void EndianConvertArray##bits(void* dest, const void* src, size_t count) { \
+		if (Internal::EndianTraits<E>::RequiresSwap()) \
+			EndianSwapArray##bits(dest, src, count); \
+		else if (dest != src) \
+			memmove(dest, src, count * sizeof(u##bits)); \
+	} \
+	inline void EndianConvertArray##bits(Endian::Enum endianness, void* dest, const void* src, size_t count) { \
+		if (EndianRequiresSwap(endianness)) \
+			EndianSwapArray##bits(dest, src, count); \
+		else if (dest != src) \
+			memmove(dest, src, count * sizeof(u##bits)); \
+	}
+
+BRICKS_ENDIAN_CONVERT_ARRAY(16)
+BRICKS_ENDIAN_CONVERT_ARRAY(32)
+BRICKS_ENDIAN_CONVERT_ARRAY(64)
+
+#undef BRICKS_ENDIAN_CONVERT_ARRAY
 #undef BRICKS_ENDIAN_SWAP16
 #undef BRICKS_ENDIAN_SWAP32
 #undef BRICKS_ENDIAN_SWAP64
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "bricks/core/object.h"
+#include "bricks/core/autopointer.h"
+#include "bricks/core/copypointer.h"
+#include "bricks/io/filesystem.h"
+
+namespace Bricks { namespace IO {
+	namespace MappingAdvice { enum Enum {
+		Normal = 0,
+		Sequential,
+		Random,
+		WillNeed,
+		DontNeed,
+		// Back the range with transparent huge pages where the kernel and filesystem allow it.
+		HugePages
+	}; }
+
+	// A shared mmap of a file opened through a PosixFilesystem. The handle stays owned by the caller.
+	// The mapped address may change whenever the mapping is resized.
+	class FileMapping : public Object, NoCopy
+	{
+	protected:
+		AutoPointer<Filesystem> filesystem;
+		FileHandle handle;
+		bool writable;
+		bool hugePageAligned;
+		void* data;
+		u64 length;
+
+		void* MapAligned(u64 length);
+
+	public:
+		FileMapping(Filesystem* filesystem, FileHandle handle, bool writable);
+		~FileMapping();
+
+		static bool IsSupported(Filesystem* filesystem);
+		static size_t GetPageSize();
+		static size_t GetHugePageSize();
+
+		void* GetData() const { return data; }
+		u64 GetLength() const { return length; }
+		bool IsWritable() const { return writable; }
+
+		// Places mappings of at least one huge page on a huge page boundary, so HugePages advice can take effect.
+		bool GetHugePageAlignment() const { return hugePageAligned; }
+		void SetHugePageAlignment(bool value) { hugePageAligned = value; }
+
+		// Maps the first length bytes of the file, replacing the current mapping. The file must already be at least that long.
+		void Map(u64 length);
+		void Unmap();
+
+		// Writes dirty pages in the range back to the file; a size of zero means the rest of the mapping.
+		void Sync(u64 offset = 0, u64 size = 0, bool wait = true);
+		void Advise(MappingAdvice::Enum advice, u64 offset = 0, u64 size = 0);
+	};
+} }
@@ -23,6 +23,10 @@ namespace Bricks { namespace IO {
 		~FileStream() { system->Close(handle); }
 		size_t Read(void* buffer, size_t size) { return system->Read(handle, buffer, size); }
 		size_t Write(const void* buffer, size_t size) { return system->Write(handle, buffer, size); }
+		size_t ReadVector(const IOVector* vectors, int count) { return system->ReadVector(handle, vectors, count); }
+		size_t WriteVector(const IOVector* vectors, int count) { return system->WriteVector(handle, vectors, count); }
+		size_t ReadAt(u64 offset, void* buffer, size_t size) { return system->ReadAt(handle, buffer, size, offset); }
+		size_t WriteAt(u64 offset, const void* buffer, size_t size) { return system->WriteAt(handle, buffer, size, offset); }
 		u64 GetLength() const { return system->FileStat(handle).GetSize(); }
 		void SetLength(u64 length) { system->Truncate(handle, length); }
 		u64 GetPosition() const { return system->Tell(handle); }
@@ -33,6 +33,15 @@ namespace Bricks { namespace IO {
 			const void* buffer,
 			size_t size
 		) = 0;
+		// Transfers at an absolute offset that leave the file position alone. Filesystems with positional calls allow these
+		// concurrently on one handle; the defaults seek there and back, so they do not.
+		virtual size_t ReadAt(FileHandle fd, void* buffer, size_t size, u64 offset);
+		virtual size_t WriteAt(FileHandle fd, const void* buffer, size_t size, u64 offset);
+		// Vectored transfers at the current position, and at an absolute offset without moving it.
+		virtual size_t ReadVector(FileHandle fd, const IOVector* vectors, int count);
+		virtual size_t WriteVector(FileHandle fd, const IOVector* vectors, int count);
+		virtual size_t ReadVector(FileHandle fd, const IOVector* vectors, int count, u64 offset);
+		virtual size_t WriteVector(FileHandle fd, const IOVector* vectors, int count, u64 offset);
 		virtual u64 Tell(FileHandle fd) const = 0;
 		virtual void Seek(FileHandle fd, s64 offset, SeekType::Enum whence) = 0;
 		virtual void Flush(FileHandle fd) = 0;
@@ -108,6 +117,12 @@ namespace Bricks { namespace IO {
 			const void* buffer,
 			size_t size
 		);
+		size_t ReadAt(FileHandle fd, void* buffer, size_t size, u64 offset);
+		size_t WriteAt(FileHandle fd, const void* buffer, size_t size, u64 offset);
+		size_t ReadVector(FileHandle fd, const IOVector* vectors, int count);
+		size_t WriteVector(FileHandle fd, const IOVector* vectors, int count);
+		size_t ReadVector(FileHandle fd, const IOVector* vectors, int count, u64 offset);
+		size_t WriteVector(FileHandle fd, const IOVector* vectors, int count, u64 offset);
 		u64 Tell(FileHandle fd) const;
 		void Seek(FileHandle fd, s64 offset, SeekType::Enum whence);
 		void Flush(FileHandle fd);
@@ -0,0 +1,218 @@
+#pragma once
+
+#include "bricks/core/math.h"
+#include "bricks/collections/list.h"
+#include "bricks/collections/array.h"
+#include "bricks/collections/comparison.h"
+#include "bricks/io/filemapping.h"
+
+#include <algorithm>
+
+namespace Bricks { namespace IO {
+	namespace Internal {
+		template<typename T>
+		class MappedArrayIterator : public Collections::Iterator<T>
+		{
+			private:
+				T* position;
+				T* end;
+
+			public:
+				MappedArrayIterator(T* begin, T* end) : position(begin - 1), end(end) { }
+				T& GetCurrent() const { return *position; }
+				bool MoveNext() { return ++position < end; }
+		};
+	}
+
+	// A list of trivially copyable items stored directly in a memory-mapped file, so it can outgrow physical memory.
+	// The file grows geometrically while items are added and is trimmed back to the item count when the array is destroyed.
+	// References to items are invalidated by any call that grows or shrinks the file. An array opened read-only throws
+	// NotSupportedException from anything that modifies it.
+	template<typename T>
+	class MappedArray : public Object, NoCopy, public Collections::List<T>, public Collections::IterableFast<Internal::MappedArrayIterator<T> >
+	{
+	protected:
+		static const long MinimumCapacity = 64;
+		// Items are written to the file byte for byte, so T must be trivially copyable.
+		typedef char RequiresTriviallyCopyable[Collections::Internal::IsTriviallyCopyable<T>::Value ? 1 : -1];
+
+		AutoPointer<Collections::ValueComparison<T> > comparison;
+		AutoPointer<Filesystem> filesystem;
+		FileHandle handle;
+		AutoPointer<FileMapping> mapping;
+		long count;
+		long capacity;
+
+		T* GetItems() const { return static_cast<T*>(mapping->GetData()); }
+		void CheckWritable() const { if (!mapping->IsWritable()) BRICKS_FEATURE_THROW(NotSupportedException()); }
+
+		void Resize(long size)
+		{
+			if (size < capacity)
+				mapping->Map(size * sizeof(T));
+			filesystem->Truncate(handle, size * sizeof(T));
+			mapping->Map(size * sizeof(T));
+			capacity = size;
+		}
+
+		void Grow(long minimum) { Resize(Math::Max(Math::Max(capacity * 2, minimum), MinimumCapacity)); }
+
+		long IndexOfItem(const T& value, Collections::ValueComparison<T>* compare) const
+		{
+			T* items = GetItems();
+			for (long i = 0; i < count; i++) {
+				if (!compare->Compare(items[i], value))
+					return i;
+			}
+			return -1;
+		}
+
+		long FindItem(const T& value) const
+		{
+			if (comparison)
+				return IndexOfItem(value, comparison);
+			Collections::OperatorValueComparison<T> compare;
+			return IndexOfItem(value, &compare);
+		}
+
+		template<typename TLess>
+		long LowerBound(const T& value, const TLess& less) const
+		{
+			T* items = GetItems();
+			T* found = std::lower_bound(items, items + count, value, less);
+			if (found == items + count || less(value, *found))
+				return -1;
+			return found - items;
+		}
+
+	public:
+		MappedArray(const String& path, FileOpenMode::Enum createmode = FileOpenMode::Open, FileMode::Enum mode = FileMode::ReadWrite, Filesystem* filesystem = NULL, Collections::ValueComparison<T>* comparison = NULL) :
+			comparison(comparison), filesystem(filesystem ?: Filesystem::GetDefault()), count(0), capacity(0)
+		{
+			if (!FileMapping::IsSupported(this->filesystem))
+				BRICKS_FEATURE_THROW(NotSupportedException());
+			// A shared writable mapping needs a descriptor that can also read, so WriteOnly opens the file ReadWrite.
+			bool writable = mode != FileMode::ReadOnly;
+			handle = this->filesystem->Open(path, createmode, writable ? FileMode::ReadWrite : mode);
+			mapping = autonew FileMapping(this->filesystem, handle, writable);
+			count = capacity = this->filesystem->FileStat(handle).GetSize() / sizeof(T);
+			mapping->Map(capacity * sizeof(T));
+		}
+		~MappedArray()
+		{
+			mapping->Unmap();
+			if (mapping->IsWritable() && count != capacity)
+				filesystem->Truncate(handle, count * sizeof(T));
+			filesystem->Close(handle);
+		}
+
+		// Writes modified items back to the file.
+		void Flush(bool wait = true) { mapping->Sync(0, count * sizeof(T), wait); }
+		// Tells the kernel how the given range of items is about to be accessed; a size of zero means the rest of the array.
+		void Advise(MappingAdvice::Enum advice, long index = 0, long size = 0) { mapping->Advise(advice, index * sizeof(T), size * sizeof(T)); }
+
+		FileMapping* GetMapping() const { return mapping; }
+
+		// Iterator
+		virtual ReturnPointer<Collections::Iterator<T> > GetIterator() const { return autonew Internal::MappedArrayIterator<T>(GetItems(), GetItems() + count); }
+		Internal::MappedArrayIterator<T> GetIteratorFast() const { return Internal::MappedArrayIterator<T>(GetItems(), GetItems() + count); }
+		virtual const T* GetContiguousItems(long& count) const { count = this->count; return GetData(); }
+
+		// Collection
+		virtual long GetCount() const { return count; }
+
+		virtual bool ContainsItem(const T& value) const { return FindItem(value) >= 0; }
+
+		virtual void AddItem(const T& value)
+		{
+			CheckWritable();
+			if (count == capacity) {
+				T copy(value);
+				Grow(count + 1);
+				GetItems()[count++] = copy;
+			} else
+				GetItems()[count++] = value;
+		}
+		virtual void AddRange(const T* values, long size)
+		{
+			CheckWritable();
+			T* items = GetItems();
+			if (values >= items && values < items + count) {
+				Collections::Array<T> copy;
+				copy.AddRange(values, size);
+				AddRange(copy.GetData(), size);
+				return;
+			}
+			Reserve(count + size);
+			std::copy(values, values + size, GetItems() + count);
+			count += size;
+		}
+		virtual bool RemoveItem(const T& value)
+		{
+			long index = FindItem(value);
+			if (index < 0)
+				return false;
+			RemoveItemAt(index);
+			return true;
+		}
+
+		virtual void Clear() { CheckWritable(); count = 0; }
+
+		// List
+		virtual void SetItem(long index, const T& value) { CheckWritable(); GetItems()[index] = value; }
+		virtual const T& GetItem(long index) const { return GetItems()[index]; }
+		virtual T& GetItem(long index) { return GetItems()[index]; }
+		virtual long IndexOfItem(const T& value) const { return FindItem(value); }
+
+		virtual void InsertItem(long index, const T& value) { InsertRange(index, &value, 1); }
+		virtual void InsertRange(long index, const T* values, long size)
+		{
+			CheckWritable();
+			T* items = GetItems();
+			if (values >= items && values < items + count) {
+				Collections::Array<T> copy;
+				copy.AddRange(values, size);
+				InsertRange(index, copy.GetData(), size);
+				return;
+			}
+			Reserve(count + size);
+			items = GetItems();
+			std::copy_backward(items + index, items + count, items + count + size);
+			std::copy(values, values + size, items + index);
+			count += size;
+		}
+		virtual void RemoveItemAt(long index)
+		{
+			CheckWritable();
+			T* items = GetItems();
+			std::copy(items + index + 1, items + count, items + index);
+			count--;
+		}
+
+		T* GetData() { return count ? GetItems() : NULL; }
+		const T* GetData() const { return count ? GetItems() : NULL; }
+
+		virtual long GetCapacity() const { return capacity; }
+		virtual void Reserve(long size) { if (size > capacity) { CheckWritable(); Grow(size); } }
+		virtual void ShrinkToFit() { if (capacity > count) { CheckWritable(); Resize(count); } }
+
+		void Sort(Collections::ValueComparison<T>* sortComparison = NULL)
+		{
+			CheckWritable();
+			Collections::ValueComparison<T>* sortWith = sortComparison ?: comparison.GetValue();
+			if (!sortWith || Collections::Internal::IsOperatorComparison(sortWith))
+				std::sort(GetItems(), GetItems() + count, Collections::Internal::OperatorLess<T>());
+			else
+				std::sort(GetItems(), GetItems() + count, Collections::Internal::ComparisonLess<T>(sortWith));
+		}
+
+		// Finds an item in an array already sorted by the same comparison, or returns -1.
+		long BinarySearch(const T& value, Collections::ValueComparison<T>* searchComparison = NULL) const
+		{
+			Collections::ValueComparison<T>* searchWith = searchComparison ?: comparison.GetValue();
+			if (!searchWith || Collections::Internal::IsOperatorComparison(searchWith))
+				return LowerBound(value, Collections::Internal::OperatorLess<T>());
+			return LowerBound(value, Collections::Internal::ComparisonLess<T>(searchWith));
+		}
+	};
+} }
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "bricks/core/copypointer.h"
+#include "bricks/io/stream.h"
+#include "bricks/io/filemapping.h"
+
+namespace Bricks { namespace IO {
+	// A file stream that reads and writes through a shared memory mapping instead of read/write calls.
+	// Writers grow the file ahead of the data and remap; the file is trimmed back to the stream length on destruction.
+	// GetData exposes the mapping itself, which moves whenever the stream grows.
+	class MappedFileStream : public Stream, NoCopy
+	{
+	protected:
+		AutoPointer<Filesystem> filesystem;
+		FileHandle handle;
+		AutoPointer<FileMapping> mapping;
+		String path;
+		u64 position;
+		u64 length;
+
+		void Reserve(u64 size);
+
+	public:
+		MappedFileStream(
+			const String& path,
+			FileOpenMode::Enum createmode = FileOpenMode::Open,
+			FileMode::Enum mode = FileMode::ReadOnly,
+			FilePermissions::Enum permissions = FilePermissions::OwnerReadWrite,
+			Filesystem* filesystem = NULL
+		);
+		~MappedFileStream();
+
+		size_t Read(void* buffer, size_t size);
+		size_t Write(const void* buffer, size_t size);
+		size_t ReadAt(u64 offset, void* buffer, size_t size);
+		size_t WriteAt(u64 offset, const void* buffer, size_t size);
+		u64 GetLength() const { return length; }
+		void SetLength(u64 value);
+		u64 GetPosition() const { return position; }
+		void SetPosition(u64 value) { position = value; }
+		void Flush();
+		const void* TryGetSpan(size_t size);
+		const void* TryGetSpanAt(u64 offset, size_t size);
+		bool CanWrite() const { return mapping->IsWritable(); }
+
+		// Tells the kernel how a range is about to be accessed; a size of zero means the rest of the file.
+		void Advise(MappingAdvice::Enum advice, u64 offset = 0, u64 size = 0) { mapping->Advise(advice, offset, size); }
+
+		const u8* GetData() const { return static_cast<const u8*>(mapping->GetData()); }
+		u8* GetData() { return static_cast<u8*>(mapping->GetData()); }
+		FileMapping* GetMapping() const { return mapping; }
+
+		Filesystem* GetFilesystem() const { return filesystem; }
+		FileHandle GetHandle() const { return handle; }
+		const String& GetPath() const { return path; }
+	};
+} }
@@ -1,21 +1,51 @@
 #pragma once
 
+#include "bricks/core/returnpointer.h"
 #include "bricks/io/stream.h"
 
+#include <vector>
+
 namespace Bricks { namespace IO {
+	namespace MemoryStreamMode { enum Enum {
+		// One buffer that doubles when it fills up, moving what was already written.
+		Contiguous = 0,
+		// A rope of chunks that double in size. Growing appends a chunk, so written bytes never move.
+		Chunked
+	}; }
+
 	class MemoryStream : public Stream
 	{
 	protected:
+		struct Chunk
+		{
+			u8* data;
+			unsigned long offset;
+			unsigned long size;
+		};
+
+		MemoryStreamMode::Enum mode;
 		u8* data;
 		unsigned long length;
 		unsigned long position;
 		unsigned long allocated;
+		std::vector<Chunk> chunks;
+		mutable size_t chunkIndex;
 
 		static const int BlockSize = 0x400;
+		static const unsigned long MaximumChunkSize = 0x1000000;
+
+		void Free();
+		void Copy(const MemoryStream& stream);
+		size_t FindChunk(unsigned long offset) const;
+		void Load(unsigned long offset, void* buffer, size_t size) const;
+		void Store(unsigned long offset, const void* buffer, size_t size);
+		void Fill(unsigned long offset, size_t size);
+		void Coalesce();
 
 	public:
 		MemoryStream();
 		MemoryStream(unsigned long size);
+		MemoryStream(MemoryStreamMode::Enum mode, unsigned long size = 0);
 		MemoryStream(const MemoryStream& stream);
 		MemoryStream(const Data& data);
 		MemoryStream(const void* data, unsigned long length);
@@ -23,18 +53,30 @@ namespace Bricks { namespace IO {
 
 		MemoryStream& operator =(const MemoryStream& stream);
 
+		// Makes room for at least size bytes without changing the length.
 		void Allocate(unsigned long size);
+		unsigned long GetCapacity() const { return allocated; }
+		MemoryStreamMode::Enum GetMode() const { return mode; }
 
 		size_t Read(void* buffer, size_t size);
 
 		size_t Write(const void* buffer, size_t size);
 
+		size_t ReadAt(u64 offset, void* buffer, size_t size);
+		size_t WriteAt(u64 offset, const void* buffer, size_t size);
+
 		void SetLength(u64 length);
 		void SetPosition(u64 position);
 		int ReadByte();
+		const void* TryGetSpan(size_t size);
+		const void* TryGetSpanAt(u64 offset, size_t size);
 
-		void* GetBuffer() { return data; }
+		// A chunked stream is first copied into a single chunk so its contents are contiguous.
+		void* GetBuffer();
 		u64 GetLength() const { return length; }
 		u64 GetPosition() const { return position; }
+
+		// Hands the contents to a Data without copying them, leaving the stream empty.
+		ReturnPointer<Data> Detach();
 	};
 } }
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "bricks/core/object.h"
+#include "bricks/core/autopointer.h"
+#include "bricks/core/copypointer.h"
+#include "bricks/core/returnpointer.h"
+#include "bricks/core/string.h"
+
+#include <vector>
+
+namespace Bricks { namespace IO {
+	class Stream;
+	class StreamReader;
+	class Serializer;
+
+	namespace SerializationEvent { enum Enum {
+		None = 0,
+		BeginDictionary,
+		EndDictionary,
+		BeginArray,
+		EndArray,
+		// A dictionary key, followed by the events of its value.
+		Key,
+		// Anything other than a dictionary or array, including NULL.
+		Value,
+		// The root object has been read.
+		End
+	}; }
+
+	// Walks a Serializer object graph one event at a time, so that memory use depends on nesting depth rather than on how
+	// large the containers are. Arrays written in chunks by SerializationWriter report a count of -1.
+	class SerializationReader : public Object, NoCopy
+	{
+	protected:
+		struct Frame
+		{
+			SerializationEvent::Enum type;
+			u64 remaining;
+			bool chunked;
+			bool key;
+		};
+
+		AutoPointer<Serializer> serializer;
+		AutoPointer<StreamReader> reader;
+		std::vector<Frame> frames;
+		SerializationEvent::Enum event;
+		long count;
+		String key;
+		AutoPointer<Object> value;
+
+		SerializationEvent::Enum ReadValue();
+
+	public:
+		SerializationReader(Serializer* serializer, StreamReader* reader);
+		SerializationReader(Serializer* serializer, Stream* stream);
+		~SerializationReader();
+
+		SerializationEvent::Enum Next();
+
+		SerializationEvent::Enum GetEvent() const { return event; }
+		// Containers currently open, counting the one just begun.
+		int GetDepth() const { return frames.size(); }
+		// Entries in the dictionary or array just begun, or -1 for a chunked array.
+		long GetCount() const { return count; }
+		const String& GetKey() const { return key; }
+		Object* GetValue() const { return value; }
+
+		// Skips the rest of the dictionary or array just begun, up to and including its end event.
+		void Skip();
+		// Returns the value just read, or builds the whole dictionary or array just begun, consuming its events.
+		ReturnPointer<Object> ReadObject();
+	};
+} }
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "bricks/core/object.h"
+#include "bricks/core/autopointer.h"
+#include "bricks/core/copypointer.h"
+#include "bricks/core/returnpointer.h"
+#include "bricks/core/data.h"
+#include "bricks/core/value.h"
+#include "bricks/io/serializer.h"
+
+#include <map>
+
+namespace Bricks { namespace IO {
+	class Stream;
+	class MemoryStream;
+	class FileMapping;
+
+	namespace SerializationNodeType { enum Enum {
+		Null = 0,
+		Dictionary,
+		Array,
+		String,
+		Value,
+		Data
+	}; }
+
+	// One node of a SerializationView, read in place. Nodes borrow the view's memory and are only valid while it lives.
+	// Malformed offsets and counts throw FormatException rather than reading outside the view or following a cycle.
+	class SerializationNode
+	{
+	protected:
+		const u8* base;
+		size_t size;
+		u32 offset;
+
+		u32 Read32(u64 position) const;
+		u32 Expect(SerializationNodeType::Enum type) const;
+		SerializationNode Reference(u64 position) const;
+
+	public:
+		SerializationNode() : base(NULL), size(0), offset(0) { }
+		SerializationNode(const u8* base, size_t size, u32 offset);
+
+		SerializationNodeType::Enum GetType() const;
+		bool IsNull() const { return !offset; }
+
+		// Items of an array or entries of a dictionary.
+		long GetCount() const;
+
+		SerializationNode GetItem(long index) const;
+
+		// Dictionary entries are sorted by the bytes of their keys, so lookups are a binary search. Returns a null node if the
+		// key is missing.
+		SerializationNode GetKey(long index) const;
+		SerializationNode GetValue(long index) const;
+		SerializationNode Find(const char* key, size_t length) const;
+		SerializationNode Find(const String& key) const { return Find(key.CString(), key.GetSize()); }
+		bool ContainsKey(const String& key) const { return !Find(key).IsNull(); }
+
+		// Strings are stored with a terminating NUL, so GetCString can be used directly.
+		size_t GetLength() const;
+		const char* GetCString() const;
+		String GetString() const;
+
+		// Borrows the bytes of a data node.
+		Data GetData() const;
+
+		ValueType::Enum GetValueType() const;
+		Value GetValue() const;
+
+		// Copies this node and everything under it into the object model Serializer uses.
+		ReturnPointer<Object> ToObject() const;
+	};
+
+	// Read-only access to a tree of dictionaries, arrays, strings, values and data laid out by SerializationViewWriter. Nodes
+	// refer to each other by offset, so a view over a buffer or a mapped file needs no parsing: arrays index in constant time,
+	// and string and data nodes are used where they lie. The buffer must be 8-byte aligned and is kept alive by the owner.
+	class SerializationView : public Object, NoCopy
+	{
+	protected:
+		AutoPointer<Object> owner;
+		const u8* data;
+		size_t size;
+		u32 root;
+
+		void Open();
+
+	public:
+		static const u32 Magic = 0x56534b42;
+		static const u16 Version = 1;
+		static const size_t HeaderSize = 0x10;
+		static const size_t Alignment = 0x08;
+
+		SerializationView(const void* data, size_t size, Object* owner = NULL);
+		SerializationView(Data* data);
+		// The mapping must already be mapped, and must not be remapped while the view is in use.
+		SerializationView(FileMapping* mapping);
+
+		SerializationNode GetRoot() const { return SerializationNode(data, size, root); }
+		size_t GetSize() const { return size; }
+	};
+
+	// Lays out an object tree as a SerializationView: SerializationDictionary, SerializationArray, String, Value, Data and NULL
+	// nodes, little-endian, with each string stored once however often it appears. Offsets are 32-bit, so the output is
+	// limited to 4 GiB.
+	class SerializationViewWriter : public Object, NoCopy
+	{
+	protected:
+		AutoPointer<MemoryStream> output;
+		std::map<String, u32> strings;
+
+		u32 Reserve(SerializationNodeType::Enum type, u32 count, size_t size);
+		void Put32(u64 position, u32 value);
+		u32 WriteNode(Object* object);
+		u32 WriteString(const String& string);
+
+	public:
+		SerializationViewWriter();
+		~SerializationViewWriter();
+
+		ReturnPointer<Data> Write(Object* root);
+		void Write(Stream* stream, Object* root);
+	};
+} }
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "bricks/core/object.h"
+#include "bricks/core/autopointer.h"
+#include "bricks/core/copypointer.h"
+#include "bricks/core/string.h"
+
+#include <vector>
+
+namespace Bricks { namespace IO {
+	class Stream;
+	class StreamWriter;
+	class MemoryStream;
+	class Serializer;
+
+	// Writes a Serializer object graph a piece at a time, producing the same bytes Serializer::Serialize would. Dictionaries
+	// and arrays of known size are written straight through; an array begun without a count is written in chunks, holding
+	// back only the items of the current chunk, and deserializes as an ordinary SerializationArray. Such an array begun inside
+	// another one's chunk ends that chunk early, so only the innermost chunked array ever holds items back.
+	class SerializationWriter : public Object, NoCopy
+	{
+	protected:
+		struct Frame
+		{
+			bool dictionary;
+			long count;
+			long written;
+			bool key;
+			AutoPointer<MemoryStream> chunk;
+			AutoPointer<StreamWriter> chunkWriter;
+			long chunkCount;
+			// The item in progress was counted in a chunk already written, and the rest of it goes straight through.
+			bool direct;
+
+			Frame(bool dictionary, long count) : dictionary(dictionary), count(count), written(0), key(false), chunkCount(0), direct(false) { }
+		};
+
+		AutoPointer<Serializer> serializer;
+		AutoPointer<StreamWriter> writer;
+		std::vector<Frame> frames;
+		long chunkItems;
+		size_t chunkSize;
+
+		StreamWriter* GetTarget(size_t depth) const;
+		void BeginItem();
+		void EndItem();
+		void Begin(bool dictionary, long count);
+		void End(bool dictionary);
+		void FlushChunk(size_t depth, bool open = false);
+
+	public:
+		SerializationWriter(Serializer* serializer, StreamWriter* writer);
+		// Buffers its output; anything left when the writer is destroyed is written then, but errors are lost, so call Flush first.
+		SerializationWriter(Serializer* serializer, Stream* stream);
+		~SerializationWriter();
+
+		// A chunk is written once it holds this many items or bytes, checked after each item.
+		void SetChunkLimits(long items, size_t size) { chunkItems = items; chunkSize = size; }
+
+		// Dictionaries need their entry count up front, and each value must follow a WriteKey.
+		void BeginDictionary(long count);
+		void WriteKey(const String& key);
+		void EndDictionary();
+
+		void BeginArray(long count);
+		// Starts an array whose length is not known yet.
+		void BeginArray();
+		void EndArray();
+
+		// Writes any object the serializer supports, including whole dictionaries and arrays.
+		void WriteValue(Object* value);
+
+		// Writes out everything but the items of unfinished chunked arrays.
+		void Flush();
+		int GetDepth() const { return frames.size(); }
+	};
+} }
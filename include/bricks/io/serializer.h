@@ -5,13 +5,21 @@
 #include "bricks/collections/array.h"
 #include "bricks/collections/dictionary.h"
 
+#include <map>
+#include <vector>
+
 namespace Bricks { namespace IO {
 	class Stream;
 	class StreamReader;
 	class StreamWriter;
 	class Serializer;
+	class SerializationReader;
+	class SerializationWriter;
 
 	namespace Internal {
+		// Stands in for the type of arrays written in chunks by SerializationWriter, which deserialize as a SerializationArray.
+		struct SerializationChunkedArray { };
+
 		class ObjectSerializer : public Object
 		{
 		protected:
@@ -48,19 +56,77 @@ namespace Bricks { namespace IO {
 	typedef Collections::Dictionary<String, AutoPointer<Object> > SerializationDictionary;
 	typedef Collections::Array<AutoPointer<Object> > SerializationArray;
 
+	namespace SerializerFormat { enum Enum {
+		// Counts, lengths and value types as big-endian 32-bit integers.
+		Fixed = 0,
+		// Counts, lengths and value types as LEB128 varints, so small ones take a single byte. Type identifiers stay 32-bit.
+		Compact
+	}; }
+
 	class Serializer : public Object
 	{
 	protected:
 		typedef Collections::Dictionary<TypeInfo, AutoPointer<Internal::ObjectSerializer> > SerializerDictionary;
 		SerializerDictionary serializers;
+		SerializerFormat::Enum format;
+
+		// Open-addressed indexes rebuilt on registration, so that dispatch costs one probe per object: serializers by identifier
+		// for Deserialize, and by type_info address for Serialize. Types whose address misses fall back to the dictionary.
+		struct IdentifierSlot { int identifier; Internal::ObjectSerializer* serializer; };
+		struct TypeSlot { const void* type; Internal::ObjectSerializer* serializer; };
+		std::vector<IdentifierSlot> identifierIndex;
+		std::vector<TypeSlot> typeIndex;
+
+		void Reindex();
+		Internal::ObjectSerializer* FindSerializer(const TypeInfo& type) const;
+		Internal::ObjectSerializer* FindSerializer(int identifier) const;
+
+		// Objects seen so far in the outermost Serialize or Deserialize call when references are preserved. Each object is
+		// numbered in the order it starts; dictionary keys are matched by content and everything else by identity.
+		bool preserveReferences;
+		mutable int referenceDepth;
+		mutable std::map<const Object*, u32> objectReferences;
+		mutable std::map<String, u32> stringReferences;
+		mutable std::vector<AutoPointer<Object> > references;
+		mutable std::vector<bool> referencesComplete;
+
+		struct ReferenceScope
+		{
+			const Serializer* serializer;
+			ReferenceScope(const Serializer* serializer) : serializer(serializer) { serializer->referenceDepth++; }
+			~ReferenceScope();
+		};
+
+		void SerializeObject(StreamWriter* writer, Object* object, bool key) const;
+
+		friend class SerializationReader;
+		friend class SerializationWriter;
 
 	public:
-		Serializer();
+		// Written in place of an object already written in the same graph, followed by its number as a length.
+		static const int ReferenceIdentifier = 0x6a09e667;
+
+		Serializer(SerializerFormat::Enum format = SerializerFormat::Fixed);
+
+		SerializerFormat::Enum GetFormat() const { return format; }
+		void SetFormat(SerializerFormat::Enum value) { format = value; }
+
+		// Writes each object once per graph, with back-references to it from then on, so shared strings, data and containers
+		// stay shared after loading. The reading serializer must be set the same way. Cycles cannot be represented, and throw
+		// InvalidArgumentException. SerializationReader and SerializationWriter do not support this mode.
+		bool GetPreserveReferences() const { return preserveReferences; }
+		void SetPreserveReferences(bool value) { preserveReferences = value; }
+
+		// Counts and lengths in the serializer's format, for object serializers to write theirs with.
+		void WriteLength(StreamWriter* writer, u64 length) const;
+		u64 ReadLength(StreamReader* reader) const;
 
 		void RegisterSerializer(Internal::ObjectSerializer* serializer);
 		void UnregisterSerializer(Internal::ObjectSerializer* serializer);
 
 		void Serialize(StreamWriter* writer, Object* object) const;
+		// Writes a dictionary key. Keys are copied into the dictionary they load into, so equal keys may share a reference.
+		void SerializeKey(StreamWriter* writer, String* key) const;
 		ReturnPointer<Object> Deserialize(StreamReader* reader) const;
 
 		void Serialize(Stream* writer, Object* object) const;
@@ -2,6 +2,7 @@
 
 #include "bricks/core/object.h"
 #include "bricks/core/data.h"
+#include "bricks/io/types.h"
 
 namespace Bricks { namespace IO {
 	class Stream : public Object
@@ -15,10 +16,64 @@ namespace Bricks { namespace IO {
 		virtual void SetPosition(u64 position) = 0;
 		virtual void Flush() { }
 		virtual int ReadByte() { u8 data; if (Read(&data, sizeof(data)) != sizeof(data)) return -1; return data; }
+		// Streams already backed by memory lend out the next size bytes in place and advance past them. Returns NULL if the
+		// stream cannot, including when fewer than size bytes remain. The bytes stay valid until the stream is next written or resized.
+		virtual const void* TryGetSpan(size_t size) { return NULL; }
+		// The same at an absolute offset, leaving the position alone so that several readers can share one stream.
+		virtual const void* TryGetSpanAt(u64 offset, size_t size) { return NULL; }
 		virtual bool CanSeek() const { return true; }
 		virtual bool CanRead() const { return true; }
 		virtual bool CanWrite() const { return true; }
+		// Scatter/gather transfers: each buffer is filled or written in order, stopping early at a short transfer. Returns the total bytes moved.
+		virtual size_t ReadVector(const IOVector* vectors, int count);
+		virtual size_t WriteVector(const IOVector* vectors, int count);
+		// Transfers at an absolute offset that leave the position alone. Streams over files or memory override these so that
+		// several readers can share one stream; the defaults seek there and back, so they are not safe to call concurrently.
+		virtual size_t ReadAt(u64 offset, void* buffer, size_t size);
+		virtual size_t WriteAt(u64 offset, const void* buffer, size_t size);
 		virtual size_t Read(Data& data) { return Read(data.GetData(), data.GetSize()); }
 		virtual size_t Write(const Data& data) { return Write(data.GetData(), data.GetSize()); }
 	};
+
+	inline size_t Stream::ReadVector(const IOVector* vectors, int count)
+	{
+		size_t total = 0;
+		for (int i = 0; i < count; i++) {
+			size_t size = Read(vectors[i].data, vectors[i].size);
+			total += size;
+			if (size < vectors[i].size)
+				break;
+		}
+		return total;
+	}
+
+	inline size_t Stream::WriteVector(const IOVector* vectors, int count)
+	{
+		size_t total = 0;
+		for (int i = 0; i < count; i++) {
+			size_t size = Write(vectors[i].data, vectors[i].size);
+			total += size;
+			if (size < vectors[i].size)
+				break;
+		}
+		return total;
+	}
+
+	inline size_t Stream::ReadAt(u64 offset, void* buffer, size_t size)
+	{
+		u64 position = GetPosition();
+		SetPosition(offset);
+		size = Read(buffer, size);
+		SetPosition(position);
+		return size;
+	}
+
+	inline size_t Stream::WriteAt(u64 offset, const void* buffer, size_t size)
+	{
+		u64 position = GetPosition();
+		SetPosition(offset);
+		size = Write(buffer, size);
+		SetPosition(position);
+		return size;
+	}
 } }
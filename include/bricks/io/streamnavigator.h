@@ -30,15 +30,17 @@ namespace Bricks { namespace IO {
 		~StreamNavigator();
 
 		Stream* GetStream() { return stream; }
+		Endian::Enum GetEndianness() const { return endianness; }
 
 		virtual void Pad(u64 size) = 0;
 
 		void PadTo(u64 position);
 		void PadToMultiple(int round);
 
-		u64 GetPosition();
-		void SetPosition(u64 position);
-		u64 GetLength();
+		// Buffered navigators report their logical position, which runs ahead of or behind the stream's own.
+		virtual u64 GetPosition();
+		virtual void SetPosition(u64 position);
+		virtual u64 GetLength();
 		bool IsEndOfFile();
 	};
 } }
@@ -5,19 +5,79 @@
 namespace Bricks { class Data; }
 
 namespace Bricks { namespace IO {
+	// A reader given a buffer size reads ahead from the stream a buffer at a time, and fixed-width fields are decoded straight
+	// out of the buffer. The stream runs ahead of the reader while it holds unread bytes; the reader seeks it back to its own
+	// position when destroyed, so other users of a seekable stream see only what was consumed.
 	class StreamReader : public StreamNavigator
 	{
+	protected:
+		u8* buffer;
+		size_t bufferSize;
+		const u8* cursor;
+		const u8* end;
+
+		bool Fill(size_t size);
+		const void* Take(size_t size, void* scratch);
+		int Next();
+		u64 ReadVarUIntSlow();
+
 	public:
-		StreamReader(Stream* stream, Endian::Enum endianness = Endian::Native);
+		StreamReader(Stream* stream, Endian::Enum endianness = Endian::Native, size_t bufferSize = 0);
+		~StreamReader();
+
+		size_t GetBufferSize() const { return bufferSize; }
+
+		u64 GetPosition();
+		void SetPosition(u64 position);
 
-		u16 ReadInt16(Endian::Enum endian = Endian::Unknown);
-		u32 ReadInt32(Endian::Enum endian = Endian::Unknown);
-		u64 ReadInt64(Endian::Enum endian = Endian::Unknown);
+#define BRICKS_STREAM_READ(bits) \
+		u##bits ReadInt##bits(Endian::Enum endian = Endian::Unknown) { \
+			u8 scratch[sizeof(u##bits)]; \
+			const void* data; \
+			if ((size_t)(end - cursor) >= sizeof(u##bits)) { \
+				data = cursor; \
+				cursor += sizeof(u##bits); \
+			} else \
+				data = Take(sizeof(u##bits), scratch); \
+			return EndianConvert##bits<u##bits>(endian ?: endianness, data); \
+		}
+		BRICKS_STREAM_READ(16)
+		BRICKS_STREAM_READ(32)
+		BRICKS_STREAM_READ(64)
+#undef BRICKS_STREAM_READ
 
-		u8 ReadByte();
+		// Bulk reads swap the whole array in place after one read. The template forms fix the byte order at compile time.
+#define BRICKS_STREAM_READ_ARRAY(name, type, bits) \
+		void Read##name##Array(type* values, size_t count, Endian::Enum endian = Endian::Unknown) { \
+			ReadBytes(values, count * sizeof(type)); \
+			EndianConvertArray##bits(endian ?: endianness, values, values, count); \
+		} \
+		template<Endian::Enum E> void Read##name##Array(type* values, size_t count) { \
+			ReadBytes(values, count * sizeof(type)); \
+			EndianConvertArray##bits<E>(values, values, count); \
+		}
+		BRICKS_STREAM_READ_ARRAY(Int16, u16, 16)
+		BRICKS_STREAM_READ_ARRAY(Int32, u32, 32)
+		BRICKS_STREAM_READ_ARRAY(Int64, u64, 64)
+		BRICKS_STREAM_READ_ARRAY(Float, float, 32)
+		BRICKS_STREAM_READ_ARRAY(Double, double, 64)
+#undef BRICKS_STREAM_READ_ARRAY
+
+		u8 ReadByte() { if (cursor < end) return *cursor++; u8 data; return *(const u8*)Take(sizeof(data), &data); }
 		void ReadBytes(void* data, size_t size);
 		Data ReadBytes(size_t size);
 
+		// LEB128: seven bits a byte, least significant group first, with the high bit set on every byte but the last. The signed
+		// form is zigzag encoded so small negative values stay short. Throws FormatException past ten bytes.
+		u64 ReadVarUInt();
+		s64 ReadVarInt() { u64 value = ReadVarUInt(); return (s64)(value >> 1) ^ -(s64)(value & 1); }
+		// The MIDI variable-length quantity: the same groups, most significant first, at most four bytes.
+		u32 ReadVLQ();
+
+		// Borrows the bytes from the read buffer or from memory-backed streams instead of copying. The result is only valid until
+		// the next read, or until the stream is next written or resized.
+		Data ReadSpan(size_t size);
+
 		String ReadCString(int division);
 
 		String ReadString(int length);
@@ -2,22 +2,97 @@
 
 #include "bricks/io/streamnavigator.h"
 #include "bricks/io/endian.h"
+#include "bricks/io/types.h"
 
 namespace Bricks { namespace IO {
+	// Between BeginBatch and EndBatch, fields are gathered and handed to the stream as one vectored write.
+	// Small fields are copied; WriteBytes payloads of BatchBorrowSize or more are referenced and must stay valid until the batch ends.
+	// A writer given a buffer size instead copies fields into its buffer and writes it out only when it fills, on Flush, or
+	// when the position is moved. Payloads too large for the buffer are written straight through alongside it.
+	// Anything still pending is written when the writer is destroyed, but any error doing so is lost; call EndBatch or Flush
+	// first to see them.
 	class StreamWriter : public StreamNavigator
 	{
+	protected:
+		static const int BatchVectors = 16;
+		static const size_t BatchScratchSize = 0x200;
+
+		int batchDepth;
+		int batchCount;
+		size_t batchScratchUsed;
+		size_t batchSize;
+		IOVector batch[BatchVectors];
+		u8 batchScratch[BatchScratchSize];
+
+		u8* buffer;
+		size_t bufferSize;
+		size_t bufferUsed;
+
+		void Emit(const void* data, size_t size, bool borrow = false);
+		void FlushBatch();
+		void FlushBuffer();
+		void WriteArray(const void* values, size_t count, size_t width, bool swap);
+		u8* Reserve(size_t size, u8* scratch) { return bufferSize - bufferUsed >= size ? buffer + bufferUsed : scratch; }
+		void Commit(const u8* data, size_t size) { if (data == buffer + bufferUsed) bufferUsed += size; else Emit(data, size); }
+
 	public:
-		StreamWriter(Stream* stream, Endian::Enum endianness = Endian::Native);
+		static const size_t BatchBorrowSize = 0x40;
+
+		StreamWriter(Stream* stream, Endian::Enum endianness = Endian::Native, size_t bufferSize = 0);
+		~StreamWriter();
+
+		size_t GetBufferSize() const { return bufferSize; }
 
-		void WriteInt(u16 value, Endian::Enum endian = Endian::Unknown);
-		void WriteInt(u32 value, Endian::Enum endian = Endian::Unknown);
-		void WriteInt(u64 value, Endian::Enum endian = Endian::Unknown);
+		// Batches nest; the pending fields are written when the outermost batch ends.
+		void BeginBatch() { batchDepth++; }
+		void EndBatch() { if (!--batchDepth) FlushBatch(); }
+
+		// Writes out buffered and batched fields, then flushes the stream unless flushStream is false.
+		void Flush(bool flushStream = true);
+
+		u64 GetPosition();
+		void SetPosition(u64 position);
+		u64 GetLength();
+
+#define BRICKS_STREAM_WRITE(bits) \
+		void WriteInt(u##bits value, Endian::Enum endian = Endian::Unknown) { \
+			if (bufferSize - bufferUsed >= sizeof(u##bits)) { \
+				EndianConvert##bits(endian ?: endianness, buffer + bufferUsed, value); \
+				bufferUsed += sizeof(u##bits); \
+				return; \
+			} \
+			u##bits data; \
+			EndianConvert##bits(endian ?: endianness, &data, value); \
+			Emit(&data, sizeof(u##bits)); \
+		}
+		BRICKS_STREAM_WRITE(16)
+		BRICKS_STREAM_WRITE(32)
+		BRICKS_STREAM_WRITE(64)
+#undef BRICKS_STREAM_WRITE
+
+		// Bulk writes swap through the write buffer, or a scratch block when unbuffered, and leave the values untouched.
+		// Arrays already in the target byte order are written like WriteBytes. The template forms fix the byte order at compile time.
+#define BRICKS_STREAM_WRITE_ARRAY(name, type) \
+		void Write##name##Array(const type* values, size_t count, Endian::Enum endian = Endian::Unknown) { WriteArray(values, count, sizeof(type), EndianRequiresSwap(endian ?: endianness)); } \
+		template<Endian::Enum E> void Write##name##Array(const type* values, size_t count) { WriteArray(values, count, sizeof(type), Internal::EndianTraits<E>::RequiresSwap()); }
+		BRICKS_STREAM_WRITE_ARRAY(Int16, u16)
+		BRICKS_STREAM_WRITE_ARRAY(Int32, u32)
+		BRICKS_STREAM_WRITE_ARRAY(Int64, u64)
+		BRICKS_STREAM_WRITE_ARRAY(Float, float)
+		BRICKS_STREAM_WRITE_ARRAY(Double, double)
+#undef BRICKS_STREAM_WRITE_ARRAY
 		void WriteInt16(u16 value, Endian::Enum endian = Endian::Unknown) { WriteInt(value, endian); }
 		void WriteInt32(u32 value, Endian::Enum endian = Endian::Unknown) { WriteInt(value, endian); }
 		void WriteInt64(u64 value, Endian::Enum endian = Endian::Unknown) { WriteInt(value, endian); }
 
-		void WriteByte(u8 data);
+		void WriteByte(u8 data) { if (bufferUsed < bufferSize) buffer[bufferUsed++] = data; else Emit(&data, sizeof(data)); }
 		void WriteBytes(const void* data, size_t size);
+
+		// Variable-length integers in the forms StreamReader::ReadVarUInt, ReadVarInt and ReadVLQ decode. WriteVLQ takes at most 28 bits.
+		void WriteVarUInt(u64 value);
+		void WriteVarInt(s64 value) { WriteVarUInt(((u64)value << 1) ^ (u64)(value >> 63)); }
+		void WriteVLQ(u32 value);
+
 		void WriteString(const String& str, size_t size = String::npos);
 
 		void Pad(u64 size);
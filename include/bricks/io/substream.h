@@ -4,6 +4,8 @@
 #include "bricks/io/stream.h"
 
 namespace Bricks { namespace IO {
+	// A window onto part of another stream. Transfers go through the parent's ReadAt and WriteAt, so substreams of one
+	// FileStream can be read from several threads at once and never move the parent's position.
 	class Substream : public Stream
 	{
 	private:
@@ -28,6 +30,10 @@ namespace Bricks { namespace IO {
 
 		size_t Read(void* buffer, size_t size);
 		size_t Write(const void* buffer, size_t size);
+		size_t ReadAt(u64 offset, void* buffer, size_t size);
+		size_t WriteAt(u64 offset, const void* buffer, size_t size);
+		const void* TryGetSpan(size_t size);
+		const void* TryGetSpanAt(u64 offset, size_t size);
 		void Flush();
 	};
 } }
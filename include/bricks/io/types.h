@@ -87,6 +87,16 @@ namespace Bricks { namespace IO {
 		End = SEEK_END
 	}; }
 
+	// One buffer of a scatter/gather transfer, laid out like struct iovec.
+	struct IOVector
+	{
+		void* data;
+		size_t size;
+
+		IOVector() : data(NULL), size(0) { }
+		IOVector(const void* data, size_t size) : data(const_cast<void*>(data)), size(size) { }
+	};
+
 	class FileNotFoundException : public Exception
 	{
 	public:
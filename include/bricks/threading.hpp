@@ -14,5 +14,7 @@
 
 #include "bricks/threading/task.h"
 #include "bricks/threading/taskqueue.h"
+#include "bricks/threading/parallelsort.h"
+#include "bricks/threading/concurrentcache.h"
 
 #endif
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "bricks/core/autopointer.h"
+#include "bricks/collections/array.h"
+#include "bricks/collections/cache.h"
+#include "bricks/threading/mutex.h"
+#include "bricks/threading/mutexlock.h"
+
+namespace Bricks { namespace Threading {
+	// A Cache split into independently locked shards chosen by key hash, each with an equal share of the budget.
+	// Delegates run with their shard locked and must not call back into the cache.
+	template<typename TKey, typename TValue>
+	class ConcurrentCache : public Object, NoCopy
+	{
+	public:
+		typedef Collections::Cache<TKey, TValue> ShardType;
+
+	protected:
+		Collections::Array<AutoPointer<ShardType> > shards;
+		Collections::Array<AutoPointer<Mutex> > locks;
+		u32 shardMask;
+
+		long ShardOf(const TKey& key) const { u32 hash = Collections::Internal::CacheHash<TKey>()(key); return (hash ^ (hash >> 16)) & shardMask; }
+
+	public:
+		ConcurrentCache(size_t budget, int shardCount = 16, Collections::CachePolicy::Enum policy = Collections::CachePolicy::LeastRecentlyUsed, Collections::ValueComparison<TKey>* keycomparison = autonew Collections::OperatorValueComparison<TKey>())
+		{
+			u32 count = 1;
+			while ((int)count < shardCount)
+				count <<= 1;
+			shardMask = count - 1;
+			for (u32 i = 0; i < count; i++) {
+				shards.AddItem(autonew ShardType(budget / count, policy, keycomparison));
+				locks.AddItem(autonew Mutex());
+			}
+		}
+
+		void SetCostDelegate(const typename ShardType::CostDelegate& value) { for (long i = 0; i < shards.GetCount(); i++) { MutexLock lock(locks[i]); shards[i]->SetCostDelegate(value); } }
+		void SetEvictionDelegate(const typename ShardType::EvictionDelegate& value) { for (long i = 0; i < shards.GetCount(); i++) { MutexLock lock(locks[i]); shards[i]->SetEvictionDelegate(value); } }
+
+		long GetShardCount() const { return shards.GetCount(); }
+
+		bool TryGetItem(const TKey& key, TValue& value) { long shard = ShardOf(key); MutexLock lock(locks[shard]); return shards[shard]->TryGetItem(key, value); }
+		bool ContainsKey(const TKey& key) const { long shard = ShardOf(key); MutexLock lock(locks[shard]); return shards[shard]->ContainsKey(key); }
+		bool Add(const TKey& key, const TValue& value) { long shard = ShardOf(key); MutexLock lock(locks[shard]); return shards[shard]->Add(key, value); }
+		bool RemoveKey(const TKey& key) { long shard = ShardOf(key); MutexLock lock(locks[shard]); return shards[shard]->RemoveKey(key); }
+
+		void Clear() { for (long i = 0; i < shards.GetCount(); i++) { MutexLock lock(locks[i]); shards[i]->Clear(); } }
+
+		long GetCount() const
+		{
+			long count = 0;
+			for (long i = 0; i < shards.GetCount(); i++) {
+				MutexLock lock(locks[i]);
+				count += shards[i]->GetCount();
+			}
+			return count;
+		}
+
+		size_t GetCost() const
+		{
+			size_t cost = 0;
+			for (long i = 0; i < shards.GetCount(); i++) {
+				MutexLock lock(locks[i]);
+				cost += shards[i]->GetCost();
+			}
+			return cost;
+		}
+
+		Collections::CacheStatistics GetStatistics() const
+		{
+			Collections::CacheStatistics statistics;
+			for (long i = 0; i < shards.GetCount(); i++) {
+				MutexLock lock(locks[i]);
+				statistics += shards[i]->GetStatistics();
+			}
+			return statistics;
+		}
+	};
+} }
@@ -0,0 +1,298 @@
+#pragma once
+
+#include "bricks/core/autopointer.h"
+#include "bricks/core/math.h"
+#include "bricks/collections/array.h"
+#include "bricks/threading/task.h"
+#include "bricks/threading/taskqueue.h"
+#include "bricks/threading/mutex.h"
+
+#include <vector>
+#include <algorithm>
+
+namespace Bricks { namespace Threading {
+	namespace Internal {
+		template<typename T, typename C>
+		class ParallelSortTask : public TaskBase
+		{
+		protected:
+			T* begin;
+			T* end;
+			C compare;
+			bool stable;
+
+			void Main() { if (stable) std::stable_sort(begin, end, compare); else std::sort(begin, end, compare); }
+
+		public:
+			ParallelSortTask(T* begin, T* end, const C& compare, bool stable) : begin(begin), end(end), compare(compare), stable(stable) { }
+		};
+
+		template<typename T, typename C>
+		class ParallelMergeTask : public TaskBase
+		{
+		protected:
+			const T* first1;
+			const T* last1;
+			const T* first2;
+			const T* last2;
+			T* output;
+			C compare;
+
+			void Main() { std::merge(first1, last1, first2, last2, output, compare); }
+
+		public:
+			ParallelMergeTask(const T* first1, const T* last1, const T* first2, const T* last2, T* output, const C& compare) : first1(first1), last1(last1), first2(first2), last2(last2), output(output), compare(compare) { }
+		};
+
+		static inline void ParallelWaitTasks(Collections::Array<AutoPointer<TaskBase> >& tasks)
+		{
+			BRICKS_FOR_EACH (const AutoPointer<TaskBase>& task, tasks)
+				task->Wait(true);
+			tasks.Clear();
+		}
+
+		// Splits a merge of [first1, last1) and [first2, last2) into pieces that may run independently.
+		// Each split point in the first run is paired with the first element of the second run that is not less than it,
+		// so ties still resolve in favour of the first run and the result matches a stable std::merge.
+		template<typename T, typename C>
+		static void ParallelMergeSplit(TaskQueue* queue, Collections::Array<AutoPointer<TaskBase> >& tasks, const T* first1, const T* last1, const T* first2, const T* last2, T* output, const C& compare, long pieces)
+		{
+			if (first1 == last1)
+				pieces = 1;
+			const T* previous1 = first1;
+			const T* previous2 = first2;
+			for (long i = 1; i <= pieces; i++) {
+				const T* split1 = i == pieces ? last1 : first1 + (last1 - first1) * i / pieces;
+				const T* split2 = i == pieces ? last2 : std::lower_bound(previous2, last2, *split1, compare);
+				AutoPointer<TaskBase> task = autonew ParallelMergeTask<T, C>(previous1, split1, previous2, split2, output + (previous1 - first1) + (previous2 - first2), compare);
+				tasks.AddItem(task);
+				queue->PushTask(task);
+				previous1 = split1;
+				previous2 = split2;
+			}
+		}
+
+		template<typename T, typename C>
+		static void ParallelMergeSort(T* data, long count, TaskQueue* queue, const C& compare, bool stable)
+		{
+			static const long MinimumRunLength = 0x2000;
+
+			long threadCount = Math::Max(queue->GetThreadCount(), 1);
+			long runCount = Math::Min(threadCount * 2, count / MinimumRunLength);
+			if (runCount < 2) {
+				if (stable)
+					std::stable_sort(data, data + count, compare);
+				else
+					std::sort(data, data + count, compare);
+				return;
+			}
+
+			Collections::Array<AutoPointer<TaskBase> > tasks;
+			std::vector<long> runs;
+			for (long i = 0; i <= runCount; i++)
+				runs.push_back(count * i / runCount);
+
+			for (long i = 0; i < runCount; i++) {
+				AutoPointer<TaskBase> task = autonew ParallelSortTask<T, C>(data + runs[i], data + runs[i + 1], compare, stable);
+				tasks.AddItem(task);
+				queue->PushTask(task);
+			}
+			ParallelWaitTasks(tasks);
+
+			// Merges assign into the buffer, so it is filled by copy-construction; T need not be default-constructible.
+			std::vector<T> buffer;
+			buffer.reserve(count);
+			buffer.insert(buffer.end(), data, data + count);
+			T* source = data;
+			T* destination = &buffer[0];
+			while (runs.size() > 2) {
+				std::vector<long> merged;
+				long mergeCount = (runs.size() - 1) / 2;
+				long pieces = Math::Max(threadCount * 2 / mergeCount, 1);
+				size_t i;
+				for (i = 0; i + 2 < runs.size(); i += 2) {
+					merged.push_back(runs[i]);
+					ParallelMergeSplit(queue, tasks, source + runs[i], source + runs[i + 1], source + runs[i + 1], source + runs[i + 2], destination + runs[i], compare, pieces);
+				}
+				if (i + 1 < runs.size()) {
+					merged.push_back(runs[i]);
+					std::copy(source + runs[i], source + runs[i + 1], destination + runs[i]);
+				}
+				merged.push_back(count);
+				ParallelWaitTasks(tasks);
+
+				runs.swap(merged);
+				std::swap(source, destination);
+			}
+
+			if (source != data)
+				std::copy(source, source + count, data);
+		}
+
+		template<typename T, typename K>
+		class ParallelRadixHistogramTask : public TaskBase
+		{
+		protected:
+			const T* begin;
+			const T* end;
+			K key;
+			int digit;
+			long* histogram;
+
+			void Main()
+			{
+				typedef Collections::Internal::RadixPass<T, K> Pass;
+				std::fill(histogram, histogram + (digit < 0 ? Pass::Digits : 1) * Collections::Internal::RadixBuckets, 0);
+				if (digit < 0)
+					Pass::Histogram(begin, end, key, histogram);
+				else
+					Pass::Histogram(begin, end, key, digit, histogram);
+			}
+
+		public:
+			ParallelRadixHistogramTask(const T* begin, const T* end, const K& key, int digit, long* histogram) : begin(begin), end(end), key(key), digit(digit), histogram(histogram) { }
+		};
+
+		template<typename T, typename K>
+		class ParallelRadixScatterTask : public TaskBase
+		{
+		protected:
+			const T* begin;
+			const T* end;
+			K key;
+			int digit;
+			long* offsets;
+			T* output;
+
+			void Main() { Collections::Internal::RadixPass<T, K>::Scatter(begin, end, key, digit, offsets, output); }
+
+		public:
+			ParallelRadixScatterTask(const T* begin, const T* end, const K& key, int digit, long* offsets, T* output) : begin(begin), end(end), key(key), digit(digit), offsets(offsets), output(output) { }
+		};
+
+		// Each chunk counts its own digits and then scatters into the slots left for it after every lower chunk's
+		// elements of the same bucket, which keeps the passes stable across chunks.
+		template<typename T, typename K>
+		static void ParallelRadixSortRange(T* data, long count, TaskQueue* queue, const K& key)
+		{
+			typedef Collections::Internal::RadixPass<T, K> Pass;
+			static const long MinimumChunkLength = 0x4000;
+			static const int Buckets = Collections::Internal::RadixBuckets;
+
+			long chunkCount = Math::Min((long)Math::Max(queue->GetThreadCount(), 1), count / MinimumChunkLength);
+			if (chunkCount < 2) {
+				Collections::Internal::RadixSortRange(data, count, key);
+				return;
+			}
+
+			std::vector<long> chunks;
+			for (long i = 0; i <= chunkCount; i++)
+				chunks.push_back(count * i / chunkCount);
+
+			Collections::Array<AutoPointer<TaskBase> > tasks;
+			std::vector<long> histograms(chunkCount * Pass::Digits * Buckets);
+			for (long i = 0; i < chunkCount; i++) {
+				AutoPointer<TaskBase> task = autonew ParallelRadixHistogramTask<T, K>(data + chunks[i], data + chunks[i + 1], key, -1, &histograms[i * Pass::Digits * Buckets]);
+				tasks.AddItem(task);
+				queue->PushTask(task);
+			}
+			ParallelWaitTasks(tasks);
+
+			std::vector<long> totals(Pass::Digits * Buckets);
+			for (long i = 0; i < chunkCount; i++) {
+				for (int j = 0; j < Pass::Digits * Buckets; j++)
+					totals[j] += histograms[i * Pass::Digits * Buckets + j];
+			}
+
+			std::vector<T> buffer;
+			std::vector<long> offsets(chunkCount * Buckets);
+			T* source = data;
+			T* destination = NULL;
+			for (int digit = 0; digit < Pass::Digits; digit++) {
+				if (Pass::IsTrivialDigit(&totals[digit * Buckets], count))
+					continue;
+
+				if (!destination) {
+					// The initial histograms were taken from this ordering, so the first pass can reuse them.
+					buffer.resize(count);
+					destination = &buffer[0];
+					for (long i = 0; i < chunkCount; i++)
+						std::copy(&histograms[(i * Pass::Digits + digit) * Buckets], &histograms[(i * Pass::Digits + digit + 1) * Buckets], &offsets[i * Buckets]);
+				} else {
+					for (long i = 0; i < chunkCount; i++) {
+						AutoPointer<TaskBase> task = autonew ParallelRadixHistogramTask<T, K>(source + chunks[i], source + chunks[i + 1], key, digit, &offsets[i * Buckets]);
+						tasks.AddItem(task);
+						queue->PushTask(task);
+					}
+					ParallelWaitTasks(tasks);
+				}
+
+				long offset = 0;
+				for (int bucket = 0; bucket < Buckets; bucket++) {
+					for (long i = 0; i < chunkCount; i++) {
+						long size = offsets[i * Buckets + bucket];
+						offsets[i * Buckets + bucket] = offset;
+						offset += size;
+					}
+				}
+
+				for (long i = 0; i < chunkCount; i++) {
+					AutoPointer<TaskBase> task = autonew ParallelRadixScatterTask<T, K>(source + chunks[i], source + chunks[i + 1], key, digit, &offsets[i * Buckets], destination);
+					tasks.AddItem(task);
+					queue->PushTask(task);
+				}
+				ParallelWaitTasks(tasks);
+				std::swap(source, destination);
+			}
+
+			if (source != data)
+				std::copy(source, source + count, data);
+		}
+
+		struct ParallelRadixSorter
+		{
+			TaskQueue* queue;
+			ParallelRadixSorter(TaskQueue* queue) : queue(queue) { }
+			template<typename T, typename K> void operator ()(T* data, long count, const K& key) const { ParallelRadixSortRange(data, count, queue, key); }
+		};
+
+		class ParallelLocalQueue
+		{
+		protected:
+			AutoPointer<TaskQueue> localQueue;
+			TaskQueue* queue;
+
+		public:
+			ParallelLocalQueue(TaskQueue* queue) : queue(queue) {
+				if (!queue) {
+					localQueue = autonew TaskQueue();
+					localQueue->Start();
+					this->queue = localQueue;
+				}
+			}
+			~ParallelLocalQueue() { if (localQueue) localQueue->Stop(true); }
+
+			operator TaskQueue*() const { return queue; }
+		};
+
+		template<typename T>
+		static void ParallelSortArray(Collections::Array<T>* array, TaskQueue* queue, Collections::ValueComparison<T>* comparison, bool stable)
+		{
+			ParallelLocalQueue sortQueue(queue);
+			Collections::ValueComparison<T>* sortWith = comparison ?: array->GetComparison();
+			if (Collections::Internal::IsOperatorComparison(sortWith))
+				ParallelMergeSort(array->GetData(), array->GetCount(), sortQueue, Collections::Internal::OperatorLess<T>(), stable);
+			else
+				ParallelMergeSort(array->GetData(), array->GetCount(), sortQueue, Collections::Internal::ComparisonLess<T>(sortWith), stable);
+		}
+	}
+
+	// Sorts the array across the threads of a started TaskQueue, or a temporary one sized to the hardware if none is given.
+	// Must not be called from one of the queue's own tasks, as it blocks until the sort completes.
+	template<typename T> static inline void ParallelSort(Collections::Array<T>* array, TaskQueue* queue = NULL, Collections::ValueComparison<T>* comparison = NULL) { Internal::ParallelSortArray(array, queue, comparison, false); }
+	template<typename T> static inline void ParallelStableSort(Collections::Array<T>* array, TaskQueue* queue = NULL, Collections::ValueComparison<T>* comparison = NULL) { Internal::ParallelSortArray(array, queue, comparison, true); }
+
+	// Radix sorts split the histogram and scatter work of each digit across the queue, and are always stable.
+	template<typename T> static inline void ParallelRadixSort(Collections::Array<T>* array, TaskQueue* queue = NULL) { Internal::ParallelLocalQueue sortQueue(queue); Collections::Internal::RadixValueSorter<T>::Sort(array->GetData(), array->GetCount(), Internal::ParallelRadixSorter(sortQueue)); }
+	template<typename T, typename TKey> static inline void ParallelRadixSort(Collections::Array<T>* array, TKey (*key)(const T&), TaskQueue* queue = NULL) { Internal::ParallelLocalQueue sortQueue(queue); Collections::Internal::RadixSortKeys<TKey>(array->GetData(), array->GetCount(), key, Internal::ParallelRadixSorter(sortQueue)); }
+} }
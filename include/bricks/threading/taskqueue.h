@@ -37,6 +37,8 @@ namespace Bricks { namespace Threading {
 		TaskQueue(int threadCount = 0);
 		~TaskQueue();
 
+		int GetThreadCount() const { return threadCount; }
+
 		void PushTask(Internal::TaskBase* task);
 
 		void Start();
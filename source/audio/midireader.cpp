@@ -9,18 +9,6 @@ using namespace Bricks::IO;
 using namespace Bricks::Audio;
 
 namespace Bricks { namespace Audio {
-	static int ReadInteger(Stream* stream)
-	{
-		int ret = 0;
-		u8 num;
-		do {
-			num = stream->ReadByte();
-			ret <<= 7;
-			ret |= num & 0x7F;
-		} while (num & 0x80);
-		return ret;
-	}
-
 	static AutoPointer<MidiTimeDivision> ReadDivision(StreamReader* reader)
 	{
 		u16 division = reader->ReadInt16();
@@ -31,7 +19,8 @@ namespace Bricks { namespace Audio {
 
 	MidiReader::MidiReader(Stream* stream)
 	{
-		reader = autonew StreamReader(stream, Endian::BigEndian);
+		// Event data is read a byte at a time, so read ahead whenever the reader can seek the stream back afterwards.
+		reader = autonew StreamReader(stream, Endian::BigEndian, stream->CanSeek() ? 0x1000 : 0);
 
 		if (reader->ReadInt32() != MagicHeader1)
 			BRICKS_FEATURE_THROW(FormatException());
@@ -150,13 +139,13 @@ namespace Bricks { namespace Audio {
 		if (EndOfTrack())
 			BRICKS_FEATURE_THROW(InvalidOperationException());
 
-		u32 delta = ReadInteger(reader->GetStream());
+		u32 delta = reader->ReadVLQ();
 		u8 identifier = reader->ReadByte();
 
 		switch (identifier) {
 			case 0xFF: {
 						   MidiEventType::Enum type = (MidiEventType::Enum)reader->ReadByte();
-						   u32 length = ReadInteger(reader->GetStream());
+						   u32 length = reader->ReadVLQ();
 						   u8 data[length];
 						   reader->ReadBytes(data, length);
 						   return CreateMetaEvent(delta, type, length, data); }
@@ -0,0 +1,299 @@
+#include "bricks/compression/deflatestream.h"
+#include "bricks/threading/mutex.h"
+#include "bricks/io/streamnavigator.h"
+#include "bricks/core/math.h"
+
+#include <zlib.h>
+#include <string.h>
+#include <pthread.h>
+
+using namespace Bricks::IO;
+using namespace Bricks::Threading;
+
+namespace Bricks { namespace Compression {
+	// Each block records its size ahead of the address handed out, since zlib frees without one.
+	static const size_t DeflateBlockHeaderSize = 0x10;
+
+	static AutoPointer<DeflateBufferPool> defaultPool;
+	// Statically initialized, so it is usable before any constructor runs.
+	static pthread_mutex_t defaultPoolLock = PTHREAD_MUTEX_INITIALIZER;
+
+	DeflateBufferPool::DeflateBufferPool(size_t limit) :
+		lock(autonew Mutex()), retained(0), limit(limit)
+	{
+
+	}
+
+	DeflateBufferPool::~DeflateBufferPool()
+	{
+		for (std::map<size_t, std::vector<u8*> >::iterator iter = buffers.begin(); iter != buffers.end(); iter++) {
+			for (size_t i = 0; i < iter->second.size(); i++)
+				delete[] iter->second[i];
+		}
+	}
+
+	DeflateBufferPool* DeflateBufferPool::GetDefault()
+	{
+		pthread_mutex_lock(&defaultPoolLock);
+		if (!defaultPool)
+			defaultPool = autonew DeflateBufferPool();
+		DeflateBufferPool* pool = defaultPool;
+		pthread_mutex_unlock(&defaultPoolLock);
+		return pool;
+	}
+
+	void* DeflateBufferPool::Acquire(size_t size)
+	{
+		u8* block = NULL;
+		lock->Lock();
+		std::map<size_t, std::vector<u8*> >::iterator iter = buffers.find(size);
+		if (iter != buffers.end() && !iter->second.empty()) {
+			block = iter->second.back();
+			iter->second.pop_back();
+			retained -= size;
+		}
+		lock->Unlock();
+
+		if (!block) {
+			block = new u8[DeflateBlockHeaderSize + size];
+			memcpy(block, &size, sizeof(size));
+		}
+		return block + DeflateBlockHeaderSize;
+	}
+
+	void DeflateBufferPool::Release(void* buffer)
+	{
+		if (!buffer)
+			return;
+		u8* block = (u8*)buffer - DeflateBlockHeaderSize;
+		size_t size;
+		memcpy(&size, block, sizeof(size));
+
+		lock->Lock();
+		bool keep = retained + size <= limit;
+		if (keep) {
+			buffers[size].push_back(block);
+			retained += size;
+		}
+		lock->Unlock();
+
+		if (!keep)
+			delete[] block;
+	}
+
+	static voidpf DeflateAllocate(voidpf opaque, uInt items, uInt size)
+	{
+		return static_cast<DeflateBufferPool*>(opaque)->Acquire((size_t)items * size);
+	}
+
+	static void DeflateFree(voidpf opaque, voidpf address)
+	{
+		static_cast<DeflateBufferPool*>(opaque)->Release(address);
+	}
+
+	static int DeflateWindowBits(DeflateFormat::Enum format, int windowBits)
+	{
+		if (windowBits < 9 || windowBits > 15)
+			BRICKS_FEATURE_THROW(InvalidArgumentException("windowBits"));
+		switch (format) {
+			case DeflateFormat::Raw: return -windowBits;
+			case DeflateFormat::Zlib: return windowBits;
+			case DeflateFormat::Gzip: return windowBits + 16;
+			case DeflateFormat::Automatic: return windowBits + 32;
+		}
+		BRICKS_FEATURE_THROW(InvalidArgumentException("format"));
+	}
+
+	static z_stream* CreateZStream(DeflateBufferPool* pool)
+	{
+		z_stream* zstream = static_cast<z_stream*>(pool->Acquire(sizeof(z_stream)));
+		memset(zstream, 0, sizeof(z_stream));
+		zstream->zalloc = DeflateAllocate;
+		zstream->zfree = DeflateFree;
+		zstream->opaque = pool;
+		return zstream;
+	}
+
+	DeflateStream::DeflateStream(Stream* stream, DeflateFormat::Enum format, int level, int windowBits, size_t bufferSize, DeflateBufferPool* pool) :
+		stream(stream), pool(pool ?: DeflateBufferPool::GetDefault()), zstream(NULL), buffer(NULL), bufferSize(bufferSize), finished(false)
+	{
+		if (format == DeflateFormat::Automatic || level < -1 || level > 9 || !bufferSize)
+			BRICKS_FEATURE_THROW(InvalidArgumentException());
+		int bits = DeflateWindowBits(format, windowBits);
+
+		zstream = CreateZStream(this->pool);
+		int result = deflateInit2(zstream, level, Z_DEFLATED, bits, 8, Z_DEFAULT_STRATEGY);
+		if (result != Z_OK) {
+			this->pool->Release(zstream);
+			zstream = NULL;
+			BRICKS_FEATURE_THROW(ZlibException(result));
+		}
+		buffer = static_cast<u8*>(this->pool->Acquire(bufferSize));
+	}
+
+	DeflateStream::~DeflateStream()
+	{
+		// Errors cannot leave a destructor, so they are dropped here.
+		BRICKS_FEATURE_TRY {
+			Finish();
+		} BRICKS_FEATURE_CATCH_ALL { }
+		deflateEnd(zstream);
+		pool->Release(zstream);
+		pool->Release(buffer);
+	}
+
+	// Runs deflate over whatever input is pending, writing each full buffer of output to the stream.
+	void DeflateStream::Deflate(int flush)
+	{
+		int result;
+		do {
+			zstream->next_out = buffer;
+			zstream->avail_out = bufferSize;
+			result = deflate(zstream, flush);
+			if (result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR)
+				BRICKS_FEATURE_THROW(ZlibException(result, zstream->msg ?: ""));
+			size_t size = bufferSize - zstream->avail_out;
+			if (size && stream->Write(buffer, size) != size)
+				BRICKS_FEATURE_THROW(StreamException());
+		} while (!zstream->avail_out || (flush == Z_FINISH && result != Z_STREAM_END));
+	}
+
+	size_t DeflateStream::Write(const void* data, size_t size)
+	{
+		if (finished)
+			BRICKS_FEATURE_THROW(InvalidOperationException());
+		const u8* source = static_cast<const u8*>(data);
+		size_t remaining = size;
+		while (remaining) {
+			// avail_in is only 32 bits wide.
+			uInt chunk = Math::Min(remaining, (size_t)0x40000000);
+			zstream->next_in = const_cast<u8*>(source);
+			zstream->avail_in = chunk;
+			Deflate(Z_NO_FLUSH);
+			source += chunk;
+			remaining -= chunk;
+		}
+		return size;
+	}
+
+	void DeflateStream::Flush()
+	{
+		if (!finished)
+			Deflate(Z_SYNC_FLUSH);
+		stream->Flush();
+	}
+
+	void DeflateStream::Finish()
+	{
+		if (finished)
+			return;
+		finished = true;
+		zstream->avail_in = 0;
+		Deflate(Z_FINISH);
+		stream->Flush();
+	}
+
+	u64 DeflateStream::GetUncompressedSize() const
+	{
+		return zstream->total_in;
+	}
+
+	u64 DeflateStream::GetCompressedSize() const
+	{
+		return zstream->total_out;
+	}
+
+	InflateStream::InflateStream(Stream* stream, DeflateFormat::Enum format, int windowBits, size_t bufferSize, DeflateBufferPool* pool) :
+		stream(stream), pool(pool ?: DeflateBufferPool::GetDefault()), zstream(NULL), input(NULL), output(NULL), bufferSize(bufferSize),
+		outputCursor(NULL), outputEnd(NULL), position(0), finished(false)
+	{
+		if (!bufferSize)
+			BRICKS_FEATURE_THROW(InvalidArgumentException());
+		int bits = DeflateWindowBits(format, windowBits);
+
+		zstream = CreateZStream(this->pool);
+		int result = inflateInit2(zstream, bits);
+		if (result != Z_OK) {
+			this->pool->Release(zstream);
+			zstream = NULL;
+			BRICKS_FEATURE_THROW(ZlibException(result));
+		}
+		input = static_cast<u8*>(this->pool->Acquire(bufferSize));
+		output = static_cast<u8*>(this->pool->Acquire(bufferSize));
+		outputCursor = outputEnd = output;
+	}
+
+	InflateStream::~InflateStream()
+	{
+		inflateEnd(zstream);
+		pool->Release(zstream);
+		pool->Release(input);
+		pool->Release(output);
+	}
+
+	// Decodes into buffer, returning how much was decoded. The source is only read again while nothing has been decoded, so
+	// data that was flushed can be read without waiting for more to arrive.
+	size_t InflateStream::Inflate(void* buffer, size_t size)
+	{
+		zstream->next_out = static_cast<u8*>(buffer);
+		zstream->avail_out = Math::Min(size, (size_t)0x40000000);
+		while (zstream->avail_out && !finished) {
+			if (!zstream->avail_in) {
+				if (static_cast<u8*>(zstream->next_out) != buffer)
+					break;
+				size_t read = stream->Read(input, bufferSize);
+				if (!read)
+					BRICKS_FEATURE_THROW(ZlibException(Z_BUF_ERROR, "Unexpected end of compressed data"));
+				zstream->next_in = input;
+				zstream->avail_in = read;
+			}
+			int result = inflate(zstream, Z_NO_FLUSH);
+			if (result == Z_STREAM_END) {
+				finished = true;
+				// Hand back what was read past the end, so whatever follows the compressed data can be read from the source.
+				if (zstream->avail_in && stream->CanSeek())
+					stream->SetPosition(stream->GetPosition() - zstream->avail_in);
+				zstream->avail_in = 0;
+			} else if (result != Z_OK)
+				BRICKS_FEATURE_THROW(ZlibException(result, zstream->msg ?: ""));
+		}
+		return static_cast<u8*>(zstream->next_out) - static_cast<u8*>(buffer);
+	}
+
+	void InflateStream::FillOutput()
+	{
+		outputCursor = output;
+		outputEnd = output + Inflate(output, bufferSize);
+	}
+
+	size_t InflateStream::Read(void* buffer, size_t size)
+	{
+		u8* destination = static_cast<u8*>(buffer);
+		size_t total = 0;
+		while (total < size) {
+			if (outputCursor == outputEnd) {
+				if (finished)
+					break;
+				// Large reads decode straight into the caller's buffer.
+				if (size - total >= bufferSize) {
+					total += Inflate(destination + total, size - total);
+					continue;
+				}
+				FillOutput();
+			}
+			size_t count = Math::Min(size - total, (size_t)(outputEnd - outputCursor));
+			memcpy(destination + total, outputCursor, count);
+			outputCursor += count;
+			total += count;
+		}
+		position += total;
+		return total;
+	}
+
+	u64 InflateStream::GetLength() const
+	{
+		if (outputCursor == outputEnd && !finished)
+			const_cast<InflateStream*>(this)->FillOutput();
+		return position + (outputEnd - outputCursor);
+	}
+} }
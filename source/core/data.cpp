@@ -48,6 +48,15 @@ namespace Bricks {
 		owned = true;
 	}
 
+	void Data::Adopt(u8* value, size_t length)
+	{
+		if (data && owned)
+			delete[] data;
+		data = value;
+		this->length = length;
+		owned = true;
+	}
+
 	void Data::CopyFrom(const void* value, size_t len, size_t offset)
 	{
 		memcpy(data + offset, value, Math::Min(len, length - offset));
@@ -1,11 +1,17 @@
 #include "bricks/imaging/font.h"
 #include "bricks/imaging/bitmap.h"
 #include "bricks/collections/array.h"
+#include "bricks/collections/smallarray.h"
 #include "bricks/core/math.h"
 
 using namespace Bricks::Collections;
 
 namespace Bricks { namespace Imaging {
+	size_t Font::GlyphCost(const String::Character& character, const AutoPointer<FontGlyph>& glyph)
+	{
+		return sizeof(FontGlyph) + (size_t)Math::Max(glyph->GetWidth(), 0) * Math::Max(glyph->GetHeight(), 0) * 4;
+	}
+
 	struct RenderedGlyph {
 		AutoPointer<FontGlyph> glyph;
 		s32 line;
@@ -93,7 +99,7 @@ namespace Bricks { namespace Imaging {
 
 		s32 line = 0;
 		s32 width = 0;
-		Array<s32> lineLengths;
+		SmallArray<s32, 8> lineLengths;
 		foreach (const RenderedGlyph& glyph, glyphs) {
 			while (line < glyph.line) {
 				lineLengths.AddItem(width);
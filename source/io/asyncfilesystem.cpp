@@ -0,0 +1,557 @@
+#include "bricks/io/asyncfilesystem.h"
+#include "bricks/threading/condition.h"
+#include "bricks/threading/mutexlock.h"
+#include "bricks/threading/thread.h"
+#include "bricks/collections/autoarray.h"
+#include "bricks/collections/queue.h"
+
+#include <errno.h>
+#include <string.h>
+#include <set>
+
+#if BRICKS_ENV_LINUX
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define BRICKS_ASYNC_URING 1
+#endif
+#endif
+
+using namespace Bricks::Threading;
+
+namespace Bricks { namespace IO {
+	namespace Internal {
+		class AsyncEngineBase : public Object, NoCopy
+		{
+		protected:
+			AsyncFilesystem* owner;
+
+			void Finish(AsyncRequest* request, s64 result) { owner->Finish(request, result); }
+			static IOVector* GetVector(AsyncRequest* request) { return &request->vector; }
+
+		public:
+			AsyncEngineBase(AsyncFilesystem* owner) : owner(owner) { }
+
+			virtual AsyncEngine::Enum GetType() const = 0;
+			// Called with requests that already hold a reference for the engine; they must all be finished eventually.
+			virtual void Submit(AsyncRequest* const* requests, int count) = 0;
+			// Waits for everything submitted to finish and shuts down the I/O threads.
+			virtual void Stop() = 0;
+		};
+
+		class AsyncThreadEngine;
+		struct AsyncThreadWorker
+		{
+			AsyncThreadEngine* engine;
+
+			AsyncThreadWorker(AsyncThreadEngine* engine) : engine(engine) { }
+
+			void operator()() const;
+		};
+
+		// Blocking positional calls spread across a pool of threads, one request per thread at a time.
+		class AsyncThreadEngine : public AsyncEngineBase
+		{
+		protected:
+			AutoPointer<Condition> queueCondition;
+			Collections::Queue<AsyncRequest*> queue;
+			Collections::AutoArray<Thread> threads;
+			AutoPointer<Mutex> transferLock;
+			bool stopping;
+
+			friend struct AsyncThreadWorker;
+
+			void Transfer(AsyncRequest* request)
+			{
+				s64 result;
+				Filesystem* filesystem = owner->GetFilesystem();
+				// Filesystems without positional calls seek the shared descriptor, so their transfers must not overlap.
+				if (transferLock)
+					transferLock->Lock();
+				BRICKS_FEATURE_TRY {
+					if (request->IsWrite())
+						result = filesystem->WriteVector(request->GetHandle(), GetVector(request), 1, request->GetOffset());
+					else
+						result = filesystem->ReadVector(request->GetHandle(), GetVector(request), 1, request->GetOffset());
+				} BRICKS_FEATURE_CATCH_EXCEPTION(ErrnoException, ex) {
+					result = -(ex.Value ?: EIO);
+				} BRICKS_FEATURE_CATCH_ALL {
+					result = -EIO;
+				}
+				if (transferLock)
+					transferLock->Unlock();
+				Finish(request, result);
+			}
+
+		public:
+			AsyncThreadEngine(AsyncFilesystem* owner, int threadCount) : AsyncEngineBase(owner), queueCondition(autonew Condition()), stopping(false)
+			{
+#if BRICKS_ENV_MINGW
+				transferLock = autonew Mutex();
+#else
+				if (!CastToDynamic<PosixFilesystem>(owner->GetFilesystem()))
+					transferLock = autonew Mutex();
+#endif
+				for (int i = 0; i < threadCount; i++) {
+					AutoPointer<Thread> thread = autonew Thread(AsyncThreadWorker(this));
+					thread->Start();
+					threads.AddItem(thread);
+				}
+			}
+
+			AsyncEngine::Enum GetType() const { return AsyncEngine::Threads; }
+
+			void Submit(AsyncRequest* const* requests, int count)
+			{
+				MutexLock lock(queueCondition);
+				for (int i = 0; i < count; i++)
+					queue.Push(requests[i]);
+				if (count == 1)
+					queueCondition->Signal();
+				else if (count)
+					queueCondition->Broadcast();
+			}
+
+			void Stop()
+			{
+				{	MutexLock lock(queueCondition);
+					if (stopping)
+						return;
+					stopping = true;
+					queueCondition->Broadcast();
+				}
+				foreach (Thread* thread, threads)
+					thread->Wait();
+			}
+		};
+
+		void AsyncThreadWorker::operator()() const
+		{
+			Condition* condition = engine->queueCondition;
+			while (true) {
+				MutexLock lock(condition);
+				while (!engine->queue.GetCount() && !engine->stopping)
+					condition->Wait();
+				if (!engine->queue.GetCount())
+					break;
+				AsyncRequest* request = engine->queue.PopItem();
+				lock.Unlock();
+
+				engine->Transfer(request);
+			}
+		}
+
+#if BRICKS_ASYNC_URING
+		static int UringSetup(unsigned entries, struct io_uring_params* params) { return syscall(__NR_io_uring_setup, entries, params); }
+		static int UringEnter(int fd, unsigned submit, unsigned complete, unsigned flags) { return syscall(__NR_io_uring_enter, fd, submit, complete, flags, NULL, 0); }
+
+		class AsyncUringEngine;
+		struct AsyncUringReaper
+		{
+			AsyncUringEngine* engine;
+
+			AsyncUringReaper(AsyncUringEngine* engine) : engine(engine) { }
+
+			void operator()() const;
+		};
+
+		// A kernel submission/completion ring set up through the raw system calls. Submitters fill entries under slotCondition
+		// and enter them in one call per batch; a reaper thread blocks for completions and finishes their requests.
+		// In-flight requests are capped at the completion ring size so the kernel never has to drop or overflow a completion.
+		// If waiting for completions ever fails outright, every request in flight is finished with that error, as is every
+		// request submitted afterwards.
+		class AsyncUringEngine : public AsyncEngineBase
+		{
+		protected:
+			int fd;
+			void* sqRing;
+			size_t sqRingSize;
+			void* cqRing;
+			size_t cqRingSize;
+			struct io_uring_sqe* sqes;
+			size_t sqesSize;
+			unsigned* sqHead;
+			unsigned* sqTail;
+			unsigned* sqMask;
+			unsigned* sqArray;
+			unsigned sqEntries;
+			unsigned* cqHead;
+			unsigned* cqTail;
+			unsigned* cqMask;
+			struct io_uring_cqe* cqes;
+			unsigned cqEntries;
+			AutoPointer<Condition> slotCondition;
+			std::set<AsyncRequest*> inflightRequests;
+			unsigned inflight;
+			int failure;
+			unsigned unsubmitted;
+			AutoPointer<Thread> reaper;
+			bool stopped;
+
+			friend struct AsyncUringReaper;
+
+			void Push(u8 opcode, int handle, const void* address, u32 length, u64 offset, u64 userData)
+			{
+				if (*sqTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) >= sqEntries)
+					Enter();
+				unsigned tail = *sqTail;
+				unsigned index = tail & *sqMask;
+				struct io_uring_sqe* sqe = sqes + index;
+				memset(sqe, 0, sizeof(*sqe));
+				sqe->opcode = opcode;
+				sqe->fd = handle;
+				sqe->addr = (u64)(size_t)address;
+				sqe->len = length;
+				sqe->off = offset;
+				sqe->user_data = userData;
+				sqArray[index] = index;
+				__atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+				unsubmitted++;
+			}
+
+			void Enter()
+			{
+				while (unsubmitted) {
+					int ret = UringEnter(fd, unsubmitted, 0, 0);
+					if (ret < 0) {
+						if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+							continue;
+						ThrowErrno();
+					}
+					unsubmitted -= ret;
+				}
+			}
+
+			void Reap()
+			{
+				while (true) {
+					unsigned head = *cqHead;
+					unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+					if (head == tail) {
+						if (UringEnter(fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+							Fail(errno);
+							return;
+						}
+						continue;
+					}
+
+					bool stop = false;
+					std::vector<AsyncRequest*> completed;
+					for (; head != tail; head++) {
+						struct io_uring_cqe* cqe = cqes + (head & *cqMask);
+						AsyncRequest* request = (AsyncRequest*)(size_t)cqe->user_data;
+						if (request) {
+							Finish(request, cqe->res);
+							completed.push_back(request);
+						} else
+							stop = true;
+					}
+					__atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+
+					if (!completed.empty()) {
+						MutexLock lock(slotCondition);
+						for (size_t i = 0; i < completed.size(); i++)
+							inflightRequests.erase(completed[i]);
+						inflight -= completed.size();
+						slotCondition->Broadcast();
+					}
+					if (stop)
+						return;
+				}
+			}
+
+			// Gives up on the ring: whatever is still in flight will never be reaped, so it is finished with the error instead.
+			void Fail(int error)
+			{
+				std::set<AsyncRequest*> requests;
+				{	MutexLock lock(slotCondition);
+					failure = error ?: EIO;
+					requests.swap(inflightRequests);
+					inflight = 0;
+					slotCondition->Broadcast();
+				}
+				for (std::set<AsyncRequest*>::const_iterator iter = requests.begin(); iter != requests.end(); iter++)
+					Finish(*iter, -failure);
+			}
+
+			void Unmap()
+			{
+				if (sqes)
+					munmap(sqes, sqesSize);
+				if (cqRing && cqRing != sqRing)
+					munmap(cqRing, cqRingSize);
+				if (sqRing)
+					munmap(sqRing, sqRingSize);
+				if (fd >= 0)
+					close(fd);
+				sqes = NULL;
+				sqRing = cqRing = NULL;
+				fd = -1;
+			}
+
+		public:
+			AsyncUringEngine(AsyncFilesystem* owner) : AsyncEngineBase(owner),
+				fd(-1), sqRing(NULL), sqRingSize(0), cqRing(NULL), cqRingSize(0), sqes(NULL), sqesSize(0),
+				slotCondition(autonew Condition()), inflight(0), failure(0), unsubmitted(0), stopped(true)
+			{
+
+			}
+
+			~AsyncUringEngine()
+			{
+				Stop();
+				Unmap();
+			}
+
+			bool Open(int queueDepth)
+			{
+				struct io_uring_params params;
+				memset(&params, 0, sizeof(params));
+				fd = UringSetup(queueDepth, &params);
+				if (fd < 0)
+					return false;
+
+				sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+				cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+				bool single = false;
+#ifdef IORING_FEAT_SINGLE_MMAP
+				single = params.features & IORING_FEAT_SINGLE_MMAP;
+				if (single)
+					sqRingSize = cqRingSize = sqRingSize > cqRingSize ? sqRingSize : cqRingSize;
+#endif
+				sqRing = mmap(NULL, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+				if (sqRing == MAP_FAILED) {
+					sqRing = NULL;
+					Unmap();
+					return false;
+				}
+				if (single)
+					cqRing = sqRing;
+				else {
+					cqRing = mmap(NULL, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+					if (cqRing == MAP_FAILED) {
+						cqRing = NULL;
+						Unmap();
+						return false;
+					}
+				}
+				sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+				sqes = (struct io_uring_sqe*)mmap(NULL, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+				if (sqes == MAP_FAILED) {
+					sqes = NULL;
+					Unmap();
+					return false;
+				}
+
+				u8* sq = (u8*)sqRing;
+				sqHead = (unsigned*)(sq + params.sq_off.head);
+				sqTail = (unsigned*)(sq + params.sq_off.tail);
+				sqMask = (unsigned*)(sq + params.sq_off.ring_mask);
+				sqArray = (unsigned*)(sq + params.sq_off.array);
+				sqEntries = params.sq_entries;
+				u8* cq = (u8*)cqRing;
+				cqHead = (unsigned*)(cq + params.cq_off.head);
+				cqTail = (unsigned*)(cq + params.cq_off.tail);
+				cqMask = (unsigned*)(cq + params.cq_off.ring_mask);
+				cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+				cqEntries = params.cq_entries;
+
+				stopped = false;
+				reaper = autonew Thread(AsyncUringReaper(this));
+				reaper->Start();
+				return true;
+			}
+
+			AsyncEngine::Enum GetType() const { return AsyncEngine::Uring; }
+
+			void Submit(AsyncRequest* const* requests, int count)
+			{
+				int i = 0;
+				{	MutexLock lock(slotCondition);
+					for (; i < count && !failure; i++) {
+						while (inflight >= cqEntries && !failure) {
+							Enter();
+							slotCondition->Wait();
+						}
+						if (failure)
+							break;
+						AsyncRequest* request = requests[i];
+						Push(request->IsWrite() ? IORING_OP_WRITEV : IORING_OP_READV, (int)request->GetHandle(), GetVector(request), 1, request->GetOffset(), (u64)(size_t)request);
+						inflightRequests.insert(request);
+						inflight++;
+					}
+					if (!failure)
+						Enter();
+				}
+				// Requests the failed ring can no longer take are finished outside the lock, since their delegates run here.
+				for (; i < count; i++)
+					Finish(requests[i], -failure);
+			}
+
+			void Stop()
+			{
+				if (stopped)
+					return;
+				{	MutexLock lock(slotCondition);
+					while (inflight)
+						slotCondition->Wait();
+					// A completion without a request tells the reaper to exit, unless it already has.
+					if (!failure) {
+						Push(IORING_OP_NOP, -1, NULL, 0, 0, 0);
+						Enter();
+					}
+				}
+				reaper->Wait();
+				stopped = true;
+			}
+		};
+
+		void AsyncUringReaper::operator()() const
+		{
+			engine->Reap();
+		}
+#endif
+	}
+
+	AsyncRequest::AsyncRequest(AsyncFilesystem* owner, FileHandle handle, const IOVector& vector, u64 offset, bool write, const CompletionDelegate& delegate) :
+		owner(owner), delegate(delegate), handle(handle), vector(vector), offset(offset), write(write), submitted(false), completed(false), result(0)
+	{
+
+	}
+
+	size_t AsyncRequest::Wait()
+	{
+		if (!completed) {
+			if (!submitted)
+				owner->Submit();
+			{	MutexLock lock(owner->completion);
+				while (!completed)
+					owner->completion->Wait();
+			}
+		}
+		if (result < 0) {
+			errno = -result;
+			ThrowErrno();
+		}
+		return result;
+	}
+
+	AsyncFilesystem::AsyncFilesystem(Filesystem* filesystem, int queueDepth, AsyncEngine::Enum engine) :
+		filesystem(filesystem ?: Filesystem::GetDefault()), submitLock(autonew Mutex()), completion(autonew Condition()), batchDepth(0)
+	{
+		if (queueDepth < 1)
+			queueDepth = 1;
+#if BRICKS_ASYNC_URING
+		if (engine != AsyncEngine::Threads && CastToDynamic<PosixFilesystem>(this->filesystem)) {
+			AutoPointer<Internal::AsyncUringEngine> uring = autonew Internal::AsyncUringEngine(this);
+			if (uring->Open(queueDepth < 4096 ? queueDepth : 4096))
+				this->engine = uring;
+		}
+#endif
+		if (!this->engine) {
+			if (engine == AsyncEngine::Uring)
+				BRICKS_FEATURE_THROW(NotSupportedException());
+			this->engine = autonew Internal::AsyncThreadEngine(this, queueDepth < 64 ? queueDepth : 64);
+		}
+	}
+
+	AsyncFilesystem::~AsyncFilesystem()
+	{
+		batchDepth = 0;
+		Submit();
+		engine->Stop();
+		ReleaseFinished();
+	}
+
+	bool AsyncFilesystem::IsUringSupported()
+	{
+#if BRICKS_ASYNC_URING
+		struct io_uring_params params;
+		memset(&params, 0, sizeof(params));
+		int fd = Internal::UringSetup(1, &params);
+		if (fd < 0)
+			return false;
+		close(fd);
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	AsyncEngine::Enum AsyncFilesystem::GetEngine() const
+	{
+		return engine->GetType();
+	}
+
+	ReturnPointer<AsyncRequest> AsyncFilesystem::Read(FileHandle handle, void* buffer, size_t size, u64 offset, const AsyncRequest::CompletionDelegate& delegate)
+	{
+		return Queue(handle, IOVector(buffer, size), offset, false, delegate);
+	}
+
+	ReturnPointer<AsyncRequest> AsyncFilesystem::Write(FileHandle handle, const void* buffer, size_t size, u64 offset, const AsyncRequest::CompletionDelegate& delegate)
+	{
+		return Queue(handle, IOVector(buffer, size), offset, true, delegate);
+	}
+
+	ReturnPointer<AsyncRequest> AsyncFilesystem::Queue(FileHandle handle, const IOVector& vector, u64 offset, bool write, const AsyncRequest::CompletionDelegate& delegate)
+	{
+		ReleaseFinished();
+
+		AutoPointer<AsyncRequest> request = autonew AsyncRequest(this, handle, vector, offset, write, delegate);
+		// The engine's reference is dropped by ReleaseFinished, only ever here and in the destructor.
+		AutoPointer<>::Retain(request);
+		{	MutexLock lock(submitLock);
+			pending.push_back(request);
+		}
+		if (!batchDepth)
+			Submit();
+		return request;
+	}
+
+	void AsyncFilesystem::BeginBatch()
+	{
+		batchDepth++;
+	}
+
+	void AsyncFilesystem::EndBatch()
+	{
+		if (batchDepth > 0 && !--batchDepth)
+			Submit();
+	}
+
+	void AsyncFilesystem::Submit()
+	{
+		std::vector<AsyncRequest*> requests;
+		{	MutexLock lock(submitLock);
+			requests.swap(pending);
+		}
+		if (requests.empty())
+			return;
+		for (size_t i = 0; i < requests.size(); i++)
+			requests[i]->submitted = true;
+		engine->Submit(&requests[0], requests.size());
+	}
+
+	void AsyncFilesystem::Finish(AsyncRequest* request, s64 result)
+	{
+		request->result = result;
+		if (request->delegate)
+			request->delegate.Call(request);
+		MutexLock lock(completion);
+		request->completed = true;
+		finished.push_back(request);
+		completion->Broadcast();
+	}
+
+	void AsyncFilesystem::ReleaseFinished()
+	{
+		std::vector<AsyncRequest*> requests;
+		{	MutexLock lock(completion);
+			requests.swap(finished);
+		}
+		for (size_t i = 0; i < requests.size(); i++)
+			AutoPointer<>::Release(requests[i]);
+	}
+} }
@@ -1,103 +1,216 @@
 #include "bricks/io/cachestream.h"
+#include "bricks/io/streamnavigator.h"
 #include "bricks/core/exception.h"
 #include "bricks/core/math.h"
 
+#include <string.h>
+#include <algorithm>
+
 namespace Bricks { namespace IO {
-	CacheStream::CacheStream(Stream* stream, u32 cacheSize) :
-		stream(stream), cacheSize(cacheSize),
-		cacheDirty(true), cacheOffset(0), cacheLength(0), cachePosition(0)
+	CacheStream::CacheStream(Stream* stream, u32 cacheSize, u32 pageCount) :
+		stream(stream), cacheSize(cacheSize), pageCount(pageCount ?: 1),
+		useCounter(0), lastPage(-1), readAhead(0)
 	{
-		cache = new u8[cacheSize];
-		length = stream->GetLength();
-		position = stream->GetPosition();
+		cache = new u8[(size_t)cacheSize * this->pageCount];
+		pages.resize(this->pageCount);
+		for (u32 i = 0; i < this->pageCount; i++) {
+			pages[i].data = cache + (size_t)cacheSize * i;
+			pages[i].valid = false;
+			pages[i].dirty = false;
+		}
+		length = streamLength = stream->GetLength();
+		position = streamPosition = stream->GetPosition();
 	}
 
 	CacheStream::~CacheStream()
 	{
+		// Errors cannot leave a destructor, so they are dropped here.
+		BRICKS_FEATURE_TRY {
+			WritePages();
+		} BRICKS_FEATURE_CATCH_ALL { }
 		delete[] cache;
 	}
 
-	void CacheStream::FillCache()
+	void CacheStream::SeekStream(u64 position)
 	{
-		if (cacheDirty)
-			FlushCache();
-
-		if (position != cachePosition + cacheOffset)
+		if (position != streamPosition)
 			stream->SetPosition(position);
-		cachePosition = position;
-		cacheLength = stream->Read(cache, cacheSize);
-		cacheOffset = 0;
+		streamPosition = position;
 	}
 
-	void CacheStream::FlushCache()
+	CacheStream::Page* CacheStream::FindPage(u64 index)
 	{
-		if (cacheDirty) {
-			if (cacheOffset && stream->Write(cache, cacheOffset) != cacheOffset)
-				BRICKS_FEATURE_THROW(Exception());
+		for (u32 i = 0; i < pageCount; i++) {
+			if (pages[i].valid && pages[i].index == index)
+				return &pages[i];
 		}
+		return NULL;
+	}
 
-		cachePosition += cacheLength;
-
-		cacheDirty = false;
-		cacheOffset = 0;
-		cacheLength = 0;
+	CacheStream::Page* CacheStream::AllocatePage(u64 index)
+	{
+		Page* victim = &pages[0];
+		for (u32 i = 0; i < pageCount; i++) {
+			if (!pages[i].valid) {
+				victim = &pages[i];
+				break;
+			}
+			if (pages[i].lastUsed < victim->lastUsed)
+				victim = &pages[i];
+		}
+		if (victim->valid) {
+			statistics.evictions++;
+			WritePage(victim);
+		}
+		victim->index = index;
+		victim->length = 0;
+		victim->valid = true;
+		victim->dirty = false;
+		victim->lastUsed = ++useCounter;
+		return victim;
 	}
 
-	void CacheStream::DirtyCache()
+	void CacheStream::FillPage(Page* page)
 	{
-		cacheDirty = false;
-		cachePosition = position;
-		cacheOffset = 0;
-		cacheLength = 0;
+		u64 offset = page->index * cacheSize;
+		u32 size = 0;
+		if (offset < streamLength) {
+			SeekStream(offset);
+			size = stream->Read(page->data, Math::Min((u64)cacheSize, streamLength - offset));
+			streamPosition += size;
+		}
+		// Anything between the inner stream's end and our logical length was extended by SetLength or a sparse write.
+		u32 logical = offset < length ? Math::Min((u64)cacheSize, length - offset) : 0;
+		if (size < logical) {
+			memset(page->data + size, 0, logical - size);
+			size = logical;
+		}
+		page->length = size;
 	}
 
-	void CacheStream::Flush()
+	void CacheStream::PrefetchPages(u64 index)
 	{
-		FlushCache();
-		stream->Flush();
+		for (u32 i = 1; i <= readAhead; i++) {
+			if ((index + i) * cacheSize >= streamLength)
+				break;
+			if (!FindPage(index + i))
+				FillPage(AllocatePage(index + i));
+		}
 	}
 
-	size_t CacheStream::Read(void* buffer, size_t size)
+	CacheStream::Page* CacheStream::GetPage(u64 index, bool fill, bool prefetch)
 	{
-		size_t length = 0;
+		bool sequential = index == lastPage + 1;
+		lastPage = index;
+
+		Page* page = FindPage(index);
+		if (page) {
+			statistics.hits++;
+			page->lastUsed = ++useCounter;
+			return page;
+		}
 
-		if (cacheDirty)
-			FlushCache();
+		statistics.misses++;
+		page = AllocatePage(index);
+		if (fill)
+			FillPage(page);
+
+		if (!prefetch)
+			return page;
+		if (sequential) {
+			// Read-ahead never takes more than half the pages, so it cannot evict the page just loaded.
+			readAhead = Math::Min(Math::Max(readAhead * 2, 1u), pageCount / 2);
+			PrefetchPages(index);
+			page->lastUsed = ++useCounter;
+		} else
+			readAhead = 0;
+		return page;
+	}
 
-		if (position >= cachePosition && position < cachePosition + cacheLength) {
-			length = Math::Min(size, cacheLength - cacheOffset);
-			if (length) {
-				memcpy(buffer, cache + cacheOffset, length);
-				cacheOffset += length;
-				position += length;
-			}
+	void CacheStream::WritePage(Page* page)
+	{
+		if (!page->dirty)
+			return;
+		SeekStream(page->index * cacheSize);
+		if (stream->Write(page->data, page->length) != page->length)
+			BRICKS_FEATURE_THROW(StreamException());
+		streamPosition += page->length;
+		streamLength = Math::Max(streamLength, streamPosition);
+		page->dirty = false;
+	}
 
-			if (length >= size)
-				return length;
+	void CacheStream::WritePages()
+	{
+		std::vector<Page*> dirty;
+		for (u32 i = 0; i < pageCount; i++) {
+			if (pages[i].valid && pages[i].dirty)
+				dirty.push_back(&pages[i]);
 		}
+		std::sort(dirty.begin(), dirty.end(), PageIndexLess);
+		for (size_t i = 0; i < dirty.size(); i++)
+			WritePage(dirty[i]);
+	}
 
-		FillCache();
-		return length + Read((u8*)buffer + length, size - length);
+	void CacheStream::Flush()
+	{
+		WritePages();
+		stream->Flush();
 	}
 
-	size_t CacheStream::Write(const void* buffer, size_t size)
+	void CacheStream::SetLength(u64 value)
 	{
-		if (!cacheDirty)
-			DirtyCache();
-
-		size_t length = Math::Min(size, cacheSize - cacheOffset);
-		if (length) {
-			memcpy(cache + cacheOffset, buffer, length);
-			cacheOffset += length;
-			position += length;
-			cacheLength = cacheOffset;
-			cacheDirty = true;
+		WritePages();
+		stream->SetLength(value);
+		streamLength = value;
+		length = value;
+		for (u32 i = 0; i < pageCount; i++) {
+			if (!pages[i].valid)
+				continue;
+			u64 offset = pages[i].index * cacheSize;
+			if (offset >= value) {
+				pages[i].valid = false;
+				continue;
+			}
+			// Pages that now reach further take on the zeroes the inner stream was extended with.
+			u32 size = Math::Min((u64)cacheSize, value - offset);
+			if (size > pages[i].length)
+				memset(pages[i].data + pages[i].length, 0, size - pages[i].length);
+			pages[i].length = size;
 		}
+	}
 
-		if (length >= size)
-			return size;
+	size_t CacheStream::Read(void* buffer, size_t size)
+	{
+		size_t total = 0;
+		while (total < size && position < length) {
+			Page* page = GetPage(position / cacheSize, true, true);
+			u32 offset = position % cacheSize;
+			if (offset >= page->length)
+				break;
+			size_t count = Math::Min(size - total, (size_t)(page->length - offset));
+			memcpy((u8*)buffer + total, page->data + offset, count);
+			position += count;
+			total += count;
+		}
+		return total;
+	}
 
-		FlushCache();
-		return length + Write((u8*)buffer + length, size - length);
+	size_t CacheStream::Write(const void* buffer, size_t size)
+	{
+		size_t total = 0;
+		while (total < size) {
+			u32 offset = position % cacheSize;
+			size_t count = Math::Min(size - total, (size_t)(cacheSize - offset));
+			Page* page = GetPage(position / cacheSize, offset || count < cacheSize, false);
+			if (offset > page->length)
+				memset(page->data + page->length, 0, offset - page->length);
+			memcpy(page->data + offset, (const u8*)buffer + total, count);
+			page->length = Math::Max(page->length, (u32)(offset + count));
+			page->dirty = true;
+			position += count;
+			total += count;
+		}
+		length = Math::Max(length, position);
+		return total;
 	}
 } }
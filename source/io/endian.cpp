@@ -0,0 +1,102 @@
+#include "bricks/io/endian.h"
+
+#include <string.h>
+
+#if (BRICKS_ENV_CLANG || (BRICKS_ENV_GCC && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))) && (defined(__x86_64__) || defined(__i386__))
+#define BRICKS_ENDIAN_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+namespace Bricks { namespace IO {
+	namespace Internal {
+		static inline u16 EndianSwap(u16 value) { return (u16)((value << 8) | (value >> 8)); }
+		static inline u32 EndianSwap(u32 value) { return (value >> 24) | ((value >> 8) & 0xff00) | ((value << 8) & 0xff0000) | (value << 24); }
+		static inline u64 EndianSwap(u64 value) { return ((u64)EndianSwap((u32)value) << 32) | EndianSwap((u32)(value >> 32)); }
+
+		template<typename T> static void EndianSwapScalar(u8* dest, const u8* src, size_t count)
+		{
+			for (size_t i = 0; i < count; i++) {
+				T value;
+				memcpy(&value, src + i * sizeof(T), sizeof(T));
+				value = EndianSwap(value);
+				memcpy(dest + i * sizeof(T), &value, sizeof(T));
+			}
+		}
+
+		// Shuffle masks that reverse each 2, 4 or 8 byte lane of a 16 byte vector.
+		static const u8 EndianShuffle16[16] = { 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14 };
+		static const u8 EndianShuffle32[16] = { 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12 };
+		static const u8 EndianShuffle64[16] = { 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8 };
+
+		// Swaps whole vectors and returns how many bytes were handled; the caller finishes the remainder.
+		typedef size_t (*EndianSwapVector)(u8* dest, const u8* src, size_t size, const u8* shuffle);
+
+		static size_t EndianSwapNone(u8* dest, const u8* src, size_t size, const u8* shuffle)
+		{
+			return 0;
+		}
+
+#if BRICKS_ENDIAN_SIMD_X86
+		__attribute__((target("ssse3")))
+		static size_t EndianSwapSSSE3(u8* dest, const u8* src, size_t size, const u8* shuffle)
+		{
+			__m128i mask = _mm_loadu_si128((const __m128i*)shuffle);
+			size_t offset = 0;
+			for (; offset + 16 <= size; offset += 16)
+				_mm_storeu_si128((__m128i*)(dest + offset), _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + offset)), mask));
+			return offset;
+		}
+
+		__attribute__((target("avx2")))
+		static size_t EndianSwapAVX2(u8* dest, const u8* src, size_t size, const u8* shuffle)
+		{
+			__m256i mask = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)shuffle));
+			size_t offset = 0;
+			for (; offset + 64 <= size; offset += 64) {
+				__m256i first = _mm256_loadu_si256((const __m256i*)(src + offset));
+				__m256i second = _mm256_loadu_si256((const __m256i*)(src + offset + 32));
+				_mm256_storeu_si256((__m256i*)(dest + offset), _mm256_shuffle_epi8(first, mask));
+				_mm256_storeu_si256((__m256i*)(dest + offset + 32), _mm256_shuffle_epi8(second, mask));
+			}
+			for (; offset + 32 <= size; offset += 32)
+				_mm256_storeu_si256((__m256i*)(dest + offset), _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(src + offset)), mask));
+			return offset;
+		}
+#endif
+
+		static EndianSwapVector EndianSelectSwapVector()
+		{
+#if BRICKS_ENDIAN_SIMD_X86
+			__builtin_cpu_init();
+			if (__builtin_cpu_supports("avx2"))
+				return EndianSwapAVX2;
+			if (__builtin_cpu_supports("ssse3"))
+				return EndianSwapSSSE3;
+#endif
+			return EndianSwapNone;
+		}
+
+		template<typename T> static void EndianSwapArray(void* dest, const void* src, size_t count, const u8* shuffle)
+		{
+			static const EndianSwapVector swapVector = EndianSelectSwapVector();
+			size_t size = count * sizeof(T);
+			size_t offset = swapVector((u8*)dest, (const u8*)src, size, shuffle);
+			EndianSwapScalar<T>((u8*)dest + offset, (const u8*)src + offset, (size - offset) / sizeof(T));
+		}
+	}
+
+	void EndianSwapArray16(void* dest, const void* src, size_t count)
+	{
+		Internal::EndianSwapArray<u16>(dest, src, count, Internal::EndianShuffle16);
+	}
+
+	void EndianSwapArray32(void* dest, const void* src, size_t count)
+	{
+		Internal::EndianSwapArray<u32>(dest, src, count, Internal::EndianShuffle32);
+	}
+
+	void EndianSwapArray64(void* dest, const void* src, size_t count)
+	{
+		Internal::EndianSwapArray<u64>(dest, src, count, Internal::EndianShuffle64);
+	}
+} }
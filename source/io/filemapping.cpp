@@ -0,0 +1,149 @@
+#include "bricks/io/filemapping.h"
+
+#include <unistd.h>
+#include <errno.h>
+#if !BRICKS_ENV_MINGW
+#include <sys/mman.h>
+#endif
+
+namespace Bricks { namespace IO {
+	FileMapping::FileMapping(Filesystem* filesystem, FileHandle handle, bool writable) :
+		filesystem(filesystem), handle(handle), writable(writable), hugePageAligned(false), data(NULL), length(0)
+	{
+		if (!IsSupported(filesystem))
+			BRICKS_FEATURE_THROW(NotSupportedException());
+	}
+
+	FileMapping::~FileMapping()
+	{
+		Unmap();
+	}
+
+	bool FileMapping::IsSupported(Filesystem* filesystem)
+	{
+#if BRICKS_ENV_MINGW
+		return false;
+#else
+		return CastToDynamic<PosixFilesystem>(filesystem);
+#endif
+	}
+
+	size_t FileMapping::GetPageSize()
+	{
+#if BRICKS_ENV_MINGW
+		return 4096;
+#else
+		static size_t pageSize = sysconf(_SC_PAGESIZE);
+		return pageSize;
+#endif
+	}
+
+	size_t FileMapping::GetHugePageSize()
+	{
+		return 0x200000;
+	}
+
+#if BRICKS_ENV_MINGW
+	void* FileMapping::MapAligned(u64 length) { BRICKS_FEATURE_THROW(NotSupportedException()); }
+	void FileMapping::Map(u64 length) { BRICKS_FEATURE_THROW(NotSupportedException()); }
+	void FileMapping::Unmap() { }
+	void FileMapping::Sync(u64 offset, u64 size, bool wait) { BRICKS_FEATURE_THROW(NotSupportedException()); }
+	void FileMapping::Advise(MappingAdvice::Enum advice, u64 offset, u64 size) { }
+#else
+	void* FileMapping::MapAligned(u64 length)
+	{
+		int protection = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+		size_t alignment = GetHugePageSize();
+		if (!hugePageAligned || length < alignment)
+			return mmap(NULL, length, protection, MAP_SHARED, (int)handle, 0);
+
+		// Reserve enough address space to find an aligned start, map the file over it, then release the slack on either side.
+		size_t reserved = length + alignment;
+		u8* reservation = (u8*)mmap(NULL, reserved, PROT_NONE, MAP_PRIVATE | MAP_ANON, -1, 0);
+		if (reservation == MAP_FAILED)
+			return MAP_FAILED;
+		u8* aligned = (u8*)(((size_t)reservation + alignment - 1) & ~(alignment - 1));
+		void* mapped = mmap(aligned, length, protection, MAP_SHARED | MAP_FIXED, (int)handle, 0);
+		if (mapped == MAP_FAILED) {
+			munmap(reservation, reserved);
+			return MAP_FAILED;
+		}
+		size_t mappedLength = (length + GetPageSize() - 1) & ~(u64)(GetPageSize() - 1);
+		if (aligned > reservation)
+			munmap(reservation, aligned - reservation);
+		if (aligned + mappedLength < reservation + reserved)
+			munmap(aligned + mappedLength, reservation + reserved - aligned - mappedLength);
+		return mapped;
+	}
+
+	void FileMapping::Map(u64 length)
+	{
+		if (length == this->length)
+			return;
+		if (!length) {
+			Unmap();
+			return;
+		}
+
+		void* mapped;
+#if BRICKS_ENV_LINUX
+		if (data && (!hugePageAligned || length < GetHugePageSize()))
+			mapped = mremap(data, this->length, length, MREMAP_MAYMOVE);
+		else
+#endif
+		{
+			Unmap();
+			mapped = MapAligned(length);
+		}
+		if (mapped == MAP_FAILED)
+			ThrowErrno();
+		data = mapped;
+		this->length = length;
+	}
+
+	void FileMapping::Unmap()
+	{
+		if (data)
+			munmap(data, length);
+		data = NULL;
+		length = 0;
+	}
+
+	void FileMapping::Sync(u64 offset, u64 size, bool wait)
+	{
+		if (!data || offset >= length)
+			return;
+		if (!size || offset + size > length)
+			size = length - offset;
+		u64 start = offset & ~(u64)(GetPageSize() - 1);
+		if (msync((u8*)data + start, size + offset - start, wait ? MS_SYNC : MS_ASYNC))
+			ThrowErrno();
+	}
+
+	void FileMapping::Advise(MappingAdvice::Enum advice, u64 offset, u64 size)
+	{
+		if (!data || offset >= length)
+			return;
+		if (!size || offset + size > length)
+			size = length - offset;
+		int flag = MADV_NORMAL;
+		switch (advice) {
+			case MappingAdvice::Normal: flag = MADV_NORMAL; break;
+			case MappingAdvice::Sequential: flag = MADV_SEQUENTIAL; break;
+			case MappingAdvice::Random: flag = MADV_RANDOM; break;
+			case MappingAdvice::WillNeed: flag = MADV_WILLNEED; break;
+			case MappingAdvice::DontNeed: flag = MADV_DONTNEED; break;
+			case MappingAdvice::HugePages:
+#ifdef MADV_HUGEPAGE
+				flag = MADV_HUGEPAGE;
+				break;
+#else
+				return;
+#endif
+		}
+		u64 start = offset & ~(u64)(GetPageSize() - 1);
+		// Advice is only a hint, so a kernel that rejects it is not an error.
+		madvise((u8*)data + start, size + offset - start, flag);
+	}
+#endif
+} }
@@ -7,10 +7,15 @@
 #include <sys/stat.h>
 #include <errno.h>
 #include <limits.h>
+#if !BRICKS_ENV_MINGW
+#include <sys/uio.h>
+#endif
 
 #if BRICKS_ENV_APPLE || BRICKS_ENV_EMSCRIPTEN
 #define off64_t off_t
 #define lseek64 lseek
+#define pread64 pread
+#define pwrite64 pwrite
 #define ftruncate64 ftruncate
 #endif
 #if BRICKS_ENV_MINGW || BRICKS_ENV_ANDROID
@@ -19,6 +24,9 @@
 #if BRICKS_ENV_MINGW
 #define mkdir(x, y) mkdir(x)
 #endif
+#if BRICKS_ENV_LINUX || BRICKS_ENV_BSD
+#define BRICKS_FILESYSTEM_PREADV 1
+#endif
 
 namespace Bricks { namespace IO {
 	static AutoPointer<String> directorySeparators;
@@ -40,6 +48,72 @@ namespace Bricks { namespace IO {
 		return defaultFilesystem;
 	}
 
+	size_t Filesystem::ReadVector(FileHandle fd, const IOVector* vectors, int count)
+	{
+		size_t total = 0;
+		for (int i = 0; i < count; i++) {
+			size_t size = Read(fd, vectors[i].data, vectors[i].size);
+			total += size;
+			if (size < vectors[i].size)
+				break;
+		}
+		return total;
+	}
+
+	size_t Filesystem::WriteVector(FileHandle fd, const IOVector* vectors, int count)
+	{
+		size_t total = 0;
+		for (int i = 0; i < count; i++) {
+			size_t size = Write(fd, vectors[i].data, vectors[i].size);
+			total += size;
+			if (size < vectors[i].size)
+				break;
+		}
+		return total;
+	}
+
+	size_t Filesystem::ReadAt(FileHandle fd, void* buffer, size_t size, u64 offset)
+	{
+		u64 position = Tell(fd);
+		Seek(fd, offset, SeekType::Beginning);
+		size = Read(fd, buffer, size);
+		Seek(fd, position, SeekType::Beginning);
+		return size;
+	}
+
+	size_t Filesystem::WriteAt(FileHandle fd, const void* buffer, size_t size, u64 offset)
+	{
+		u64 position = Tell(fd);
+		Seek(fd, offset, SeekType::Beginning);
+		size = Write(fd, buffer, size);
+		Seek(fd, position, SeekType::Beginning);
+		return size;
+	}
+
+	size_t Filesystem::ReadVector(FileHandle fd, const IOVector* vectors, int count, u64 offset)
+	{
+		size_t total = 0;
+		for (int i = 0; i < count; i++) {
+			size_t size = ReadAt(fd, vectors[i].data, vectors[i].size, offset + total);
+			total += size;
+			if (size < vectors[i].size)
+				break;
+		}
+		return total;
+	}
+
+	size_t Filesystem::WriteVector(FileHandle fd, const IOVector* vectors, int count, u64 offset)
+	{
+		size_t total = 0;
+		for (int i = 0; i < count; i++) {
+			size_t size = WriteAt(fd, vectors[i].data, vectors[i].size, offset + total);
+			total += size;
+			if (size < vectors[i].size)
+				break;
+		}
+		return total;
+	}
+
 	FileHandle C89Filesystem::Open(
 			const String& path,
 			FileOpenMode::Enum createmode,
@@ -176,6 +250,105 @@ namespace Bricks { namespace IO {
 		return ret;
 	}
 
+#if !BRICKS_ENV_MINGW
+	size_t PosixFilesystem::ReadAt(FileHandle fd, void* buffer, size_t size, u64 offset)
+	{
+		ssize_t ret = pread64((int)fd, buffer, size, offset);
+		if (ret < 0)
+			ThrowErrno();
+		return ret;
+	}
+
+	size_t PosixFilesystem::WriteAt(FileHandle fd, const void* buffer, size_t size, u64 offset)
+	{
+		ssize_t ret = pwrite64((int)fd, buffer, size, offset);
+		if (ret < 0)
+			ThrowErrno();
+		return ret;
+	}
+
+	// Transfers vectors in batches of at most IOV_MAX, resuming a partially written batch where the kernel stopped.
+	// A negative offset uses the file position; short reads end the transfer.
+	static size_t PosixTransferVector(int fd, const IOVector* vectors, int count, s64 offset, bool write)
+	{
+#ifdef IOV_MAX
+		static const int MaximumVectors = IOV_MAX < 64 ? IOV_MAX : 64;
+#else
+		static const int MaximumVectors = 16;
+#endif
+		size_t total = 0;
+		while (count > 0) {
+			struct iovec iov[MaximumVectors];
+			int batch = count < MaximumVectors ? count : MaximumVectors;
+			for (int i = 0; i < batch; i++) {
+				iov[i].iov_base = vectors[i].data;
+				iov[i].iov_len = vectors[i].size;
+			}
+			struct iovec* pending = iov;
+			int pendingCount = batch;
+			while (pendingCount > 0) {
+				ssize_t ret;
+#if BRICKS_FILESYSTEM_PREADV
+				if (offset >= 0)
+					ret = write ? pwritev(fd, pending, pendingCount, offset + total) : preadv(fd, pending, pendingCount, offset + total);
+				else
+#endif
+					ret = write ? writev(fd, pending, pendingCount) : readv(fd, pending, pendingCount);
+				if (ret < 0)
+					ThrowErrno();
+				total += ret;
+				size_t consumed = ret;
+				while (pendingCount > 0 && consumed >= pending->iov_len) {
+					consumed -= pending->iov_len;
+					pending++;
+					pendingCount--;
+				}
+				if (pendingCount > 0) {
+					if (!write || !ret)
+						return total;
+					pending->iov_base = (u8*)pending->iov_base + consumed;
+					pending->iov_len -= consumed;
+				}
+			}
+			vectors += batch;
+			count -= batch;
+		}
+		return total;
+	}
+
+	size_t PosixFilesystem::ReadVector(FileHandle fd, const IOVector* vectors, int count)
+	{
+		return PosixTransferVector((int)fd, vectors, count, -1, false);
+	}
+
+	size_t PosixFilesystem::WriteVector(FileHandle fd, const IOVector* vectors, int count)
+	{
+		return PosixTransferVector((int)fd, vectors, count, -1, true);
+	}
+
+#if BRICKS_FILESYSTEM_PREADV
+	size_t PosixFilesystem::ReadVector(FileHandle fd, const IOVector* vectors, int count, u64 offset)
+	{
+		return PosixTransferVector((int)fd, vectors, count, offset, false);
+	}
+
+	size_t PosixFilesystem::WriteVector(FileHandle fd, const IOVector* vectors, int count, u64 offset)
+	{
+		return PosixTransferVector((int)fd, vectors, count, offset, true);
+	}
+#else
+	size_t PosixFilesystem::ReadVector(FileHandle fd, const IOVector* vectors, int count, u64 offset) { return Filesystem::ReadVector(fd, vectors, count, offset); }
+	size_t PosixFilesystem::WriteVector(FileHandle fd, const IOVector* vectors, int count, u64 offset) { return Filesystem::WriteVector(fd, vectors, count, offset); }
+#endif
+#else
+	size_t PosixFilesystem::ReadAt(FileHandle fd, void* buffer, size_t size, u64 offset) { return Filesystem::ReadAt(fd, buffer, size, offset); }
+	size_t PosixFilesystem::WriteAt(FileHandle fd, const void* buffer, size_t size, u64 offset) { return Filesystem::WriteAt(fd, buffer, size, offset); }
+	size_t PosixFilesystem::ReadVector(FileHandle fd, const IOVector* vectors, int count) { return Filesystem::ReadVector(fd, vectors, count); }
+	size_t PosixFilesystem::WriteVector(FileHandle fd, const IOVector* vectors, int count) { return Filesystem::WriteVector(fd, vectors, count); }
+	size_t PosixFilesystem::ReadVector(FileHandle fd, const IOVector* vectors, int count, u64 offset) { return Filesystem::ReadVector(fd, vectors, count, offset); }
+	size_t PosixFilesystem::WriteVector(FileHandle fd, const IOVector* vectors, int count, u64 offset) { return Filesystem::WriteVector(fd, vectors, count, offset); }
+#endif
+
 	void PosixFilesystem::Seek(FileHandle fd, s64 offset, SeekType::Enum whence)
 	{
 		if (lseek64((int)fd, offset, (int)whence) == (off64_t)-1)
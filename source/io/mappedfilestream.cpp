@@ -0,0 +1,112 @@
+#include "bricks/io/mappedfilestream.h"
+#include "bricks/core/math.h"
+
+#include <string.h>
+
+namespace Bricks { namespace IO {
+	MappedFileStream::MappedFileStream(const String& path, FileOpenMode::Enum createmode, FileMode::Enum mode, FilePermissions::Enum permissions, Filesystem* filesystem) :
+		filesystem(filesystem ?: Filesystem::GetDefault()), path(path), position(0)
+	{
+		if (!FileMapping::IsSupported(this->filesystem))
+			BRICKS_FEATURE_THROW(NotSupportedException());
+		// A shared writable mapping needs a descriptor that can also read, so WriteOnly opens the file ReadWrite.
+		bool writable = mode != FileMode::ReadOnly;
+		handle = this->filesystem->Open(path, createmode, writable ? FileMode::ReadWrite : mode, permissions);
+		mapping = autonew FileMapping(this->filesystem, handle, writable);
+		mapping->SetHugePageAlignment(true);
+		length = this->filesystem->FileStat(handle).GetSize();
+		mapping->Map(length);
+		if (length >= FileMapping::GetHugePageSize())
+			mapping->Advise(MappingAdvice::HugePages);
+	}
+
+	MappedFileStream::~MappedFileStream()
+	{
+		mapping->Unmap();
+		if (mapping->IsWritable())
+			filesystem->Truncate(handle, length);
+		filesystem->Close(handle);
+	}
+
+	void MappedFileStream::Reserve(u64 size)
+	{
+		if (size <= mapping->GetLength())
+			return;
+
+		// Grow geometrically in whole pages, or whole huge pages once the file is large enough to use them.
+		u64 capacity = Math::Max(size, mapping->GetLength() * 2);
+		u64 granularity = capacity >= FileMapping::GetHugePageSize() ? FileMapping::GetHugePageSize() : FileMapping::GetPageSize();
+		capacity = (capacity + granularity - 1) & ~(granularity - 1);
+		filesystem->Truncate(handle, capacity);
+		mapping->Map(capacity);
+		if (capacity >= FileMapping::GetHugePageSize())
+			mapping->Advise(MappingAdvice::HugePages);
+	}
+
+	size_t MappedFileStream::Read(void* buffer, size_t size)
+	{
+		size = ReadAt(position, buffer, size);
+		position += size;
+		return size;
+	}
+
+	size_t MappedFileStream::Write(const void* buffer, size_t size)
+	{
+		size = WriteAt(position, buffer, size);
+		position += size;
+		return size;
+	}
+
+	size_t MappedFileStream::ReadAt(u64 offset, void* buffer, size_t size)
+	{
+		if (offset >= length)
+			return 0;
+		size = Math::Min((u64)size, length - offset);
+		memcpy(buffer, GetData() + offset, size);
+		return size;
+	}
+
+	size_t MappedFileStream::WriteAt(u64 offset, const void* buffer, size_t size)
+	{
+		if (!mapping->IsWritable())
+			BRICKS_FEATURE_THROW(NotSupportedException());
+		Reserve(offset + size);
+		if (offset > length)
+			memset(GetData() + length, 0, offset - length);
+		memcpy(GetData() + offset, buffer, size);
+		length = Math::Max(length, offset + size);
+		return size;
+	}
+
+	const void* MappedFileStream::TryGetSpan(size_t size)
+	{
+		const void* span = TryGetSpanAt(position, size);
+		if (span)
+			position += size;
+		return span;
+	}
+
+	const void* MappedFileStream::TryGetSpanAt(u64 offset, size_t size)
+	{
+		if (offset > length || size > length - offset)
+			return NULL;
+		return GetData() + offset;
+	}
+
+	void MappedFileStream::SetLength(u64 value)
+	{
+		if (value > length) {
+			Reserve(value);
+			memset(GetData() + length, 0, value - length);
+		} else {
+			mapping->Map(value);
+			filesystem->Truncate(handle, value);
+		}
+		length = value;
+	}
+
+	void MappedFileStream::Flush()
+	{
+		mapping->Sync(0, length);
+	}
+} }
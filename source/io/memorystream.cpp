@@ -6,78 +6,241 @@
 
 namespace Bricks { namespace IO {
 	MemoryStream::MemoryStream() :
-		data(NULL), length(0), position(0), allocated(0)
+		mode(MemoryStreamMode::Contiguous), data(NULL), length(0), position(0), allocated(0), chunkIndex(0)
 	{
 
 	}
 
 	MemoryStream::MemoryStream(unsigned long size) :
-		data(NULL), length(0), position(0), allocated(0)
+		mode(MemoryStreamMode::Contiguous), data(NULL), length(0), position(0), allocated(0), chunkIndex(0)
+	{
+		Allocate(size);
+	}
+
+	MemoryStream::MemoryStream(MemoryStreamMode::Enum mode, unsigned long size) :
+		mode(mode), data(NULL), length(0), position(0), allocated(0), chunkIndex(0)
 	{
 		Allocate(size);
 	}
 
 	MemoryStream::MemoryStream(const MemoryStream& stream) :
-		data(NULL), length(stream.length), allocated(0)
+		mode(stream.mode), data(NULL), length(0), position(0), allocated(0), chunkIndex(0)
 	{
-		Allocate(length);
-		memcpy(data, stream.data, length);
+		Copy(stream);
 	}
 
 	MemoryStream::MemoryStream(const Data& data) :
-		data(NULL), length(data.GetLength()), allocated(0)
+		mode(MemoryStreamMode::Contiguous), data(NULL), length(data.GetLength()), position(0), allocated(0), chunkIndex(0)
 	{
 		Allocate(length);
-		memcpy(this->data, data.GetData(), length);
+		Store(0, data.GetData(), length);
 	}
 
 	MemoryStream::MemoryStream(const void* data, unsigned long length) :
-		data(NULL), length(length), allocated(0)
+		mode(MemoryStreamMode::Contiguous), data(NULL), length(length), position(0), allocated(0), chunkIndex(0)
 	{
 		Allocate(length);
-		memcpy(this->data, data, length);
+		Store(0, data, length);
 	}
 
 	MemoryStream::~MemoryStream()
 	{
-		free(data);
+		Free();
 	}
 
 	MemoryStream& MemoryStream::operator =(const MemoryStream& stream)
+	{
+		if (this != &stream) {
+			Free();
+			mode = stream.mode;
+			Copy(stream);
+		}
+		return *this;
+	}
+
+	void MemoryStream::Free()
+	{
+		if (mode == MemoryStreamMode::Chunked) {
+			for (size_t i = 0; i < chunks.size(); i++)
+				delete[] chunks[i].data;
+			chunks.clear();
+		} else
+			delete[] data;
+		data = NULL;
+		allocated = 0;
+		chunkIndex = 0;
+	}
+
+	void MemoryStream::Copy(const MemoryStream& stream)
 	{
 		length = stream.length;
+		position = stream.position;
 		Allocate(length);
-		memcpy(data, stream.data, length);
-		return *this;
+		if (stream.mode == MemoryStreamMode::Contiguous)
+			Store(0, stream.data, length);
+		else {
+			for (size_t i = 0; i < stream.chunks.size() && stream.chunks[i].offset < length; i++)
+				Store(stream.chunks[i].offset, stream.chunks[i].data, Math::Min(stream.chunks[i].size, length - stream.chunks[i].offset));
+		}
 	}
 
 	void MemoryStream::Allocate(unsigned long size)
 	{
-		allocated = Math::RoundUp(size, BlockSize);
-		data = (u8*)realloc(data, allocated);
+		if (size <= allocated)
+			return;
+
+		if (mode == MemoryStreamMode::Chunked) {
+			// Each new chunk matches everything allocated so far, up to a cap, so the chunk count grows logarithmically.
+			unsigned long capacity = Math::RoundUp(Math::Max(Math::Min(allocated, MaximumChunkSize), size - allocated), BlockSize);
+			Chunk chunk = { new u8[capacity], allocated, capacity };
+			chunks.push_back(chunk);
+			allocated += capacity;
+			data = chunks[0].data;
+			return;
+		}
+
+		unsigned long capacity = Math::RoundUp(Math::Max(size, allocated * 2), BlockSize);
+		u8* buffer = new u8[capacity];
+		// The constructors that copy data set length before anything is allocated.
+		if (data && length)
+			memcpy(buffer, data, Math::Min(length, allocated));
+		delete[] data;
+		data = buffer;
+		allocated = capacity;
+	}
+
+	size_t MemoryStream::FindChunk(unsigned long offset) const
+	{
+		if (chunkIndex < chunks.size() && offset >= chunks[chunkIndex].offset) {
+			if (offset - chunks[chunkIndex].offset < chunks[chunkIndex].size)
+				return chunkIndex;
+			if (chunkIndex + 1 < chunks.size() && offset - chunks[chunkIndex + 1].offset < chunks[chunkIndex + 1].size)
+				return ++chunkIndex;
+		}
+
+		size_t low = 0;
+		size_t high = chunks.size();
+		while (high - low > 1) {
+			size_t middle = (low + high) / 2;
+			if (chunks[middle].offset <= offset)
+				low = middle;
+			else
+				high = middle;
+		}
+		return chunkIndex = low;
+	}
+
+	void MemoryStream::Load(unsigned long offset, void* buffer, size_t size) const
+	{
+		if (mode == MemoryStreamMode::Contiguous) {
+			memcpy(buffer, data + offset, size);
+			return;
+		}
+
+		u8* destination = (u8*)buffer;
+		for (size_t index = FindChunk(offset); size; index++) {
+			const Chunk& chunk = chunks[index];
+			size_t count = Math::Min(size, chunk.size - (offset - chunk.offset));
+			memcpy(destination, chunk.data + offset - chunk.offset, count);
+			destination += count;
+			offset += count;
+			size -= count;
+			chunkIndex = index;
+		}
+	}
+
+	void MemoryStream::Store(unsigned long offset, const void* buffer, size_t size)
+	{
+		if (mode == MemoryStreamMode::Contiguous) {
+			memcpy(data + offset, buffer, size);
+			return;
+		}
+
+		const u8* source = (const u8*)buffer;
+		for (size_t index = FindChunk(offset); size; index++) {
+			const Chunk& chunk = chunks[index];
+			size_t count = Math::Min(size, chunk.size - (offset - chunk.offset));
+			memcpy(chunk.data + offset - chunk.offset, source, count);
+			source += count;
+			offset += count;
+			size -= count;
+			chunkIndex = index;
+		}
+	}
+
+	void MemoryStream::Fill(unsigned long offset, size_t size)
+	{
+		if (mode == MemoryStreamMode::Contiguous) {
+			memset(data + offset, 0, size);
+			return;
+		}
+
+		for (size_t index = FindChunk(offset); size; index++) {
+			const Chunk& chunk = chunks[index];
+			size_t count = Math::Min(size, chunk.size - (offset - chunk.offset));
+			memset(chunk.data + offset - chunk.offset, 0, count);
+			offset += count;
+			size -= count;
+		}
+	}
+
+	void MemoryStream::Coalesce()
+	{
+		if (mode != MemoryStreamMode::Chunked || chunks.size() <= 1)
+			return;
+
+		Chunk chunk = { new u8[allocated], 0, allocated };
+		Load(0, chunk.data, length);
+		for (size_t i = 0; i < chunks.size(); i++)
+			delete[] chunks[i].data;
+		chunks.clear();
+		chunks.push_back(chunk);
+		data = chunk.data;
+		chunkIndex = 0;
 	}
 
 	size_t MemoryStream::Read(void* buffer, size_t size)
 	{
-		size = Math::Min(size, length - position);
-		memcpy(buffer, data + position, size);
+		size = ReadAt(position, buffer, size);
 		position += size;
 		return size;
 	}
 
 	size_t MemoryStream::Write(const void* buffer, size_t size)
 	{
-		if (position + size > length)
-			SetLength(position + size);
-		memcpy(data + position, buffer, size);
+		size = WriteAt(position, buffer, size);
 		position += size;
 		return size;
 	}
 
+	size_t MemoryStream::ReadAt(u64 offset, void* buffer, size_t size)
+	{
+		if (offset >= length)
+			return 0;
+		size = Math::Min((u64)size, length - offset);
+		Load(offset, buffer, size);
+		return size;
+	}
+
+	size_t MemoryStream::WriteAt(u64 offset, const void* buffer, size_t size)
+	{
+		if (offset + size > length) {
+			Allocate(offset + size);
+			if (offset > length)
+				Fill(length, offset - length);
+			length = offset + size;
+		}
+		Store(offset, buffer, size);
+		return size;
+	}
+
 	void MemoryStream::SetLength(u64 length)
 	{
+		if (length > this->length) {
+			Allocate(length);
+			Fill(this->length, length - this->length);
+		}
 		this->length = length;
-		Allocate(length);
 	}
 
 	void MemoryStream::SetPosition(u64 position)
@@ -85,8 +248,52 @@ namespace Bricks { namespace IO {
 		this->position = position;
 	}
 
+	const void* MemoryStream::TryGetSpan(size_t size)
+	{
+		const void* span = TryGetSpanAt(position, size);
+		if (span)
+			position += size;
+		return span;
+	}
+
+	const void* MemoryStream::TryGetSpanAt(u64 offset, size_t size)
+	{
+		if (offset > length || size > length - offset)
+			return NULL;
+		if (mode == MemoryStreamMode::Contiguous)
+			return data + offset;
+		const Chunk& chunk = chunks[FindChunk(offset)];
+		if (offset - chunk.offset + size > chunk.size)
+			return NULL;
+		return chunk.data + offset - chunk.offset;
+	}
+
 	int MemoryStream::ReadByte()
 	{
-		return data[position++];
+		if (position >= length)
+			return -1;
+		if (mode == MemoryStreamMode::Contiguous)
+			return data[position++];
+		const Chunk& chunk = chunks[FindChunk(position)];
+		return chunk.data[position++ - chunk.offset];
+	}
+
+	void* MemoryStream::GetBuffer()
+	{
+		Coalesce();
+		return data;
+	}
+
+	ReturnPointer<Data> MemoryStream::Detach()
+	{
+		Coalesce();
+		AutoPointer<Data> result = autonew Data();
+		if (data)
+			result->Adopt(data, length);
+		chunks.clear();
+		data = NULL;
+		length = position = allocated = 0;
+		chunkIndex = 0;
+		return result;
 	}
 } }
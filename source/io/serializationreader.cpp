@@ -0,0 +1,118 @@
+#include "bricks/io/serializationreader.h"
+#include "bricks/io/serializer.h"
+#include "bricks/io/streamreader.h"
+#include "bricks/io/stream.h"
+
+namespace Bricks { namespace IO {
+	static const size_t SerializationReaderBufferSize = 0x1000;
+
+	SerializationReader::SerializationReader(Serializer* serializer, StreamReader* reader) :
+		serializer(serializer), reader(reader), event(SerializationEvent::None), count(0)
+	{
+		if (serializer->GetPreserveReferences())
+			BRICKS_FEATURE_THROW(NotSupportedException());
+	}
+
+	SerializationReader::SerializationReader(Serializer* serializer, Stream* stream) :
+		serializer(serializer), event(SerializationEvent::None), count(0)
+	{
+		if (serializer->GetPreserveReferences())
+			BRICKS_FEATURE_THROW(NotSupportedException());
+		// Reading ahead is only safe when the reader can seek the stream back to the end of the object.
+		reader = autonew StreamReader(stream, Endian::BigEndian, stream->CanSeek() ? SerializationReaderBufferSize : 0);
+	}
+
+	SerializationReader::~SerializationReader()
+	{
+
+	}
+
+	SerializationEvent::Enum SerializationReader::ReadValue()
+	{
+		Internal::ObjectSerializer* objectSerializer = serializer->FindSerializer((int)reader->ReadInt32());
+		TypeInfo type = objectSerializer->GetType();
+		bool dictionary = type == TypeInfo::OfType<SerializationDictionary>();
+		bool chunked = type == TypeInfo::OfType<Internal::SerializationChunkedArray>();
+		if (!dictionary && !chunked && type != TypeInfo::OfType<SerializationArray>()) {
+			value = objectSerializer->Deserialize(reader);
+			return event = SerializationEvent::Value;
+		}
+
+		Frame frame = { dictionary ? SerializationEvent::BeginDictionary : SerializationEvent::BeginArray, chunked ? 0 : serializer->ReadLength(reader), chunked, false };
+		count = chunked ? -1 : (long)frame.remaining;
+		frames.push_back(frame);
+		return event = frame.type;
+	}
+
+	SerializationEvent::Enum SerializationReader::Next()
+	{
+		value = NULL;
+		count = 0;
+
+		if (frames.empty()) {
+			if (event != SerializationEvent::None)
+				return event = SerializationEvent::End;
+			return ReadValue();
+		}
+
+		Frame& frame = frames.back();
+		if (frame.type == SerializationEvent::BeginDictionary) {
+			if (frame.key) {
+				frame.key = false;
+				frame.remaining--;
+				return ReadValue();
+			}
+			if (!frame.remaining) {
+				frames.pop_back();
+				return event = SerializationEvent::EndDictionary;
+			}
+			AutoPointer<String> name = CastToDynamic<String>(serializer->Deserialize(reader));
+			if (!name)
+				BRICKS_FEATURE_THROW(FormatException());
+			key = *name;
+			frame.key = true;
+			return event = SerializationEvent::Key;
+		}
+
+		if (!frame.remaining && frame.chunked)
+			frame.remaining = serializer->ReadLength(reader);
+		if (!frame.remaining) {
+			frames.pop_back();
+			return event = SerializationEvent::EndArray;
+		}
+		frame.remaining--;
+		return ReadValue();
+	}
+
+	void SerializationReader::Skip()
+	{
+		if (event != SerializationEvent::BeginDictionary && event != SerializationEvent::BeginArray)
+			BRICKS_FEATURE_THROW(InvalidOperationException());
+		size_t depth = frames.size();
+		while (frames.size() >= depth)
+			Next();
+	}
+
+	ReturnPointer<Object> SerializationReader::ReadObject()
+	{
+		switch (event) {
+			case SerializationEvent::Value:
+				return value;
+			case SerializationEvent::BeginDictionary: {
+				AutoPointer<SerializationDictionary> dictionary = autonew SerializationDictionary();
+				while (Next() == SerializationEvent::Key) {
+					String name = key;
+					Next();
+					dictionary->Add(name, ReadObject());
+				}
+				return dictionary; }
+			case SerializationEvent::BeginArray: {
+				AutoPointer<SerializationArray> array = autonew SerializationArray();
+				while (Next() != SerializationEvent::EndArray)
+					array->AddItem(ReadObject());
+				return array; }
+			default:
+				BRICKS_FEATURE_THROW(InvalidOperationException());
+		}
+	}
+} }
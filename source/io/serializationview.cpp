@@ -0,0 +1,355 @@
+#include "bricks/io/serializationview.h"
+#include "bricks/io/memorystream.h"
+#include "bricks/io/filemapping.h"
+#include "bricks/io/endian.h"
+#include "bricks/io/stream.h"
+#include "bricks/io/streamnavigator.h"
+#include "bricks/core/math.h"
+
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+using namespace Bricks::Collections;
+
+namespace Bricks { namespace IO {
+	namespace Internal {
+		// Nodes start with their type and a count: entries for containers, bytes for strings and data, the value type for values.
+		static const size_t SerializationNodeHeaderSize = 0x08;
+		static const size_t SerializationValueSize = 0x08;
+
+		static inline int CompareKeys(const char* key1, size_t length1, const char* key2, size_t length2)
+		{
+			int result = memcmp(key1, key2, Math::Min(length1, length2));
+			if (result)
+				return result;
+			return length1 < length2 ? -1 : length1 > length2;
+		}
+
+		// Values are stored little-endian whatever the host order.
+		static void ConvertValue(void* dest, const void* src, int size)
+		{
+			switch (size) {
+				case sizeof(u16): EndianConvertLE16(dest, EndianConvertLE16(src)); break;
+				case sizeof(u32): EndianConvertLE32(dest, EndianConvertLE32(src)); break;
+				case sizeof(u64): EndianConvertLE64(dest, EndianConvertLE64(src)); break;
+				default: memcpy(dest, src, size); break;
+			}
+		}
+	}
+
+	SerializationNode::SerializationNode(const u8* base, size_t size, u32 offset) :
+		base(base), size(size), offset(offset)
+	{
+		if (offset && (offset % SerializationView::Alignment || offset < SerializationView::HeaderSize || offset > size - Internal::SerializationNodeHeaderSize))
+			BRICKS_FEATURE_THROW(FormatException());
+	}
+
+	u32 SerializationNode::Read32(u64 position) const
+	{
+		if (position + sizeof(u32) > size)
+			BRICKS_FEATURE_THROW(FormatException());
+		return EndianConvertLE32(base + position);
+	}
+
+	u32 SerializationNode::Expect(SerializationNodeType::Enum type) const
+	{
+		if (GetType() != type)
+			BRICKS_FEATURE_THROW(InvalidOperationException());
+		return EndianConvertLE32(base + offset + sizeof(u32));
+	}
+
+	// The writer places containers after the container that holds them, so a container pointing back at or before its
+	// parent could only come from a cycle. Strings are shared and may be anywhere, but they hold no references.
+	SerializationNode SerializationNode::Reference(u64 position) const
+	{
+		SerializationNode node(base, size, Read32(position));
+		if (node.offset && node.offset <= offset) {
+			SerializationNodeType::Enum type = node.GetType();
+			if (type == SerializationNodeType::Dictionary || type == SerializationNodeType::Array)
+				BRICKS_FEATURE_THROW(FormatException());
+		}
+		return node;
+	}
+
+	SerializationNodeType::Enum SerializationNode::GetType() const
+	{
+		if (!offset)
+			return SerializationNodeType::Null;
+		return (SerializationNodeType::Enum)EndianConvertLE32(base + offset);
+	}
+
+	long SerializationNode::GetCount() const
+	{
+		if (GetType() == SerializationNodeType::Array)
+			return Expect(SerializationNodeType::Array);
+		return Expect(SerializationNodeType::Dictionary);
+	}
+
+	SerializationNode SerializationNode::GetItem(long index) const
+	{
+		u32 count = Expect(SerializationNodeType::Array);
+		if (index < 0 || (u32)index >= count)
+			BRICKS_FEATURE_THROW(InvalidArgumentException());
+		return Reference((u64)offset + Internal::SerializationNodeHeaderSize + (u64)index * sizeof(u32));
+	}
+
+	SerializationNode SerializationNode::GetKey(long index) const
+	{
+		u32 count = Expect(SerializationNodeType::Dictionary);
+		if (index < 0 || (u32)index >= count)
+			BRICKS_FEATURE_THROW(InvalidArgumentException());
+		return Reference((u64)offset + Internal::SerializationNodeHeaderSize + (u64)index * sizeof(u32) * 2);
+	}
+
+	SerializationNode SerializationNode::GetValue(long index) const
+	{
+		u32 count = Expect(SerializationNodeType::Dictionary);
+		if (index < 0 || (u32)index >= count)
+			BRICKS_FEATURE_THROW(InvalidArgumentException());
+		return Reference((u64)offset + Internal::SerializationNodeHeaderSize + (u64)index * sizeof(u32) * 2 + sizeof(u32));
+	}
+
+	SerializationNode SerializationNode::Find(const char* key, size_t length) const
+	{
+		long low = 0;
+		long high = Expect(SerializationNodeType::Dictionary);
+		while (low < high) {
+			long middle = low + (high - low) / 2;
+			SerializationNode candidate = GetKey(middle);
+			int result = Internal::CompareKeys(key, length, candidate.GetCString(), candidate.GetLength());
+			if (!result)
+				return GetValue(middle);
+			if (result < 0)
+				high = middle;
+			else
+				low = middle + 1;
+		}
+		return SerializationNode();
+	}
+
+	size_t SerializationNode::GetLength() const
+	{
+		u32 length = GetType() == SerializationNodeType::Data ? Expect(SerializationNodeType::Data) : Expect(SerializationNodeType::String);
+		if ((u64)offset + Internal::SerializationNodeHeaderSize + length > size)
+			BRICKS_FEATURE_THROW(FormatException());
+		return length;
+	}
+
+	const char* SerializationNode::GetCString() const
+	{
+		size_t length = Expect(SerializationNodeType::String);
+		if ((u64)offset + Internal::SerializationNodeHeaderSize + length >= size || base[offset + Internal::SerializationNodeHeaderSize + length])
+			BRICKS_FEATURE_THROW(FormatException());
+		return (const char*)base + offset + Internal::SerializationNodeHeaderSize;
+	}
+
+	String SerializationNode::GetString() const
+	{
+		return String(GetCString(), GetLength());
+	}
+
+	Data SerializationNode::GetData() const
+	{
+		size_t length = Expect(SerializationNodeType::Data);
+		if ((u64)offset + Internal::SerializationNodeHeaderSize + length > size)
+			BRICKS_FEATURE_THROW(FormatException());
+		return Data(base + offset + Internal::SerializationNodeHeaderSize, length, false);
+	}
+
+	ValueType::Enum SerializationNode::GetValueType() const
+	{
+		return (ValueType::Enum)Expect(SerializationNodeType::Value);
+	}
+
+	Value SerializationNode::GetValue() const
+	{
+		ValueType::Enum type = GetValueType();
+		if ((u64)offset + Internal::SerializationNodeHeaderSize + Internal::SerializationValueSize > size || Value::SizeOfType(type) > (int)Internal::SerializationValueSize)
+			BRICKS_FEATURE_THROW(FormatException());
+		u8 data[Internal::SerializationValueSize];
+		Internal::ConvertValue(data, base + offset + Internal::SerializationNodeHeaderSize, Value::SizeOfType(type));
+		return Value(data, type);
+	}
+
+	ReturnPointer<Object> SerializationNode::ToObject() const
+	{
+		switch (GetType()) {
+			case SerializationNodeType::Null:
+				return NULL;
+			case SerializationNodeType::Dictionary: {
+				AutoPointer<SerializationDictionary> dictionary = autonew SerializationDictionary();
+				for (long i = 0; i < GetCount(); i++)
+					dictionary->Add(GetKey(i).GetString(), GetValue(i).ToObject());
+				return dictionary; }
+			case SerializationNodeType::Array: {
+				AutoPointer<SerializationArray> array = autonew SerializationArray();
+				for (long i = 0; i < GetCount(); i++)
+					array->AddItem(GetItem(i).ToObject());
+				return array; }
+			case SerializationNodeType::String:
+				return autonew String(GetString());
+			case SerializationNodeType::Value:
+				return autonew Value(GetValue());
+			case SerializationNodeType::Data:
+				return autonew Data(GetData());
+		}
+		BRICKS_FEATURE_THROW(FormatException());
+	}
+
+	SerializationView::SerializationView(const void* data, size_t size, Object* owner) :
+		owner(owner), data((const u8*)data), size(size), root(0)
+	{
+		Open();
+	}
+
+	SerializationView::SerializationView(Data* data) :
+		owner(data), data((const u8*)data->GetData()), size(data->GetSize()), root(0)
+	{
+		Open();
+	}
+
+	SerializationView::SerializationView(FileMapping* mapping) :
+		owner(mapping), data((const u8*)mapping->GetData()), size(mapping->GetLength()), root(0)
+	{
+		Open();
+	}
+
+	void SerializationView::Open()
+	{
+		if ((size_t)data % Alignment)
+			BRICKS_FEATURE_THROW(InvalidArgumentException());
+		if (size < HeaderSize || EndianConvertLE32(data) != Magic || EndianConvertLE16(data + sizeof(u32)) != Version)
+			BRICKS_FEATURE_THROW(FormatException());
+		u32 length = EndianConvertLE32(data + sizeof(u32) * 3);
+		if (length > size)
+			BRICKS_FEATURE_THROW(FormatException());
+		size = length;
+		root = EndianConvertLE32(data + sizeof(u32) * 2);
+		GetRoot();
+	}
+
+	SerializationViewWriter::SerializationViewWriter()
+	{
+
+	}
+
+	SerializationViewWriter::~SerializationViewWriter()
+	{
+
+	}
+
+	// Appends an aligned node with its header written and the rest zeroed, returning its offset.
+	u32 SerializationViewWriter::Reserve(SerializationNodeType::Enum type, u32 count, size_t size)
+	{
+		u64 offset = Math::RoundUp(output->GetLength(), (u64)SerializationView::Alignment);
+		if (offset + Internal::SerializationNodeHeaderSize + size > 0xffffffffULL)
+			BRICKS_FEATURE_THROW(NotSupportedException());
+		output->SetLength(offset + Internal::SerializationNodeHeaderSize + size);
+		Put32(offset, type);
+		Put32(offset + sizeof(u32), count);
+		return offset;
+	}
+
+	void SerializationViewWriter::Put32(u64 position, u32 value)
+	{
+		u8 data[sizeof(u32)];
+		EndianConvertLE32(data, value);
+		output->WriteAt(position, data, sizeof(data));
+	}
+
+	u32 SerializationViewWriter::WriteString(const String& string)
+	{
+		std::map<String, u32>::const_iterator iter = strings.find(string);
+		if (iter != strings.end())
+			return iter->second;
+		u32 offset = Reserve(SerializationNodeType::String, string.GetSize(), string.GetSize() + 1);
+		output->WriteAt(offset + Internal::SerializationNodeHeaderSize, string.CString(), string.GetSize());
+		strings[string] = offset;
+		return offset;
+	}
+
+	static bool SerializationKeyLess(const SerializationDictionary::IteratorType* item1, const SerializationDictionary::IteratorType* item2)
+	{
+		const String& key1 = item1->GetKey();
+		const String& key2 = item2->GetKey();
+		return Internal::CompareKeys(key1.CString(), key1.GetSize(), key2.CString(), key2.GetSize()) < 0;
+	}
+
+	u32 SerializationViewWriter::WriteNode(Object* object)
+	{
+		if (!object)
+			return 0;
+
+		if (String* string = CastToDynamic<String>(object))
+			return WriteString(*string);
+
+		if (SerializationDictionary* dictionary = CastToDynamic<SerializationDictionary>(object)) {
+			std::vector<SerializationDictionary::IteratorType> items;
+			foreach (SerializationDictionary::IteratorType& item, dictionary)
+				items.push_back(item);
+			std::vector<const SerializationDictionary::IteratorType*> sorted;
+			for (size_t i = 0; i < items.size(); i++)
+				sorted.push_back(&items[i]);
+			std::sort(sorted.begin(), sorted.end(), SerializationKeyLess);
+
+			u32 offset = Reserve(SerializationNodeType::Dictionary, sorted.size(), sorted.size() * sizeof(u32) * 2);
+			for (size_t i = 0; i < sorted.size(); i++) {
+				u64 entry = offset + Internal::SerializationNodeHeaderSize + i * sizeof(u32) * 2;
+				Put32(entry, WriteString(sorted[i]->GetKey()));
+				Put32(entry + sizeof(u32), WriteNode(sorted[i]->GetValue()));
+			}
+			return offset;
+		}
+
+		if (SerializationArray* array = CastToDynamic<SerializationArray>(object)) {
+			u32 offset = Reserve(SerializationNodeType::Array, array->GetCount(), array->GetCount() * sizeof(u32));
+			long index = 0;
+			foreach (SerializationArray::IteratorType& item, array)
+				Put32(offset + Internal::SerializationNodeHeaderSize + index++ * sizeof(u32), WriteNode(item));
+			return offset;
+		}
+
+		if (Value* value = CastToDynamic<Value>(object)) {
+			u32 offset = Reserve(SerializationNodeType::Value, value->GetType(), Internal::SerializationValueSize);
+			u8 data[Internal::SerializationValueSize];
+			Internal::ConvertValue(data, value->GetData(), value->GetSize());
+			output->WriteAt(offset + Internal::SerializationNodeHeaderSize, data, value->GetSize());
+			return offset;
+		}
+
+		if (Data* data = CastToDynamic<Data>(object)) {
+			u32 offset = Reserve(SerializationNodeType::Data, data->GetSize(), data->GetSize());
+			output->WriteAt(offset + Internal::SerializationNodeHeaderSize, data->GetData(), data->GetSize());
+			return offset;
+		}
+
+		BRICKS_FEATURE_THROW(NotSupportedException());
+	}
+
+	ReturnPointer<Data> SerializationViewWriter::Write(Object* root)
+	{
+		output = autonew MemoryStream();
+		output->SetLength(SerializationView::HeaderSize);
+		u32 rootOffset = WriteNode(root);
+
+		u8 header[SerializationView::HeaderSize] = { 0 };
+		EndianConvertLE32(header, SerializationView::Magic);
+		EndianConvertLE16(header + sizeof(u32), SerializationView::Version);
+		EndianConvertLE32(header + sizeof(u32) * 2, rootOffset);
+		EndianConvertLE32(header + sizeof(u32) * 3, output->GetLength());
+		output->WriteAt(0, header, sizeof(header));
+
+		AutoPointer<Data> data = output->Detach();
+		output = NULL;
+		strings.clear();
+		return data;
+	}
+
+	void SerializationViewWriter::Write(Stream* stream, Object* root)
+	{
+		AutoPointer<Data> data = Write(root);
+		if (stream->Write(data->GetData(), data->GetSize()) != data->GetSize())
+			BRICKS_FEATURE_THROW(StreamException());
+	}
+} }
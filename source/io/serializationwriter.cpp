@@ -0,0 +1,170 @@
+#include "bricks/io/serializationwriter.h"
+#include "bricks/io/serializer.h"
+#include "bricks/io/streamwriter.h"
+#include "bricks/io/memorystream.h"
+
+namespace Bricks { namespace IO {
+	static const size_t SerializationWriterBufferSize = 0x1000;
+
+	SerializationWriter::SerializationWriter(Serializer* serializer, StreamWriter* writer) :
+		serializer(serializer), writer(writer), chunkItems(0x100), chunkSize(0x10000)
+	{
+		if (serializer->GetPreserveReferences())
+			BRICKS_FEATURE_THROW(NotSupportedException());
+	}
+
+	SerializationWriter::SerializationWriter(Serializer* serializer, Stream* stream) :
+		serializer(serializer), chunkItems(0x100), chunkSize(0x10000)
+	{
+		if (serializer->GetPreserveReferences())
+			BRICKS_FEATURE_THROW(NotSupportedException());
+		writer = autonew StreamWriter(stream, Endian::BigEndian, SerializationWriterBufferSize);
+	}
+
+	SerializationWriter::~SerializationWriter()
+	{
+
+	}
+
+	// Fields of the container at the given depth go to the nearest enclosing chunk still being held back, or to the writer.
+	StreamWriter* SerializationWriter::GetTarget(size_t depth) const
+	{
+		for (size_t i = depth; i > 0; i--) {
+			if (frames[i - 1].chunkWriter && !frames[i - 1].direct)
+				return frames[i - 1].chunkWriter;
+		}
+		return writer;
+	}
+
+	void SerializationWriter::BeginItem()
+	{
+		if (frames.empty())
+			return;
+		const Frame& frame = frames.back();
+		if (frame.dictionary ? !frame.key : (frame.count >= 0 && frame.written >= frame.count))
+			BRICKS_FEATURE_THROW(InvalidOperationException());
+	}
+
+	void SerializationWriter::EndItem()
+	{
+		if (frames.empty())
+			return;
+		Frame& frame = frames.back();
+		frame.written++;
+		frame.key = false;
+		if (frame.direct)
+			frame.direct = false;
+		else if (frame.chunk && (++frame.chunkCount >= chunkItems || frame.chunk->GetLength() >= chunkSize))
+			FlushChunk(frames.size() - 1);
+	}
+
+	// An open chunk also counts the item in progress, whose fields so far are part of it.
+	void SerializationWriter::FlushChunk(size_t depth, bool open)
+	{
+		Frame& frame = frames[depth];
+		long count = frame.chunkCount + (open ? 1 : 0);
+		if (!count)
+			return;
+		StreamWriter* target = GetTarget(depth);
+		serializer->WriteLength(target, count);
+		if (frame.chunk->GetLength())
+			target->WriteBytes(frame.chunk->GetBuffer(), frame.chunk->GetLength());
+		frame.chunk->SetLength(0);
+		frame.chunk->SetPosition(0);
+		frame.chunkCount = 0;
+	}
+
+	void SerializationWriter::Begin(bool dictionary, long count)
+	{
+		BeginItem();
+		if (count < 0) {
+			for (size_t i = frames.size(); i > 0; i--) {
+				Frame& outer = frames[i - 1];
+				if (outer.chunk && !outer.direct) {
+					FlushChunk(i - 1, true);
+					outer.direct = true;
+					break;
+				}
+			}
+		}
+		StreamWriter* target = GetTarget(frames.size());
+		TypeInfo type = dictionary ? TypeInfo::OfType<SerializationDictionary>() : count < 0 ? TypeInfo::OfType<Internal::SerializationChunkedArray>() : TypeInfo::OfType<SerializationArray>();
+		target->WriteInt32(serializer->FindSerializer(type)->GetIdentifier());
+		if (count >= 0)
+			serializer->WriteLength(target, count);
+
+		Frame frame(dictionary, count);
+		if (count < 0) {
+			frame.chunk = autonew MemoryStream();
+			frame.chunkWriter = autonew StreamWriter(frame.chunk, target->GetEndianness());
+		}
+		frames.push_back(frame);
+	}
+
+	void SerializationWriter::End(bool dictionary)
+	{
+		if (frames.empty() || frames.back().dictionary != dictionary)
+			BRICKS_FEATURE_THROW(InvalidOperationException());
+		const Frame& frame = frames.back();
+		if (frame.key || (frame.count >= 0 && frame.written != frame.count))
+			BRICKS_FEATURE_THROW(InvalidOperationException());
+
+		bool chunked = frame.chunk;
+		if (chunked)
+			FlushChunk(frames.size() - 1);
+		frames.pop_back();
+		if (chunked)
+			serializer->WriteLength(GetTarget(frames.size()), 0);
+		EndItem();
+	}
+
+	void SerializationWriter::BeginDictionary(long count)
+	{
+		if (count < 0)
+			BRICKS_FEATURE_THROW(InvalidArgumentException());
+		Begin(true, count);
+	}
+
+	void SerializationWriter::WriteKey(const String& key)
+	{
+		if (frames.empty() || !frames.back().dictionary || frames.back().key || frames.back().written >= frames.back().count)
+			BRICKS_FEATURE_THROW(InvalidOperationException());
+		String name = key;
+		serializer->Serialize(GetTarget(frames.size()), tempnew name);
+		frames.back().key = true;
+	}
+
+	void SerializationWriter::EndDictionary()
+	{
+		End(true);
+	}
+
+	void SerializationWriter::BeginArray(long count)
+	{
+		if (count < 0)
+			BRICKS_FEATURE_THROW(InvalidArgumentException());
+		Begin(false, count);
+	}
+
+	void SerializationWriter::BeginArray()
+	{
+		Begin(false, -1);
+	}
+
+	void SerializationWriter::EndArray()
+	{
+		End(false);
+	}
+
+	void SerializationWriter::WriteValue(Object* value)
+	{
+		BeginItem();
+		serializer->Serialize(GetTarget(frames.size()), value);
+		EndItem();
+	}
+
+	void SerializationWriter::Flush()
+	{
+		writer->Flush();
+	}
+} }
@@ -13,9 +13,9 @@ namespace Bricks { namespace IO { namespace Internal {
 	public:
 		void SerializeData(StreamWriter* writer, SerializationDictionary* dictionary) const
 		{
-			writer->WriteInt32(dictionary->GetCount());
+			serializer->WriteLength(writer, dictionary->GetCount());
 			foreach (SerializationDictionary::IteratorType& item, dictionary) {
-				serializer->Serialize(writer, tempnew item.GetKey());
+				serializer->SerializeKey(writer, tempnew item.GetKey());
 				serializer->Serialize(writer, item.GetValue());
 			}
 		}
@@ -23,7 +23,7 @@ namespace Bricks { namespace IO { namespace Internal {
 		ReturnPointer<SerializationDictionary> DeserializeData(StreamReader* reader) const
 		{
 			AutoPointer<SerializationDictionary> dictionary = autonew SerializationDictionary();
-			int count = reader->ReadInt32();
+			int count = serializer->ReadLength(reader);
 			for (int i = 0; i < count; i++) {
 				AutoPointer<String> key = CastTo<String>(serializer->Deserialize(reader));
 				dictionary->Add(*key, serializer->Deserialize(reader));
@@ -37,7 +37,7 @@ namespace Bricks { namespace IO { namespace Internal {
 	public:
 		void SerializeData(StreamWriter* writer, SerializationArray* array) const
 		{
-			writer->WriteInt32(array->GetCount());
+			serializer->WriteLength(writer, array->GetCount());
 			foreach (SerializationArray::IteratorType& item, array)
 				serializer->Serialize(writer, item);
 		}
@@ -45,26 +45,52 @@ namespace Bricks { namespace IO { namespace Internal {
 		ReturnPointer<SerializationArray> DeserializeData(StreamReader* reader) const
 		{
 			AutoPointer<SerializationArray> array = autonew SerializationArray();
-			int count = reader->ReadInt32();
+			int count = serializer->ReadLength(reader);
 			for (int i = 0; i < count; i++)
 				array->AddItem(serializer->Deserialize(reader));
 			return array;
 		}
 	};
 
+	// An array of unknown length: chunks of items, each preceded by its count, ending with an empty chunk.
+	class ChunkedArraySerializer : public Bricks::IO::Internal::ObjectSerializer
+	{
+	public:
+		ChunkedArraySerializer() :
+			ObjectSerializer(TypeInfo::OfType<SerializationChunkedArray>(), 0x3e346fc5)
+		{
+
+		}
+
+		void Serialize(StreamWriter* writer, Object* object) const
+		{
+			BRICKS_FEATURE_THROW(InvalidOperationException());
+		}
+
+		Bricks::ReturnPointer<Bricks::Object> Deserialize(StreamReader* reader) const
+		{
+			AutoPointer<SerializationArray> array = autonew SerializationArray();
+			while (u64 count = serializer->ReadLength(reader)) {
+				for (u64 i = 0; i < count; i++)
+					array->AddItem(serializer->Deserialize(reader));
+			}
+			return array;
+		}
+	};
+
 	class StringSerializer : public IO::ObjectSerializer<String, 0x197ad112>
 	{
 	public:
 		void SerializeData(StreamWriter* writer, String* string) const
 		{
 			int size = string->GetSize();
-			writer->WriteInt32(size);
+			serializer->WriteLength(writer, size);
 			writer->WriteBytes(string->CString(), size);
 		}
 
 		ReturnPointer<String> DeserializeData(StreamReader* reader) const
 		{
-			int size = reader->ReadInt32();
+			int size = serializer->ReadLength(reader);
 			return autonew String((const char*)reader->ReadBytes(size).GetData(), size);
 		}
 	};
@@ -74,13 +100,13 @@ namespace Bricks { namespace IO { namespace Internal {
 	public:
 		void SerializeData(StreamWriter* writer, Value* value) const
 		{
-			writer->WriteInt32((int)value->GetType());
+			serializer->WriteLength(writer, value->GetType());
 			writer->WriteBytes(value->GetData(), value->GetSize());
 		}
 
 		ReturnPointer<Value> DeserializeData(StreamReader* reader) const
 		{
-			ValueType::Enum type = (ValueType::Enum)reader->ReadInt32();
+			ValueType::Enum type = (ValueType::Enum)serializer->ReadLength(reader);
 			return autonew Value(reader->ReadBytes(Value::SizeOfType(type)), type);
 		}
 	};
@@ -90,13 +116,13 @@ namespace Bricks { namespace IO { namespace Internal {
 	public:
 		void SerializeData(StreamWriter* writer, Data* data) const
 		{
-			writer->WriteInt32(data->GetSize());
+			serializer->WriteLength(writer, data->GetSize());
 			writer->WriteBytes(data->GetData(), data->GetSize());
 		}
 
 		ReturnPointer<Data> DeserializeData(StreamReader* reader) const
 		{
-			int size = reader->ReadInt32();
+			int size = serializer->ReadLength(reader);
 			return autonew Data(reader->ReadBytes(size));
 		}
 	};
@@ -124,10 +150,12 @@ namespace Bricks { namespace IO { namespace Internal {
 } } }
 
 namespace Bricks { namespace IO {
-	Serializer::Serializer()
+	Serializer::Serializer(SerializerFormat::Enum format) :
+		format(format), preserveReferences(false), referenceDepth(0)
 	{
 		RegisterSerializer(autonew Internal::DictionarySerializer());
 		RegisterSerializer(autonew Internal::ArraySerializer());
+		RegisterSerializer(autonew Internal::ChunkedArraySerializer());
 		RegisterSerializer(autonew Internal::StringSerializer());
 		RegisterSerializer(autonew Internal::ValueSerializer());
 		RegisterSerializer(autonew Internal::DataSerializer());
@@ -138,38 +166,185 @@ namespace Bricks { namespace IO {
 	{
 		serializers.Add(serializer->GetType(), serializer);
 		serializer->SetSerializer(this);
+		Reindex();
 	}
 
 	void Serializer::UnregisterSerializer(Internal::ObjectSerializer* serializer)
 	{
-		serializers.RemoveValue(serializer);
+		// Removed by key: the dictionary's value comparison cannot tell AutoPointers apart, so RemoveValue never matched.
+		TypeInfo type = serializer->GetType();
+		if (serializers.ContainsKey(type) && serializers.GetItem(type) == serializer)
+			serializers.RemoveKey(type);
+		Reindex();
+	}
+
+	static inline size_t SerializerHash(size_t value, size_t mask)
+	{
+		return (value * 0x9e3779b1u) & mask;
+	}
+
+	void Serializer::Reindex()
+	{
+		size_t size = 8;
+		while (size < (size_t)serializers.GetCount() * 2)
+			size *= 2;
+		IdentifierSlot emptyIdentifier = { 0, NULL };
+		TypeSlot emptyType = { NULL, NULL };
+		identifierIndex.assign(size, emptyIdentifier);
+		typeIndex.assign(size, emptyType);
+
+		foreach (const SerializerDictionary::IteratorType& item, serializers) {
+			Internal::ObjectSerializer* serializer = item.GetValue();
+			// The first serializer registered under a shared identifier keeps it, as the dictionary scan used to.
+			size_t slot = SerializerHash(serializer->GetIdentifier(), size - 1);
+			while (identifierIndex[slot].serializer && identifierIndex[slot].identifier != serializer->GetIdentifier())
+				slot = (slot + 1) & (size - 1);
+			if (!identifierIndex[slot].serializer) {
+				identifierIndex[slot].identifier = serializer->GetIdentifier();
+				identifierIndex[slot].serializer = serializer;
+			}
+
+			const void* type = serializer->GetType().GetTypeID();
+			slot = SerializerHash((size_t)type >> 3, size - 1);
+			while (typeIndex[slot].serializer)
+				slot = (slot + 1) & (size - 1);
+			typeIndex[slot].type = type;
+			typeIndex[slot].serializer = serializer;
+		}
+	}
+
+	Internal::ObjectSerializer* Serializer::FindSerializer(const TypeInfo& type) const
+	{
+		size_t mask = typeIndex.size() - 1;
+		const void* key = type.GetTypeID();
+		for (size_t slot = SerializerHash((size_t)key >> 3, mask); typeIndex[slot].serializer; slot = (slot + 1) & mask) {
+			if (typeIndex[slot].type == key)
+				return typeIndex[slot].serializer;
+		}
+		return serializers.GetItem(type);
+	}
+
+	Internal::ObjectSerializer* Serializer::FindSerializer(int identifier) const
+	{
+		size_t mask = identifierIndex.size() - 1;
+		for (size_t slot = SerializerHash(identifier, mask); identifierIndex[slot].serializer; slot = (slot + 1) & mask) {
+			if (identifierIndex[slot].identifier == identifier)
+				return identifierIndex[slot].serializer;
+		}
+		BRICKS_FEATURE_THROW(InvalidArgumentException());
+	}
+
+	void Serializer::WriteLength(StreamWriter* writer, u64 length) const
+	{
+		if (format == SerializerFormat::Compact)
+			writer->WriteVarUInt(length);
+		else
+			writer->WriteInt32(length);
+	}
+
+	u64 Serializer::ReadLength(StreamReader* reader) const
+	{
+		if (format == SerializerFormat::Compact)
+			return reader->ReadVarUInt();
+		return reader->ReadInt32();
+	}
+
+	Serializer::ReferenceScope::~ReferenceScope()
+	{
+		if (--serializer->referenceDepth)
+			return;
+		serializer->objectReferences.clear();
+		serializer->stringReferences.clear();
+		serializer->references.clear();
+		serializer->referencesComplete.clear();
 	}
 
 	void Serializer::Serialize(StreamWriter* writer, Object* object) const
+	{
+		SerializeObject(writer, object, false);
+	}
+
+	void Serializer::SerializeKey(StreamWriter* writer, String* key) const
+	{
+		SerializeObject(writer, key, true);
+	}
+
+	void Serializer::SerializeObject(StreamWriter* writer, Object* object, bool key) const
 	{
 		TypeInfo type = object ? TypeOf(object) : TypeInfo::OfType<Internal::NullObject>();
-		Internal::ObjectSerializer* serializer = serializers.GetItem(type);
+		Internal::ObjectSerializer* serializer = FindSerializer(type);
+		if (!preserveReferences || !object) {
+			writer->WriteInt32(serializer->GetIdentifier());
+			serializer->Serialize(writer, object);
+			return;
+		}
+
+		ReferenceScope scope(this);
+		u32 reference = referencesComplete.size();
+		std::pair<std::map<String, u32>::iterator, bool> string;
+		std::pair<std::map<const Object*, u32>::iterator, bool> other;
+		u32 existing;
+		if (key) {
+			string = stringReferences.insert(std::make_pair(*CastTo<String>(object), reference));
+			existing = string.first->second;
+		} else {
+			other = objectReferences.insert(std::make_pair(object, reference));
+			existing = other.first->second;
+		}
+		if (existing != reference) {
+			if (!referencesComplete[existing])
+				BRICKS_FEATURE_THROW(InvalidArgumentException());
+			writer->WriteInt32(ReferenceIdentifier);
+			WriteLength(writer, existing);
+			return;
+		}
+
+		referencesComplete.push_back(false);
 		writer->WriteInt32(serializer->GetIdentifier());
 		serializer->Serialize(writer, object);
+		referencesComplete[reference] = true;
 	}
 
 	Bricks::ReturnPointer<Object> Serializer::Deserialize(StreamReader* reader) const
 	{
-		int value = reader->ReadInt32();
-		foreach (const SerializerDictionary::IteratorType& item, serializers) {
-			if (item.GetValue()->GetIdentifier() == value)
-				return item.GetValue()->Deserialize(reader);
+		int identifier = (int)reader->ReadInt32();
+		if (!preserveReferences)
+			return FindSerializer(identifier)->Deserialize(reader);
+
+		ReferenceScope scope(this);
+		if (identifier == ReferenceIdentifier) {
+			u64 reference = ReadLength(reader);
+			if (reference >= referencesComplete.size() || !referencesComplete[reference])
+				BRICKS_FEATURE_THROW(FormatException());
+			return references[reference];
 		}
-		BRICKS_FEATURE_THROW(InvalidArgumentException());
+
+		Internal::ObjectSerializer* serializer = FindSerializer(identifier);
+		if (serializer->GetType() == TypeInfo::OfType<Internal::NullObject>())
+			return serializer->Deserialize(reader);
+		size_t reference = references.size();
+		references.push_back(NULL);
+		referencesComplete.push_back(false);
+		AutoPointer<Object> object = serializer->Deserialize(reader);
+		references[reference] = object;
+		referencesComplete[reference] = true;
+		return object;
 	}
 
+	static const size_t SerializerBufferSize = 0x1000;
+
 	void Serializer::Serialize(Stream* stream, Object* object) const
 	{
-		Serialize(tempnew StreamWriter(stream, Endian::BigEndian), object);
+		StreamWriter writer(stream, Endian::BigEndian, SerializerBufferSize);
+		Serialize(tempnew writer, object);
+		// Written out here rather than by the destructor, which cannot report errors.
+		writer.Flush(false);
 	}
 
 	ReturnPointer<Object> Serializer::Deserialize(Stream* stream) const
 	{
-		return Deserialize(tempnew StreamReader(stream, Endian::BigEndian));
+		// Reading ahead is only safe when the reader can seek the stream back to the end of the object.
+		StreamReader reader(stream, Endian::BigEndian, stream->CanSeek() ? SerializerBufferSize : 0);
+		return Deserialize(tempnew reader);
 	}
 } }
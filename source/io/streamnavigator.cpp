@@ -16,14 +16,15 @@ namespace Bricks { namespace IO {
 
 	void StreamNavigator::PadTo(u64 position)
 	{
-		if (position < stream->GetPosition())
+		u64 current = GetPosition();
+		if (position < current)
 			BRICKS_FEATURE_THROW(InvalidArgumentException("position"));
-		Pad(position - stream->GetPosition());
+		Pad(position - current);
 	}
 
 	void StreamNavigator::PadToMultiple(int round)
 	{
-		PadTo(Math::RoundUp(stream->GetPosition(), round));
+		PadTo(Math::RoundUp(GetPosition(), round));
 	}
 
 	u64 StreamNavigator::GetPosition()
@@ -3,54 +3,211 @@
 #include "bricks/core/data.h"
 #include "bricks/core/math.h"
 
+#include <string.h>
+
 namespace Bricks { namespace IO {
-	StreamReader::StreamReader(Stream* stream, Endian::Enum endianness) :
-		StreamNavigator(stream, endianness)
+	StreamReader::StreamReader(Stream* stream, Endian::Enum endianness, size_t bufferSize) :
+		StreamNavigator(stream, endianness), buffer(bufferSize ? new u8[bufferSize] : NULL), bufferSize(bufferSize), cursor(buffer), end(buffer)
 	{
 
 	}
 
-#define BRICKS_STREAM_READ(size) \
-	u##size StreamReader::ReadInt##size(Endian::Enum endian) \
-	{ \
-		char data[sizeof(u##size)]; \
-		if (stream->Read(data, sizeof(u##size)) != sizeof(u##size)) \
-			BRICKS_FEATURE_THROW(EndOfStreamException()); \
-		return EndianConvert##size<u##size>(endian ?: endianness, data); \
+	StreamReader::~StreamReader()
+	{
+		if (cursor < end && stream->CanSeek())
+			stream->SetPosition(GetPosition());
+		delete[] buffer;
 	}
-	BRICKS_STREAM_READ(16);
-	BRICKS_STREAM_READ(32);
-	BRICKS_STREAM_READ(64);
-#undef BRICKS_STREAM_READ
 
-	u8 StreamReader::ReadByte()
+	// Makes at least size bytes available at the cursor, moving what is left to the front of the buffer. Returns false at
+	// the end of the stream, leaving whatever could be read buffered.
+	bool StreamReader::Fill(size_t size)
 	{
-		u8 data;
-		if (stream->Read(&data, sizeof(data)) != sizeof(data))
-			BRICKS_FEATURE_THROW(EndOfStreamException());
-		return data;
+		size_t available = end - cursor;
+		if (cursor != buffer) {
+			memmove(buffer, cursor, available);
+			cursor = buffer;
+			end = buffer + available;
+		}
+		while (available < size) {
+			size_t read = stream->Read(buffer + available, bufferSize - available);
+			if (!read)
+				break;
+			available += read;
+			end = buffer + available;
+		}
+		return available >= size;
+	}
+
+	// Consumes size bytes that the inline paths could not, returning them in place when possible and in scratch otherwise.
+	const void* StreamReader::Take(size_t size, void* scratch)
+	{
+		if (cursor == end) {
+			const void* span = stream->TryGetSpan(size);
+			if (span)
+				return span;
+		}
+		if (size <= bufferSize) {
+			if (!Fill(size))
+				BRICKS_FEATURE_THROW(EndOfStreamException());
+			const void* data = cursor;
+			cursor += size;
+			return data;
+		}
+		ReadBytes(scratch, size);
+		return scratch;
+	}
+
+	int StreamReader::Next()
+	{
+		if (cursor < end)
+			return *cursor++;
+		if (!bufferSize)
+			return stream->ReadByte();
+		if (!Fill(1))
+			return -1;
+		return *cursor++;
+	}
+
+	namespace Internal {
+		// Decodes a LEB128 integer from a word holding the next eight bytes in order, packing the seven bit groups together with
+		// masks and shifts rather than looping over them. Returns how many bytes it used, or zero if it is longer than eight.
+		static inline size_t DecodeVarUInt(u64 word, u64& value)
+		{
+			u64 stops = ~word & 0x8080808080808080ULL;
+			if (!stops)
+				return 0;
+			// Keep the bytes up to and including the first without a continuation bit.
+			u64 mask = ((stops & (0 - stops)) << 1) - 1;
+			u64 groups = word & mask & 0x7f7f7f7f7f7f7f7fULL;
+			groups = (groups & 0x007f007f007f007fULL) | ((groups & 0x7f007f007f007f00ULL) >> 1);
+			groups = (groups & 0x00003fff00003fffULL) | ((groups & 0x3fff00003fff0000ULL) >> 2);
+			groups = (groups & 0x000000000fffffffULL) | ((groups & 0x0fffffff00000000ULL) >> 4);
+			value = groups;
+			return ((mask & 0x0101010101010101ULL) * 0x0101010101010101ULL) >> 56;
+		}
+	}
+
+	u64 StreamReader::ReadVarUInt()
+	{
+		if ((size_t)(end - cursor) >= sizeof(u64)) {
+			u64 value;
+			size_t length = Internal::DecodeVarUInt(EndianConvertLE64(cursor), value);
+			if (length) {
+				cursor += length;
+				return value;
+			}
+		}
+		return ReadVarUIntSlow();
+	}
+
+	u64 StreamReader::ReadVarUIntSlow()
+	{
+		u64 value = 0;
+		for (int shift = 0; shift < 70; shift += 7) {
+			int byte = Next();
+			if (byte < 0)
+				BRICKS_FEATURE_THROW(EndOfStreamException());
+			value |= (u64)(byte & 0x7f) << shift;
+			if (!(byte & 0x80))
+				return value;
+		}
+		BRICKS_FEATURE_THROW(FormatException());
+	}
+
+	u32 StreamReader::ReadVLQ()
+	{
+		u32 value = 0;
+		if ((size_t)(end - cursor) >= sizeof(u32)) {
+			for (size_t i = 0; i < sizeof(u32); i++) {
+				u8 byte = cursor[i];
+				value = (value << 7) | (byte & 0x7f);
+				if (!(byte & 0x80)) {
+					cursor += i + 1;
+					return value;
+				}
+			}
+			BRICKS_FEATURE_THROW(FormatException());
+		}
+		for (size_t i = 0; i < sizeof(u32); i++) {
+			int byte = Next();
+			if (byte < 0)
+				BRICKS_FEATURE_THROW(EndOfStreamException());
+			value = (value << 7) | (byte & 0x7f);
+			if (!(byte & 0x80))
+				return value;
+		}
+		BRICKS_FEATURE_THROW(FormatException());
+	}
+
+	u64 StreamReader::GetPosition()
+	{
+		return stream->GetPosition() - (end - cursor);
+	}
+
+	void StreamReader::SetPosition(u64 position)
+	{
+		if (bufferSize) {
+			u64 streamPosition = stream->GetPosition();
+			u64 bufferPosition = streamPosition - (end - buffer);
+			if (position >= bufferPosition && position <= streamPosition) {
+				cursor = buffer + (position - bufferPosition);
+				return;
+			}
+			cursor = end = buffer;
+		}
+		stream->SetPosition(position);
 	}
 
 	void StreamReader::ReadBytes(void* data, size_t size)
 	{
-		if (stream->Read(data, size) != size)
+		size_t available = Math::Min((size_t)(end - cursor), size);
+		if (available) {
+			memcpy(data, cursor, available);
+			cursor += available;
+		}
+		size -= available;
+		if (!size)
+			return;
+
+		u8* destination = (u8*)data + available;
+		if (size < bufferSize) {
+			if (!Fill(size))
+				BRICKS_FEATURE_THROW(EndOfStreamException());
+			memcpy(destination, cursor, size);
+			cursor += size;
+		} else if (stream->Read(destination, size) != size)
 			BRICKS_FEATURE_THROW(EndOfStreamException());
 	}
 
 	Data StreamReader::ReadBytes(size_t size)
 	{
 		Data data(size);
-		if (stream->Read(data, size) != size)
-			BRICKS_FEATURE_THROW(EndOfStreamException());
+		ReadBytes(data.GetData(), size);
 		return data;
 	}
 
+	Data StreamReader::ReadSpan(size_t size)
+	{
+		if ((size_t)(end - cursor) >= size) {
+			const void* data = cursor;
+			cursor += size;
+			return Data(data, size, false);
+		}
+		if (cursor == end) {
+			const void* span = stream->TryGetSpan(size);
+			if (span)
+				return Data(span, size, false);
+		}
+		return ReadBytes(size);
+	}
+
 	String StreamReader::ReadCString(int division)
 	{
 		// TODO: StringBuilder, this is fail.
 		String ret;
 		while (true) {
-			int read = stream->ReadByte();
+			int read = Next();
 			if (read < 0 || read == division)
 				break;
 			ret += (char)read;
@@ -60,9 +217,8 @@ namespace Bricks { namespace IO {
 
 	String StreamReader::ReadString(int length)
 	{
-		char buffer[length];
-		ReadBytes(buffer, length);
-		return String(buffer, length);
+		Data data = ReadSpan(length);
+		return String((const char*)data.GetData(), length);
 	}
 
 	String StreamReader::ReadString()
@@ -72,11 +228,15 @@ namespace Bricks { namespace IO {
 
 	void StreamReader::Pad(u64 size)
 	{
+		size_t available = Math::Min((u64)(end - cursor), size);
+		cursor += available;
+		size -= available;
+		if (!size || stream->TryGetSpan(size))
+			return;
 		u8 padding[0x100];
 		while (size > 0) {
 			size_t sz = Math::Min(sizeof(padding), size);
-			if (stream->Read(padding, sz) != sz)
-				BRICKS_FEATURE_THROW(EndOfStreamException());
+			ReadBytes(padding, sz);
 			size -= sz;
 		}
 	}
@@ -2,54 +2,221 @@
 #include "bricks/io/stream.h"
 #include "bricks/core/math.h"
 
+#include <string.h>
+
 namespace Bricks { namespace IO {
-	StreamWriter::StreamWriter(Stream* stream, Endian::Enum endianness) :
-		StreamNavigator(stream, endianness)
+	StreamWriter::StreamWriter(Stream* stream, Endian::Enum endianness, size_t bufferSize) :
+		StreamNavigator(stream, endianness), batchDepth(0), batchCount(0), batchScratchUsed(0), batchSize(0),
+		buffer(bufferSize ? new u8[bufferSize] : NULL), bufferSize(bufferSize), bufferUsed(0)
 	{
 
 	}
 
-#define BRICKS_STREAM_WRITE(size) \
-	void StreamWriter::WriteInt(u##size value, Endian::Enum endian) \
-	{ \
-		u##size data; \
-		EndianConvert##size(endian ?: endianness, &data, value); \
-		if (stream->Write(&data, sizeof(u##size)) != sizeof(u##size)) \
-		BRICKS_FEATURE_THROW(StreamException()); \
+	StreamWriter::~StreamWriter()
+	{
+		// Write errors cannot leave a destructor, so they are dropped here.
+		BRICKS_FEATURE_TRY {
+			FlushBuffer();
+			FlushBatch();
+		} BRICKS_FEATURE_CATCH_ALL { }
+		delete[] buffer;
 	}
-	BRICKS_STREAM_WRITE(16);
-	BRICKS_STREAM_WRITE(32);
-	BRICKS_STREAM_WRITE(64);
-#undef BRICKS_STREAM_WRITE
 
-	void StreamWriter::WriteByte(u8 data)
+	void StreamWriter::Flush(bool flushStream)
 	{
-		if (stream->Write(&data, sizeof(data)) != sizeof(data))
+		FlushBuffer();
+		FlushBatch();
+		if (flushStream)
+			stream->Flush();
+	}
+
+	void StreamWriter::FlushBuffer()
+	{
+		if (!bufferUsed)
+			return;
+		size_t size = bufferUsed;
+		bufferUsed = 0;
+		if (stream->Write(buffer, size) != size)
 			BRICKS_FEATURE_THROW(StreamException());
 	}
 
-	void StreamWriter::WriteBytes(const void* data, size_t size)
+	u64 StreamWriter::GetPosition()
+	{
+		return stream->GetPosition() + bufferUsed + batchSize;
+	}
+
+	void StreamWriter::SetPosition(u64 position)
+	{
+		FlushBuffer();
+		FlushBatch();
+		stream->SetPosition(position);
+	}
+
+	u64 StreamWriter::GetLength()
+	{
+		// Buffered and batched bytes land contiguously at the stream position once written.
+		return Math::Max(stream->GetLength(), GetPosition());
+	}
+
+	void StreamWriter::FlushBatch()
 	{
-		if (stream->Write(data, size) != size)
+		if (!batchCount)
+			return;
+		size_t size = batchSize;
+		size_t written = stream->WriteVector(batch, batchCount);
+		batchCount = 0;
+		batchScratchUsed = 0;
+		batchSize = 0;
+		if (written != size)
 			BRICKS_FEATURE_THROW(StreamException());
 	}
 
+	void StreamWriter::Emit(const void* data, size_t size, bool borrow)
+	{
+		if (bufferSize) {
+			if (size > bufferSize - bufferUsed) {
+				if (size >= bufferSize) {
+					// Too large to buffer: hand over what is buffered and the payload in one call.
+					IOVector vectors[] = { IOVector(buffer, bufferUsed), IOVector(data, size) };
+					size_t total = bufferUsed + size;
+					int first = bufferUsed ? 0 : 1;
+					bufferUsed = 0;
+					if (stream->WriteVector(vectors + first, 2 - first) != total)
+						BRICKS_FEATURE_THROW(StreamException());
+					return;
+				}
+				FlushBuffer();
+			}
+			memcpy(buffer + bufferUsed, data, size);
+			bufferUsed += size;
+			return;
+		}
+
+		if (!batchDepth) {
+			if (stream->Write(data, size) != size)
+				BRICKS_FEATURE_THROW(StreamException());
+			return;
+		}
+
+		if (borrow && size >= BatchBorrowSize) {
+			if (batchCount == BatchVectors)
+				FlushBatch();
+			batch[batchCount++] = IOVector(data, size);
+			batchSize += size;
+			return;
+		}
+
+		if (batchScratchUsed + size > BatchScratchSize)
+			FlushBatch();
+		if (size > BatchScratchSize) {
+			if (stream->Write(data, size) != size)
+				BRICKS_FEATURE_THROW(StreamException());
+			return;
+		}
+		u8* scratch = batchScratch + batchScratchUsed;
+		memcpy(scratch, data, size);
+		batchScratchUsed += size;
+		if (batchCount && (u8*)batch[batchCount - 1].data + batch[batchCount - 1].size == scratch)
+			batch[batchCount - 1].size += size;
+		else {
+			if (batchCount == BatchVectors) {
+				// Keep the bytes just copied: they move to the start of the scratch buffer once the batch is written.
+				FlushBatch();
+				memmove(batchScratch, scratch, size);
+				scratch = batchScratch;
+				batchScratchUsed = size;
+			}
+			batch[batchCount++] = IOVector(scratch, size);
+		}
+		batchSize += size;
+	}
+
+	static void EndianSwapArray(void* dest, const void* src, size_t count, size_t width)
+	{
+		switch (width) {
+			case sizeof(u16): EndianSwapArray16(dest, src, count); break;
+			case sizeof(u32): EndianSwapArray32(dest, src, count); break;
+			case sizeof(u64): EndianSwapArray64(dest, src, count); break;
+		}
+	}
+
+	void StreamWriter::WriteArray(const void* values, size_t count, size_t width, bool swap)
+	{
+		if (!swap) {
+			Emit(values, count * width, true);
+			return;
+		}
+
+		const u8* source = (const u8*)values;
+		if (bufferSize >= width) {
+			while (count) {
+				if (bufferSize - bufferUsed < width)
+					FlushBuffer();
+				size_t batch = Math::Min(count, (bufferSize - bufferUsed) / width);
+				EndianSwapArray(buffer + bufferUsed, source, batch, width);
+				bufferUsed += batch * width;
+				source += batch * width;
+				count -= batch;
+			}
+			return;
+		}
+
+		u8 scratch[0x400];
+		while (count) {
+			size_t batch = Math::Min(count, sizeof(scratch) / width);
+			EndianSwapArray(scratch, source, batch, width);
+			Emit(scratch, batch * width);
+			source += batch * width;
+			count -= batch;
+		}
+	}
+
+	void StreamWriter::WriteBytes(const void* data, size_t size)
+	{
+		Emit(data, size, true);
+	}
+
+	void StreamWriter::WriteVarUInt(u64 value)
+	{
+		u8 scratch[10];
+		u8* data = Reserve(sizeof(scratch), scratch);
+		size_t size = 0;
+		for (; value >= 0x80; value >>= 7)
+			data[size++] = (u8)value | 0x80;
+		data[size++] = (u8)value;
+		Commit(data, size);
+	}
+
+	void StreamWriter::WriteVLQ(u32 value)
+	{
+		if (value > 0x0fffffff)
+			BRICKS_FEATURE_THROW(InvalidArgumentException());
+		u8 scratch[4];
+		u8* data = Reserve(sizeof(scratch), scratch);
+		size_t size = 0;
+		for (int shift = 21; shift > 0; shift -= 7) {
+			if (size || value >> shift)
+				data[size++] = (u8)(value >> shift) | 0x80;
+		}
+		data[size++] = value & 0x7f;
+		Commit(data, size);
+	}
+
 	void StreamWriter::WriteString(const String& str, size_t size)
 	{
 		if (size == String::npos)
 			size = str.GetSize();
-		WriteBytes(str.CString(), Math::Min(str.GetSize(), size));
+		Emit(str.CString(), Math::Min(str.GetSize(), size));
 		if (size > str.GetSize())
 			Pad(size - str.GetSize());
 	}
 
 	void StreamWriter::Pad(u64 size)
 	{
-		u8 padding[0x100];
+		static const u8 padding[0x100] = { 0 };
 		while (size > 0) {
 			size_t sz = Math::Min(sizeof(padding), size);
-			if (stream->Write(padding, sz) != sz)
-				BRICKS_FEATURE_THROW(StreamException());
+			Emit(padding, sz, true);
 			size -= sz;
 		}
 	}
@@ -20,26 +20,51 @@ namespace Bricks { namespace IO {
 
 	size_t Substream::Read(void* buffer, size_t size)
 	{
-		if (position + size > length)
-			size = length - position;
-		if (stream->GetPosition() != offset + position)
-			stream->SetPosition(offset + position);
-		size = stream->Read(buffer, size);
+		size = ReadAt(position, buffer, size);
 		position += size;
 		return size;
 	}
 
 	size_t Substream::Write(const void* buffer, size_t size)
 	{
-		if (position + size > length)
-			size = length - position;
-		if (stream->GetPosition() != offset + position)
-			stream->SetPosition(offset + position);
-		size = stream->Write(buffer, size);
+		size = WriteAt(position, buffer, size);
 		position += size;
 		return size;
 	}
 
+	size_t Substream::ReadAt(u64 offset, void* buffer, size_t size)
+	{
+		if (offset >= length)
+			return 0;
+		if (size > length - offset)
+			size = length - offset;
+		return stream->ReadAt(this->offset + offset, buffer, size);
+	}
+
+	size_t Substream::WriteAt(u64 offset, const void* buffer, size_t size)
+	{
+		if (offset >= length)
+			return 0;
+		if (size > length - offset)
+			size = length - offset;
+		return stream->WriteAt(this->offset + offset, buffer, size);
+	}
+
+	const void* Substream::TryGetSpan(size_t size)
+	{
+		const void* span = TryGetSpanAt(position, size);
+		if (span)
+			position += size;
+		return span;
+	}
+
+	const void* Substream::TryGetSpanAt(u64 offset, size_t size)
+	{
+		if (offset > length || size > length - offset)
+			return NULL;
+		return stream->TryGetSpanAt(this->offset + offset, size);
+	}
+
 	u64 Substream::GetStreamOffset(Stream* parent)
 	{
 #if BRICKS_CONFIG_RTTI
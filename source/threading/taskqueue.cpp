@@ -40,7 +40,8 @@ namespace Bricks { namespace Threading {
 
 				if (tasks->GetCount()) {
 					AutoPointer<Internal::TaskBase> task = tasks->PopItem();
-					condition->Signal(TaskQueue::ConditionStatus(tasks));
+					if (condition->GetCondition() != TaskQueueCondition::Cancel)
+						condition->Signal(TaskQueue::ConditionStatus(tasks));
 					lock.Unlock();
 
 					task->SetThread(thread);
@@ -55,7 +56,8 @@ namespace Bricks { namespace Threading {
 	{
 		MutexLock lock(queueCondition);
 		queue->Push(task);
-		queueCondition->Signal(TaskQueueCondition::Ready);
+		if (queueCondition->GetCondition() != TaskQueueCondition::Cancel)
+			queueCondition->Signal(TaskQueueCondition::Ready);
 	}
 
 	void TaskQueue::StartThread()
@@ -86,7 +88,7 @@ namespace Bricks { namespace Threading {
 		{	MutexLock lock(queueCondition);
 			if (queueCondition->GetCondition() == TaskQueueCondition::Cancel)
 				return;
-			queueCondition->Signal(TaskQueueCondition::Cancel);
+			queueCondition->Broadcast(TaskQueueCondition::Cancel);
 		}
 
 		if (wait) {
@@ -97,6 +99,6 @@ namespace Bricks { namespace Threading {
 
 	TaskQueueCondition::Enum TaskQueue::ConditionStatus(const QueueType* queue)
 	{
-		return queue->GetCount() ? TaskQueueCondition::Ready : TaskQueueCondition::Cancel;
+		return queue->GetCount() ? TaskQueueCondition::Ready : TaskQueueCondition::Waiting;
 	}
 } }
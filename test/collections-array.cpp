@@ -0,0 +1,317 @@
+#include "brickstest.hpp"
+
+#include <bricks/core/random.h>
+#include <bricks/core/time.h>
+#include <bricks/core/timespan.h>
+#include <bricks/collections/array.h>
+#include <bricks/collections/smallarray.h>
+#include <bricks/collections/soaarray.h>
+#include <bricks/collections/autoarray.h>
+#include <bricks/collections/queue.h>
+#include <bricks/threading/parallelsort.h>
+
+#include <stdio.h>
+
+using namespace Bricks;
+using namespace Bricks::Collections;
+using namespace Bricks::Threading;
+
+template<typename T> static void ExpectSorted(const Array<T>& array)
+{
+	for (long i = 1; i < array.GetCount(); i++)
+		EXPECT_FALSE(array[i] < array[i - 1]) << "at index " << i;
+}
+
+struct RadixItem
+{
+	int key;
+	int order;
+};
+
+static int RadixItemKey(const RadixItem& item) { return item.key; }
+
+struct RadixItemFloatKey
+{
+	typedef f32 KeyType;
+	f32 operator ()(const RadixItem& item) const { return -(f32)item.key; }
+};
+
+TEST(BricksCollectionsArrayTest, RadixSortUnsigned) {
+	Random random(1);
+	Array<u32> array;
+	for (int i = 0; i < 10000; i++)
+		array.AddItem((u32)random.Generate<int>() * 3);
+	array.RadixSort();
+	ExpectSorted(array);
+
+	Array<u8> bytes;
+	for (int i = 0; i < 1000; i++)
+		bytes.AddItem(random.Generate(0, 255));
+	bytes.RadixSort();
+	ExpectSorted(bytes);
+}
+
+TEST(BricksCollectionsArrayTest, RadixSortSigned) {
+	Random random(2);
+	Array<s64> array;
+	for (int i = 0; i < 10000; i++)
+		array.AddItem((s64)random.Generate(-100000, 100000) * 100000);
+	array.AddItem(0);
+	array.AddItem(-1);
+	array.RadixSort();
+	ExpectSorted(array);
+}
+
+TEST(BricksCollectionsArrayTest, RadixSortFloat) {
+	Random random(3);
+	Array<f32> array;
+	for (int i = 0; i < 10000; i++)
+		array.AddItem(random.Generate(-1000.0f, 1000.0f));
+	array.AddItem(0.0f);
+	array.AddItem(-0.5f);
+	array.RadixSort();
+	ExpectSorted(array);
+
+	Array<f64> doubles;
+	doubles.AddItem(3.5);
+	doubles.AddItem(-1e300);
+	doubles.AddItem(1e-300);
+	doubles.AddItem(-2.25);
+	doubles.RadixSort();
+	ExpectSorted(doubles);
+}
+
+TEST(BricksCollectionsArrayTest, RadixSortString) {
+	Array<String> array;
+	array.AddItem("prefixed string b");
+	array.AddItem("prefixed string a");
+	array.AddItem("short");
+	array.AddItem("");
+	array.AddItem("prefix");
+	array.AddItem("abc");
+	array.RadixSort();
+	ExpectSorted(array);
+	EXPECT_EQ(String(""), array[0]);
+	EXPECT_EQ(String("prefixed string b"), array[4]);
+}
+
+TEST(BricksCollectionsArrayTest, RadixSortKeyStable) {
+	Random random(4);
+	Array<RadixItem> array;
+	for (int i = 0; i < 10000; i++) {
+		RadixItem item = { random.Generate(-50, 50), i };
+		array.AddItem(item);
+	}
+
+	array.RadixSort(RadixItemKey);
+	for (long i = 1; i < array.GetCount(); i++) {
+		EXPECT_LE(array[i - 1].key, array[i].key);
+		if (array[i - 1].key == array[i].key) {
+			EXPECT_LT(array[i - 1].order, array[i].order);
+		}
+	}
+
+	array.RadixSort(RadixItemFloatKey());
+	for (long i = 1; i < array.GetCount(); i++)
+		EXPECT_GE(array[i - 1].key, array[i].key);
+}
+
+TEST(BricksCollectionsArrayTest, ParallelRadixSort) {
+	Random random(5);
+	Array<s32> array;
+	for (int i = 0; i < 200000; i++)
+		array.AddItem(random.Generate(-1000000, 1000000));
+	Array<s32> expected(array);
+	expected.Sort();
+
+	AutoPointer<TaskQueue> queue = autonew TaskQueue(4);
+	queue->Start();
+	ParallelRadixSort(&array, queue.GetValue());
+	queue->Stop(true);
+	for (long i = 0; i < array.GetCount(); i++)
+		ASSERT_EQ(expected[i], array[i]);
+}
+
+TEST(BricksCollectionsArrayTest, SmallArray) {
+	SmallArray<int, 4> array;
+	for (int i = 0; i < 4; i++)
+		array.AddItem(i);
+	EXPECT_FALSE(array.IsSpilled());
+	EXPECT_TRUE(array.ContainsItem(3));
+
+	array.InsertItem(0, -1);
+	EXPECT_TRUE(array.IsSpilled());
+	EXPECT_EQ(5, array.GetCount());
+	int expected = -1;
+	foreach (int value, array)
+		EXPECT_EQ(expected++, value);
+
+	EXPECT_TRUE(array.RemoveItem(1));
+	EXPECT_FALSE(array.RemoveItem(1));
+	array.RemoveItemAt(0);
+	EXPECT_EQ(3, array.GetCount());
+	EXPECT_EQ(0, array[0]);
+	EXPECT_EQ(3, array[2]);
+	EXPECT_EQ(2, array.IndexOfItem(3));
+
+	SmallArray<int, 4> copy(array);
+	array.Clear();
+	EXPECT_EQ(0, array.GetCount());
+	EXPECT_EQ(3, copy.GetCount());
+}
+
+TEST(BricksCollectionsArrayTest, SmallArrayObjects) {
+	SmallArray<String, 2> array;
+	array.AddItem("c");
+	array.AddItem("a");
+	array.InsertItem(1, "b");
+	array.AddItem(array[0]);
+	EXPECT_EQ(4, array.GetCount());
+	EXPECT_EQ(String("c"), array[3]);
+
+	array.Sort();
+	EXPECT_EQ(String("a"), array[0]);
+	EXPECT_EQ(String("c"), array[3]);
+
+	SmallArray<String, 2> assigned;
+	assigned.AddItem("x");
+	assigned = array;
+	EXPECT_EQ(4, assigned.GetCount());
+	EXPECT_EQ(String("b"), assigned[1]);
+}
+
+TEST(BricksCollectionsArrayTest, SoAArray) {
+	SoAArray<float, s32, String> array;
+	int fields = SoAArray<float, s32, String>::FieldCount;
+	EXPECT_EQ(3, fields);
+	for (int i = 0; i < 20; i++)
+		array.AddItem(i * 0.5f, i, String::Format("%d", i));
+	array.AddItem(1.0f);
+	ASSERT_EQ(21, array.GetCount());
+	EXPECT_EQ(0, array[20].Get<1>());
+	EXPECT_EQ(String::Empty, array[20].Get<2>());
+
+	SoASpan<float> positions = array.GetColumn<0>();
+	EXPECT_EQ(0, (size_t)positions.data % 32);
+	EXPECT_EQ(0, (size_t)array.GetColumnData<1>() % 32);
+	for (long i = 0; i < positions.count; i++)
+		positions[i] += 1.0f;
+	EXPECT_EQ(3.5f, array[5].Get<0>());
+
+	array[5].Set<2>("five");
+	array.RemoveItemAt(4);
+	EXPECT_EQ(20, array.GetCount());
+	EXPECT_EQ(String("five"), array[4].Get<2>());
+	EXPECT_EQ(6, array.GetRow(5).Get<1>());
+
+	// Rows copied from the array itself survive the resize they trigger.
+	long capacity = array.GetCapacity();
+	while (array.GetCapacity() == capacity)
+		array.AddItem(array[4].Get<0>(), array[4].Get<1>(), array[4].Get<2>());
+	EXPECT_EQ(String("five"), array[array.GetCount() - 1].Get<2>());
+	EXPECT_EQ(3.5f, array[array.GetCount() - 1].Get<0>());
+
+	array.Clear();
+	EXPECT_EQ(0, array.GetCount());
+	EXPECT_GE(array.GetCapacity(), 21);
+}
+
+TEST(BricksCollectionsArrayTest, Ranges) {
+	int values[] = { 1, 2, 3, 4, 5 };
+	Array<int> array;
+	array.Reserve(100);
+	EXPECT_GE(array.GetCapacity(), 100);
+	array.AddRange(values, 5);
+	array.InsertRange(1, values + 3, 2);
+	int expected[] = { 1, 4, 5, 2, 3, 4, 5 };
+	ASSERT_EQ(7, array.GetCount());
+	for (int i = 0; i < 7; i++)
+		EXPECT_EQ(expected[i], array[i]);
+	array.ShrinkToFit();
+	EXPECT_EQ(7, array.GetCapacity());
+
+	array.AddItems(tempnew array);
+	EXPECT_EQ(14, array.GetCount());
+	EXPECT_EQ(1, array[7]);
+
+	// Ranges taken from the array itself survive it reallocating underneath them.
+	Array<int> self;
+	self.AddRange(values, 5);
+	self.ShrinkToFit();
+	self.AddRange(self.GetData() + 1, 3);
+	self.InsertRange(0, self.GetData() + 5, 3);
+	int selfExpected[] = { 2, 3, 4, 1, 2, 3, 4, 5, 2, 3, 4 };
+	ASSERT_EQ(11, self.GetCount());
+	for (int i = 0; i < 11; i++)
+		EXPECT_EQ(selfExpected[i], self[i]);
+
+	SmallArray<int, 4> small;
+	small.AddItems(tempnew array);
+	EXPECT_EQ(14, small.GetCount());
+	small.InsertRange(2, values, 3);
+	EXPECT_EQ(17, small.GetCount());
+	EXPECT_EQ(1, small[2]);
+	EXPECT_EQ(3, small[4]);
+	EXPECT_EQ(5, small[5]);
+	for (int i = 0; i < 14; i++)
+		small.RemoveItemAt(0);
+	small.ShrinkToFit();
+	EXPECT_FALSE(small.IsSpilled());
+	EXPECT_EQ(3, small.GetCount());
+
+	Queue<int> queue;
+	queue.AddItems(tempnew array);
+	EXPECT_EQ(14, queue.GetCount());
+	EXPECT_EQ(1, queue.PopItem());
+}
+
+TEST(BricksCollectionsArrayTest, AutoArrayRanges) {
+	AutoPointer<String> strings[] = { autonew String("a"), autonew String("b") };
+	String* values[] = { strings[0], strings[1] };
+	{
+		AutoArray<String> array;
+		array.AddRange(values, 2);
+		array.InsertRange(0, values, 2);
+		EXPECT_EQ(4, array.GetCount());
+		EXPECT_EQ(3, strings[0]->GetReferenceCount());
+
+		AutoArray<String> copy;
+		copy.AddItems(tempnew array);
+		EXPECT_EQ(5, strings[1]->GetReferenceCount());
+	}
+	EXPECT_EQ(1, strings[0]->GetReferenceCount());
+}
+
+// Timing comparison against the comparison sort; run with --gtest_also_run_disabled_tests.
+TEST(BricksCollectionsArrayTest, DISABLED_RadixSortBenchmark) {
+	static const int Count = 4000000;
+	Random random(6);
+	Array<u32> source;
+	for (int i = 0; i < Count; i++)
+		source.AddItem(random.Generate<int>());
+
+	Array<u32> array(source);
+	Time start = Time::GetCurrentTime();
+	array.Sort();
+	float sortTime = (Time::GetCurrentTime() - start).GetTotalSeconds();
+
+	array = source;
+	start = Time::GetCurrentTime();
+	array.RadixSort();
+	float radixTime = (Time::GetCurrentTime() - start).GetTotalSeconds();
+	ExpectSorted(array);
+
+	array = source;
+	start = Time::GetCurrentTime();
+	ParallelRadixSort(&array);
+	float parallelTime = (Time::GetCurrentTime() - start).GetTotalSeconds();
+	ExpectSorted(array);
+
+	printf("%d items: Sort %.3fs, RadixSort %.3fs, ParallelRadixSort %.3fs\n", Count, sortTime, radixTime, parallelTime);
+}
+
+int main(int argc, char* argv[])
+{
+	testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,125 @@
+#include "brickstest.hpp"
+
+#include <bricks/collections/cache.h>
+#include <bricks/threading/concurrentcache.h>
+
+using namespace Bricks;
+using namespace Bricks::Collections;
+using namespace Bricks::Threading;
+
+static size_t StringCost(const int& key, const String& value) { return value.GetSize(); }
+
+static int evictedKeys;
+static void CountEviction(const int& key, const String& value) { evictedKeys += key; }
+
+TEST(BricksCollectionsCacheTest, LeastRecentlyUsed) {
+	Cache<int, int> cache(3);
+	cache.Add(1, 10);
+	cache.Add(2, 20);
+	cache.Add(3, 30);
+
+	int value;
+	EXPECT_TRUE(cache.TryGetItem(1, value));
+	EXPECT_EQ(10, value);
+	cache.Add(4, 40);
+	EXPECT_EQ(3, cache.GetCount());
+	EXPECT_FALSE(cache.ContainsKey(2));
+	EXPECT_TRUE(cache.ContainsKey(1));
+	EXPECT_FALSE(cache.TryGetItem(2, value));
+
+	EXPECT_EQ(1u, cache.GetStatistics().hits);
+	EXPECT_EQ(1u, cache.GetStatistics().misses);
+	EXPECT_EQ(1u, cache.GetStatistics().evictions);
+
+	cache.Add(1, 11);
+	EXPECT_EQ(3, cache.GetCount());
+	EXPECT_TRUE(cache.TryGetItem(1, value));
+	EXPECT_EQ(11, value);
+
+	cache.SetBudget(1);
+	EXPECT_EQ(1, cache.GetCount());
+	EXPECT_TRUE(cache.ContainsKey(1));
+}
+
+TEST(BricksCollectionsCacheTest, CostBudget) {
+	evictedKeys = 0;
+	Cache<int, String> cache(10);
+	cache.SetCostDelegate(&StringCost);
+	cache.SetEvictionDelegate(&CountEviction);
+
+	cache.Add(1, "abcd");
+	cache.Add(2, "efgh");
+	EXPECT_EQ(8u, cache.GetCost());
+	cache.Add(3, "ijklmn");
+	EXPECT_EQ(10u, cache.GetCost());
+	EXPECT_EQ(1, evictedKeys);
+	EXPECT_FALSE(cache.ContainsKey(1));
+	EXPECT_TRUE(cache.ContainsKey(2));
+
+	EXPECT_FALSE(cache.Add(4, "this is far too long"));
+	EXPECT_EQ(1u, cache.GetStatistics().rejections);
+	EXPECT_TRUE(cache.ContainsKey(3));
+
+	// A rejected replacement leaves the cached value in place.
+	EXPECT_FALSE(cache.Add(3, "this is far too long"));
+	String value;
+	EXPECT_TRUE(cache.TryGetItem(3, value));
+	EXPECT_EQ(String("ijklmn"), value);
+	EXPECT_EQ(10u, cache.GetCost());
+}
+
+TEST(BricksCollectionsCacheTest, FrequencyAdmission) {
+	Cache<int, int> cache(2, CachePolicy::FrequencyAdmission);
+	int value;
+	for (int i = 0; i < 5; i++) {
+		cache.TryGetItem(1, value);
+		cache.TryGetItem(2, value);
+	}
+	cache.Add(1, 1);
+	cache.Add(2, 2);
+
+	// A key seen once does not displace the frequently requested ones.
+	cache.TryGetItem(3, value);
+	EXPECT_FALSE(cache.Add(3, 3));
+	EXPECT_TRUE(cache.ContainsKey(1));
+	EXPECT_TRUE(cache.ContainsKey(2));
+
+	for (int i = 0; i < 10; i++)
+		cache.TryGetItem(3, value);
+	EXPECT_TRUE(cache.Add(3, 3));
+	EXPECT_EQ(2, cache.GetCount());
+
+	// Replacing a cached key makes room for itself, even when it is the next eviction victim.
+	EXPECT_TRUE(cache.ContainsKey(2));
+	EXPECT_TRUE(cache.Add(2, 10));
+	EXPECT_TRUE(cache.TryGetItem(2, value));
+	EXPECT_EQ(10, value);
+	EXPECT_EQ(2, cache.GetCount());
+}
+
+TEST(BricksCollectionsCacheTest, Concurrent) {
+	ConcurrentCache<int, int> cache(64, 4);
+	EXPECT_EQ(4, cache.GetShardCount());
+	for (int i = 0; i < 32; i++)
+		cache.Add(i, i * 2);
+
+	int value;
+	long hits = 0;
+	for (int i = 0; i < 32; i++) {
+		if (cache.TryGetItem(i, value)) {
+			EXPECT_EQ(i * 2, value);
+			hits++;
+		}
+	}
+	EXPECT_EQ((long)cache.GetStatistics().hits, hits);
+	EXPECT_EQ(cache.GetCount(), hits);
+	EXPECT_LE(cache.GetCount(), 64);
+	cache.Clear();
+	EXPECT_EQ(0, cache.GetCount());
+}
+
+int main(int argc, char* argv[])
+{
+	testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
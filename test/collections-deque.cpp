@@ -0,0 +1,80 @@
+#include "brickstest.hpp"
+
+#include <bricks/collections/queue.h>
+#include <bricks/collections/stack.h>
+
+using namespace Bricks;
+using namespace Bricks::Collections;
+
+TEST(BricksCollectionsDequeTest, QueueWrap) {
+	Queue<int> queue;
+	int next = 0;
+	int expected = 0;
+	for (int round = 0; round < 100; round++) {
+		for (int i = 0; i < 5; i++)
+			queue.Push(next++);
+		for (int i = 0; i < 3; i++)
+			EXPECT_EQ(expected++, queue.PopItem());
+	}
+	EXPECT_EQ(200, queue.GetCount());
+
+	foreach (int value, queue)
+		EXPECT_EQ(expected++, value);
+	EXPECT_EQ(next, expected);
+
+	EXPECT_TRUE(queue.RemoveItem(350));
+	EXPECT_FALSE(queue.ContainsItem(350));
+	EXPECT_EQ(199, queue.GetCount());
+	EXPECT_EQ(300, queue.Peek());
+}
+
+TEST(BricksCollectionsDequeTest, StackOrder) {
+	Stack<String> stack;
+	stack.Push("a");
+	stack.Push("b");
+	stack.Push("c");
+	EXPECT_EQ(String("c"), stack.Peek());
+
+	const char* order[] = { "c", "b", "a" };
+	int i = 0;
+	foreach (const String& value, stack)
+		EXPECT_EQ(String(order[i++]), value);
+
+	Stack<String> copy(stack);
+	stack.Pop();
+	EXPECT_EQ(String("b"), stack.PopItem());
+	EXPECT_EQ(String("a"), stack.PopItem());
+	EXPECT_EQ(0, stack.GetCount());
+	EXPECT_EQ(3, copy.GetCount());
+	EXPECT_EQ(String("c"), copy.Peek());
+}
+
+TEST(BricksCollectionsDequeTest, Ranges) {
+	int values[100];
+	for (int i = 0; i < 100; i++)
+		values[i] = i;
+
+	Queue<int> queue;
+	queue.Push(-1);
+	queue.Pop();
+	queue.PushRange(values, 100);
+	EXPECT_EQ(100, queue.GetCount());
+
+	int popped[64];
+	EXPECT_EQ(64, queue.PopRange(popped, 64));
+	for (int i = 0; i < 64; i++)
+		EXPECT_EQ(i, popped[i]);
+	EXPECT_EQ(36, queue.PopRange(popped, 64));
+	EXPECT_EQ(99, popped[35]);
+	EXPECT_EQ(0, queue.GetCount());
+
+	Stack<int> stack;
+	stack.PushRange(values, 3);
+	EXPECT_EQ(2, stack.PopItem());
+}
+
+int main(int argc, char* argv[])
+{
+	testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -60,6 +60,52 @@ TEST(BricksCollectionsListGuardTest, ObjectAutoArrayTest) {
 	EXPECT_EQ(0, guarded.GetCount());
 }
 
+TEST(BricksCollectionsListGuardTest, MutationTest) {
+	ArrayGuard<int> guarded;
+	for (int i = 0; i < 6; i++)
+		guarded.AddItem(i);
+
+	Array<int> visited;
+	foreach (int num, guarded) {
+		visited.AddItem(num);
+		if (num == 1) {
+			guarded.InsertItem(0, 100);
+			guarded.InsertItem(4, 101);
+			guarded.RemoveItem(3);
+			guarded.SetItem(guarded.IndexOfItem(4), 104);
+		} else if (num == 4)
+			guarded.Clear();
+	}
+
+	EXPECT_EQ(6, visited.GetCount());
+	for (int i = 0; i < visited.GetCount(); i++)
+		EXPECT_EQ(i, visited[i]);
+	EXPECT_EQ(0, guarded.GetCount());
+	EXPECT_FALSE(guarded.IsGuarding());
+}
+
+TEST(BricksCollectionsListGuardTest, NestedTest) {
+	AutoArrayGuard<String> guarded;
+	guarded.AddItem(autonew String("a"));
+	guarded.AddItem(autonew String("b"));
+	guarded.AddItem(autonew String("c"));
+
+	int outer = 0;
+	foreach (String* string, guarded) {
+		outer++;
+		int inner = 0;
+		foreach (String* other, guarded) {
+			inner++;
+			if (other == string)
+				guarded.RemoveItem(other);
+		}
+		EXPECT_EQ(4 - outer, inner);
+		EXPECT_EQ(1, string->GetLength());
+	}
+	EXPECT_EQ(3, outer);
+	EXPECT_EQ(0, guarded.GetCount());
+}
+
 int main(int argc, char* argv[])
 {
 	testing::InitGoogleTest(&argc, argv);
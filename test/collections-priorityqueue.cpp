@@ -0,0 +1,98 @@
+#include "brickstest.hpp"
+
+#include <bricks/core/random.h>
+#include <bricks/collections/array.h>
+#include <bricks/collections/priorityqueue.h>
+
+using namespace Bricks;
+using namespace Bricks::Collections;
+
+class ReverseComparison : public ValueComparison<int>
+{
+public:
+	ComparisonResult::Enum Compare(const int& v1, const int& v2) { return v1 > v2 ? ComparisonResult::Less : (v1 < v2 ? ComparisonResult::Greater : ComparisonResult::Equal); }
+};
+
+TEST(BricksCollectionsPriorityQueueTest, Order) {
+	Random random(1);
+	PriorityQueue<int> queue;
+	for (int i = 0; i < 1000; i++)
+		queue.Push(random.Generate(-500, 500));
+	EXPECT_EQ(1000, queue.GetCount());
+
+	int previous = queue.PopItem();
+	while (queue.GetCount()) {
+		int value = queue.PopItem();
+		EXPECT_LE(previous, value);
+		previous = value;
+	}
+}
+
+TEST(BricksCollectionsPriorityQueueTest, Comparison) {
+	PriorityQueue<int> queue(autonew ReverseComparison());
+	queue.Push(3);
+	queue.Push(10);
+	queue.Push(-4);
+	EXPECT_EQ(10, queue.PopItem());
+	EXPECT_EQ(3, queue.PopItem());
+	EXPECT_EQ(-4, queue.PopItem());
+}
+
+TEST(BricksCollectionsPriorityQueueTest, Handles) {
+	PriorityQueue<int> queue;
+	PriorityQueue<int>::Handle handles[10];
+	for (int i = 0; i < 10; i++)
+		handles[i] = queue.Push(i * 10);
+
+	queue.UpdateItem(handles[7], -1);
+	EXPECT_EQ(-1, queue.Peek());
+	EXPECT_EQ(handles[7], queue.PeekHandle());
+
+	queue.UpdateItem(handles[7], 1000);
+	EXPECT_EQ(0, queue.Peek());
+	EXPECT_EQ(1000, queue.GetItem(handles[7]));
+
+	queue.RemoveHandle(handles[0]);
+	EXPECT_FALSE(queue.ContainsHandle(handles[0]));
+	EXPECT_TRUE(queue.ContainsHandle(handles[1]));
+	EXPECT_EQ(10, queue.PopItem());
+	EXPECT_FALSE(queue.ContainsHandle(handles[1]));
+
+	EXPECT_TRUE(queue.RemoveItem(50));
+	int expected[] = { 20, 30, 40, 60, 80, 90, 1000 };
+	for (int i = 0; i < 7; i++)
+		EXPECT_EQ(expected[i], queue.PopItem());
+}
+
+TEST(BricksCollectionsPriorityQueueTest, Heapify) {
+	Random random(2);
+	Array<int> values;
+	for (int i = 0; i < 500; i++)
+		values.AddItem(random.Generate(0, 100));
+
+	PriorityQueue<int> queue(tempnew values);
+	values.Sort();
+	foreach (int value, values)
+		EXPECT_EQ(value, queue.PopItem());
+}
+
+TEST(BricksCollectionsPriorityQueueTest, HeapifyEmpty) {
+	Array<int> values;
+	PriorityQueue<int> queue(tempnew values);
+	EXPECT_EQ(0, queue.GetCount());
+	queue.AddItems(tempnew values);
+	queue.AddRange(NULL, 0);
+	EXPECT_EQ(0, queue.GetCount());
+
+	PriorityQueue<int> copy(queue, autonew ReverseComparison());
+	EXPECT_EQ(0, copy.GetCount());
+	copy.Push(1);
+	copy.Push(2);
+	EXPECT_EQ(2, copy.PopItem());
+}
+
+int main(int argc, char* argv[])
+{
+	testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,188 @@
+#include "brickstest.hpp"
+
+#include <bricks/core/autopointer.h>
+#include <bricks/core/math.h>
+#include <bricks/compression/deflatestream.h>
+#include <bricks/io/memorystream.h>
+#include <bricks/io/streamreader.h>
+#include <bricks/io/streamwriter.h>
+#include <bricks/io/serializer.h>
+
+#include <string.h>
+
+using namespace Bricks;
+using namespace Bricks::IO;
+using namespace Bricks::Compression;
+
+class BricksCompressionDeflateStreamTest : public testing::Test
+{
+protected:
+	std::vector<u8> data;
+	virtual void SetUp()
+	{
+		// Repetitive enough to compress well, irregular enough to span several deflate blocks.
+		data.resize(0x30000);
+		u32 seed = 1;
+		for (size_t i = 0; i < data.size(); i++) {
+			seed = seed * 1103515245 + 12345;
+			data[i] = "abcdefgh"[(seed >> 16) & 7];
+		}
+	}
+
+	virtual void TearDown()
+	{
+	}
+
+	void Compress(MemoryStream* target, DeflateFormat::Enum format, int level = -1, int windowBits = 15)
+	{
+		DeflateStream deflate(target, format, level, windowBits);
+		EXPECT_EQ(data.size(), deflate.Write(&data[0], data.size()));
+		deflate.Finish();
+		EXPECT_EQ(data.size(), deflate.GetUncompressedSize());
+		EXPECT_EQ(target->GetLength(), deflate.GetCompressedSize());
+	}
+
+	void ExpectDecompressed(MemoryStream* source, DeflateFormat::Enum format, size_t readSize)
+	{
+		source->SetPosition(0);
+		InflateStream inflate(source, format);
+		std::vector<u8> result(data.size() + 1);
+		size_t total = 0;
+		while (size_t read = inflate.Read(&result[total], Math::Min(readSize, result.size() - total)))
+			total += read;
+		EXPECT_EQ(data.size(), total);
+		EXPECT_EQ(0, memcmp(&data[0], &result[0], data.size()));
+		EXPECT_TRUE(inflate.IsFinished());
+		EXPECT_EQ(data.size(), inflate.GetLength());
+	}
+};
+
+TEST_F(BricksCompressionDeflateStreamTest, RoundTrip) {
+	DeflateFormat::Enum formats[] = { DeflateFormat::Raw, DeflateFormat::Zlib, DeflateFormat::Gzip };
+	for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+		MemoryStream stream;
+		Compress(tempnew stream, formats[i]);
+		EXPECT_LT(stream.GetLength(), data.size() / 2);
+		ExpectDecompressed(tempnew stream, formats[i], 0x100);
+		ExpectDecompressed(tempnew stream, formats[i], 0x20000);
+	}
+}
+
+TEST_F(BricksCompressionDeflateStreamTest, Headers) {
+	MemoryStream zlib, gzip;
+	Compress(tempnew zlib, DeflateFormat::Zlib);
+	Compress(tempnew gzip, DeflateFormat::Gzip);
+	const u8* zlibHeader = static_cast<const u8*>(zlib.GetBuffer());
+	EXPECT_EQ(0x78, zlibHeader[0]);
+	EXPECT_EQ(0, ((zlibHeader[0] << 8) | zlibHeader[1]) % 31);
+	const u8* gzipHeader = static_cast<const u8*>(gzip.GetBuffer());
+	EXPECT_EQ(0x1f, gzipHeader[0]);
+	EXPECT_EQ(0x8b, gzipHeader[1]);
+
+	ExpectDecompressed(tempnew zlib, DeflateFormat::Automatic, 0x1000);
+	ExpectDecompressed(tempnew gzip, DeflateFormat::Automatic, 0x1000);
+}
+
+TEST_F(BricksCompressionDeflateStreamTest, Settings) {
+	MemoryStream stored, fast, small;
+	Compress(tempnew stored, DeflateFormat::Raw, 0);
+	Compress(tempnew fast, DeflateFormat::Raw, 1);
+	Compress(tempnew small, DeflateFormat::Raw, 9, 9);
+	EXPECT_GT(stored.GetLength(), data.size());
+	EXPECT_LT(fast.GetLength(), data.size() / 2);
+	ExpectDecompressed(tempnew stored, DeflateFormat::Raw, 0x1000);
+	ExpectDecompressed(tempnew small, DeflateFormat::Raw, 0x1000);
+
+	MemoryStream stream;
+	EXPECT_THROW(DeflateStream(tempnew stream, DeflateFormat::Zlib, 10), InvalidArgumentException);
+	EXPECT_THROW(DeflateStream(tempnew stream, DeflateFormat::Zlib, -1, 16), InvalidArgumentException);
+	EXPECT_THROW(DeflateStream(tempnew stream, DeflateFormat::Automatic), InvalidArgumentException);
+}
+
+TEST_F(BricksCompressionDeflateStreamTest, Flush) {
+	MemoryStream stream;
+	DeflateStream deflate(tempnew stream, DeflateFormat::Zlib);
+	deflate.Write(&data[0], 0x1000);
+	deflate.Flush();
+
+	// Everything written before the flush decodes without the rest of the stream.
+	MemoryStream partial(stream.GetBuffer(), stream.GetLength());
+	InflateStream inflate(tempnew partial);
+	std::vector<u8> result(0x1000);
+	EXPECT_EQ(0x1000, inflate.Read(&result[0], result.size()));
+	EXPECT_EQ(0, memcmp(&data[0], &result[0], result.size()));
+	EXPECT_THROW(inflate.Read(&result[0], 1), ZlibException);
+}
+
+TEST_F(BricksCompressionDeflateStreamTest, Truncated) {
+	MemoryStream stream;
+	Compress(tempnew stream, DeflateFormat::Gzip);
+	stream.SetLength(stream.GetLength() - 4);
+	stream.SetPosition(0);
+	InflateStream inflate(tempnew stream);
+	std::vector<u8> result(data.size() + 1);
+	EXPECT_THROW(inflate.Read(&result[0], result.size()), ZlibException);
+}
+
+TEST_F(BricksCompressionDeflateStreamTest, TrailingData) {
+	MemoryStream stream;
+	Compress(tempnew stream, DeflateFormat::Zlib);
+	u64 end = stream.GetLength();
+	StreamWriter(tempnew stream).WriteInt32(0x12345678);
+
+	stream.SetPosition(0);
+	{ InflateStream inflate(tempnew stream);
+	std::vector<u8> result(data.size() + 1);
+	EXPECT_EQ(data.size(), inflate.Read(&result[0], result.size())); }
+	EXPECT_EQ(end, stream.GetPosition());
+	EXPECT_EQ(0x12345678, StreamReader(tempnew stream).ReadInt32());
+}
+
+TEST_F(BricksCompressionDeflateStreamTest, Serializer) {
+	Serializer serializer(SerializerFormat::Compact);
+	AutoPointer<SerializationArray> array = autonew SerializationArray();
+	for (int i = 0; i < 1000; i++)
+		array->AddItem(autonew String(String::Format("item %d", i)));
+
+	MemoryStream stream;
+	{ DeflateStream deflate(tempnew stream, DeflateFormat::Gzip);
+	StreamWriter writer(tempnew deflate, Endian::BigEndian, 0x1000);
+	serializer.Serialize(tempnew writer, array);
+	serializer.Serialize(tempnew writer, tempnew String("tail"));
+	writer.Flush(); }
+
+	stream.SetPosition(0);
+	InflateStream inflate(tempnew stream);
+	StreamReader reader(tempnew inflate, Endian::BigEndian);
+	AutoPointer<SerializationArray> result = CastTo<SerializationArray>(serializer.Deserialize(tempnew reader));
+	EXPECT_EQ(1000, result->GetCount());
+	EXPECT_EQ(String("item 999"), *CastTo<String>(result->GetItem(999)));
+	EXPECT_EQ(String("tail"), *CastTo<String>(serializer.Deserialize(tempnew reader)));
+}
+
+TEST_F(BricksCompressionDeflateStreamTest, BufferPool) {
+	DeflateBufferPool pool;
+	MemoryStream stream;
+	{ DeflateStream deflate(tempnew stream, DeflateFormat::Zlib, -1, 15, 0x10000, tempnew pool);
+	deflate.Write(&data[0], data.size()); }
+	size_t retained = pool.GetRetainedSize();
+	EXPECT_GT(retained, 0x10000);
+
+	// A second stream with the same settings takes every block it needs from the pool, and returns them all.
+	MemoryStream second;
+	{ DeflateStream deflate(tempnew second, DeflateFormat::Zlib, -1, 15, 0x10000, tempnew pool);
+	deflate.Write(&data[0], data.size());
+	EXPECT_EQ(0, pool.GetRetainedSize()); }
+	EXPECT_EQ(retained, pool.GetRetainedSize());
+	EXPECT_EQ(stream.GetLength(), second.GetLength());
+
+	DeflateBufferPool limited(0x1000);
+	{ InflateStream inflate(tempnew stream, DeflateFormat::Zlib, 15, 0x10000, tempnew limited); }
+	EXPECT_LE(limited.GetRetainedSize(), 0x1000);
+}
+
+int main(int argc, char* argv[])
+{
+	testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
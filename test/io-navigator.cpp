@@ -1,8 +1,19 @@
 #include "brickstest.hpp"
 
 #include <bricks/io/filestream.h>
+#include <bricks/io/memorystream.h>
+#include <bricks/io/substream.h>
 #include <bricks/io/streamreader.h>
 #include <bricks/io/streamwriter.h>
+#include <bricks/io/serializer.h>
+#include <bricks/io/serializationreader.h>
+#include <bricks/io/serializationwriter.h>
+#include <bricks/io/serializationview.h>
+#include <bricks/io/filemapping.h>
+#include <bricks/core/value.h>
+#include <bricks/core/data.h>
+#include <bricks/core/time.h>
+#include <bricks/core/timespan.h>
 
 using namespace Bricks;
 using namespace Bricks::IO;
@@ -39,6 +50,617 @@ TEST(BricksIoNavigatorTest, WriteReadTest) {
 	Filesystem::GetDefault()->DeleteFile(path);
 }
 
+TEST(BricksIoNavigatorTest, SpanReadTest) {
+	AutoPointer<MemoryStream> stream = autonew MemoryStream();
+	{
+		StreamWriter writer(stream, Endian::BigEndian);
+		writer.WriteInt((u32)0x1337BAAD);
+		writer.WriteString("ohai");
+		writer.WriteInt((u16)0xF33D);
+	}
+	stream->SetPosition(0);
+
+	StreamReader reader(stream, Endian::BigEndian);
+	EXPECT_EQ(0x1337BAAD, reader.ReadInt32());
+	Data span = reader.ReadSpan(2);
+	EXPECT_EQ((u8*)stream->GetBuffer() + 4, span.GetData()) << "Span was copied out of a memory stream";
+	EXPECT_EQ('o', span[0]);
+	EXPECT_EQ(String("ai"), reader.ReadString(2));
+	EXPECT_EQ(0xF33D, reader.ReadInt16());
+	EXPECT_THROW(reader.ReadByte(), EndOfStreamException);
+	EXPECT_EQ(NULL, stream->TryGetSpan(1));
+
+	Substream substream(stream, 4, 4);
+	StreamReader subreader(tempnew substream);
+	EXPECT_EQ((u8*)stream->GetBuffer() + 4, subreader.ReadSpan(4).GetData());
+	EXPECT_TRUE(subreader.IsEndOfFile());
+
+	// Reads through a substream take spans at its own offset and leave the parent where it was.
+	stream->SetPosition(7);
+	Substream header(stream, 0, 4);
+	EXPECT_EQ(0x1337BAAD, StreamReader(tempnew header, Endian::BigEndian).ReadInt32());
+	EXPECT_EQ(7, stream->GetPosition());
+}
+
+TEST(BricksIoNavigatorTest, BatchWriteTest) {
+	String path = "/tmp/libbricks-test.bin";
+	u8 payload[0x100];
+	for (size_t i = 0; i < sizeof(payload); i++)
+		payload[i] = i;
+	{ FileStream stream(path, FileOpenMode::Create, FileMode::ReadWrite, FilePermissions::OwnerReadWrite);
+	StreamWriter writer(tempnew stream, Endian::BigEndian);
+	writer.BeginBatch();
+	for (int i = 0; i < 40; i++) {
+		writer.WriteInt((u32)i);
+		writer.WriteString("record");
+		writer.WriteBytes(payload, sizeof(payload));
+	}
+	writer.Pad(3);
+	EXPECT_LT(stream.GetLength(), 40 * (4 + 6 + sizeof(payload)) + 3);
+	EXPECT_EQ(40 * (4 + 6 + sizeof(payload)) + 3, writer.GetPosition());
+	writer.EndBatch();
+	EXPECT_EQ(40 * (4 + 6 + sizeof(payload)) + 3, stream.GetLength()); }
+
+	{ FileStream stream(path, FileOpenMode::Open, FileMode::ReadOnly);
+	StreamReader reader(tempnew stream, Endian::BigEndian);
+	for (u32 i = 0; i < 40; i++) {
+		EXPECT_EQ(i, reader.ReadInt32());
+		EXPECT_EQ(String("record"), reader.ReadString(6));
+		Data data = reader.ReadBytes(sizeof(payload));
+		EXPECT_EQ(0, memcmp(data.GetData(), payload, sizeof(payload)));
+	}
+
+	u8 head[4], tail[2];
+	IOVector vectors[] = { IOVector(head, sizeof(head)), IOVector(tail, sizeof(tail)) };
+	u64 position = stream.GetPosition();
+	EXPECT_EQ(sizeof(head) + sizeof(tail), stream.GetFilesystem()->ReadVector(stream.GetHandle(), vectors, 2, 4 + 6 + sizeof(payload)));
+	EXPECT_EQ(position, stream.GetPosition());
+	EXPECT_EQ(1, head[3]);
+	EXPECT_EQ('r', tail[0]);
+	stream.SetPosition(stream.GetLength() - 2);
+	EXPECT_EQ(2, stream.ReadVector(vectors, 2)); }
+
+	Filesystem::GetDefault()->DeleteFile(path);
+
+	// Padding inside a batch counts the bytes it still holds.
+	MemoryStream stream;
+	StreamWriter writer(tempnew stream);
+	writer.BeginBatch();
+	writer.WriteByte(1);
+	writer.PadToMultiple(4);
+	writer.WriteByte(2);
+	EXPECT_EQ(5, writer.GetPosition());
+	EXPECT_EQ(5, writer.GetLength());
+	writer.EndBatch();
+	EXPECT_EQ(5, stream.GetLength());
+	EXPECT_EQ(2, static_cast<const u8*>(stream.GetBuffer())[4]);
+}
+
+TEST(BricksIoNavigatorTest, BufferedReadWriteTest) {
+	String path = "/tmp/libbricks-test.bin";
+	u8 payload[0x40];
+	for (size_t i = 0; i < sizeof(payload); i++)
+		payload[i] = i;
+	{ FileStream stream(path, FileOpenMode::Create, FileMode::ReadWrite, FilePermissions::OwnerReadWrite);
+	StreamWriter writer(tempnew stream, Endian::BigEndian, 0x10);
+	for (int i = 0; i < 10; i++) {
+		writer.WriteInt((u32)i);
+		writer.WriteInt((u16)i, Endian::LittleEndian);
+		writer.WriteByte(0xff);
+	}
+	EXPECT_EQ(70, writer.GetPosition());
+	EXPECT_EQ(70, writer.GetLength());
+	EXPECT_LT(stream.GetLength(), 70);
+	writer.WriteBytes(payload, sizeof(payload));
+	writer.WriteString("ohai");
+	writer.WriteByte('\0');
+	writer.Flush();
+	EXPECT_EQ(70 + sizeof(payload) + 5, stream.GetLength());
+	writer.SetPosition(0);
+	writer.WriteInt((u32)0x1337BAAD); }
+
+	{ FileStream stream(path, FileOpenMode::Open, FileMode::ReadOnly);
+	{	StreamReader reader(tempnew stream, Endian::BigEndian, 0x10);
+		EXPECT_EQ(0x1337BAAD, reader.ReadInt32());
+		for (int i = 0; i < 10; i++) {
+			if (i) {
+				EXPECT_EQ((u32)i, reader.ReadInt32());
+			}
+			EXPECT_EQ((u16)i, reader.ReadInt16(Endian::LittleEndian));
+			EXPECT_EQ(0xff, reader.ReadByte());
+			if (!i)
+				reader.SetPosition(7);
+		}
+		EXPECT_EQ(70, reader.GetPosition());
+		Data data = reader.ReadBytes(sizeof(payload));
+		EXPECT_EQ(0, memcmp(data.GetData(), payload, sizeof(payload)));
+		EXPECT_EQ(0, reader.ReadInt16(Endian::LittleEndian) - ('o' | 'h' << 8));
+		reader.SetPosition(reader.GetPosition() - 2);
+		EXPECT_EQ(String("ohai"), reader.ReadString());
+		EXPECT_TRUE(reader.IsEndOfFile());
+		reader.SetPosition(4);
+		EXPECT_EQ(0, reader.ReadInt16(Endian::LittleEndian));
+		EXPECT_EQ(6, reader.GetPosition()); }
+	EXPECT_EQ(6, stream.GetPosition()); }
+
+	{ FileStream stream(path, FileOpenMode::Create, FileMode::ReadWrite, FilePermissions::OwnerReadWrite);
+	Serializer serializer;
+	AutoPointer<SerializationArray> array = autonew SerializationArray();
+	for (int i = 0; i < 100; i++)
+		array->AddItem(autonew String(String::Format("item %d", i)));
+	serializer.Serialize(tempnew stream, array);
+	serializer.Serialize(tempnew stream, tempnew String("tail"));
+	stream.SetPosition(0);
+	AutoPointer<SerializationArray> result = CastTo<SerializationArray>(serializer.Deserialize(tempnew stream));
+	EXPECT_EQ(100, result->GetCount());
+	EXPECT_EQ(String("item 99"), *CastTo<String>(result->GetItem(99)));
+	EXPECT_EQ(String("tail"), *CastTo<String>(serializer.Deserialize(tempnew stream)));
+
+	// A short write while the buffer is written out still reaches the caller.
+	Substream full(tempnew stream, 0, 4);
+	EXPECT_THROW(serializer.Serialize(tempnew full, tempnew String("does not fit")), StreamException); }
+
+	Filesystem::GetDefault()->DeleteFile(path);
+}
+
+TEST(BricksIoNavigatorTest, ArrayReadWriteTest) {
+	static const int Count = 1001;
+	u16 values16[Count];
+	u32 values32[Count];
+	u64 values64[Count];
+	float floats[Count];
+	for (int i = 0; i < Count; i++) {
+		values16[i] = i * 0x0101 + 1;
+		values32[i] = (u32)i * 0x01020304 + 5;
+		values64[i] = i * 0x0102030405060708ULL + 9;
+		floats[i] = i * 0.5f;
+	}
+
+	for (int buffered = 0; buffered < 2; buffered++) {
+		AutoPointer<MemoryStream> stream = autonew MemoryStream();
+		{	StreamWriter writer(stream, Endian::BigEndian, buffered ? 0x40 : 0);
+			writer.WriteInt16Array(values16, Count);
+			writer.WriteInt32Array<Endian::BigEndian>(values32, Count);
+			writer.WriteInt64Array(values64, Count, Endian::LittleEndian);
+			writer.WriteFloatArray<Endian::BigEndian>(floats, Count);
+			EXPECT_EQ(Count * (2 + 4 + 8 + 4), writer.GetPosition()); }
+		EXPECT_EQ(5u, values32[0]) << "Writing swapped the source array";
+
+		stream->SetPosition(0);
+		StreamReader reader(stream, Endian::BigEndian);
+		EXPECT_EQ(values16[0], reader.ReadInt16());
+		EXPECT_EQ(values16[1], reader.ReadInt16());
+		stream->SetPosition(0);
+		u16 read16[Count];
+		u32 read32[Count];
+		u64 read64[Count];
+		float readFloats[Count];
+		reader.ReadInt16Array<Endian::BigEndian>(read16, Count);
+		reader.ReadInt32Array(read32, Count);
+		reader.ReadInt64Array<Endian::LittleEndian>(read64, Count);
+		reader.ReadFloatArray(readFloats, Count, Endian::BigEndian);
+		EXPECT_EQ(0, memcmp(values16, read16, sizeof(values16)));
+		EXPECT_EQ(0, memcmp(values32, read32, sizeof(values32)));
+		EXPECT_EQ(0, memcmp(values64, read64, sizeof(values64)));
+		EXPECT_EQ(0, memcmp(floats, readFloats, sizeof(floats)));
+		EXPECT_TRUE(reader.IsEndOfFile());
+	}
+
+	u32 swapped[Count];
+	EndianSwapArray32(swapped, values32, Count);
+	for (int i = 0; i < Count; i++) {
+		const u8* source = (const u8*)&values32[i];
+		const u8* dest = (const u8*)&swapped[i];
+		ASSERT_TRUE(dest[0] == source[3] && dest[1] == source[2] && dest[2] == source[1] && dest[3] == source[0]);
+	}
+	EndianSwapArray32(swapped, swapped, Count);
+	EXPECT_EQ(0, memcmp(values32, swapped, sizeof(swapped)));
+}
+
+TEST(BricksIoNavigatorTest, VarIntReadWriteTest) {
+	static const u64 unsignedValues[] = { 0, 1, 0x7f, 0x80, 0x3fff, 0x4000, 0x12345678, 0xffffffffULL, 0x00ffffffffffffffULL, 0x0100000000000000ULL, 0xffffffffffffffffULL };
+	static const s64 signedValues[] = { 0, -1, 1, -64, 64, -0x12345678, 0x7fffffffffffffffLL, -0x7fffffffffffffffLL - 1 };
+	static const u32 vlqValues[] = { 0, 0x40, 0x7f, 0x80, 0x2000, 0x3fff, 0x4000, 0x100000, 0x1fffff, 0x200000, 0x8000000, 0x0fffffff };
+	const int unsignedCount = sizeof(unsignedValues) / sizeof(unsignedValues[0]);
+	const int signedCount = sizeof(signedValues) / sizeof(signedValues[0]);
+	const int vlqCount = sizeof(vlqValues) / sizeof(vlqValues[0]);
+
+	for (int buffered = 0; buffered < 2; buffered++) {
+		AutoPointer<MemoryStream> stream = autonew MemoryStream();
+		{	StreamWriter writer(stream, Endian::BigEndian, buffered ? 0x10 : 0);
+			for (int i = 0; i < unsignedCount; i++)
+				writer.WriteVarUInt(unsignedValues[i]);
+			for (int i = 0; i < signedCount; i++)
+				writer.WriteVarInt(signedValues[i]);
+			for (int i = 0; i < vlqCount; i++)
+				writer.WriteVLQ(vlqValues[i]);
+			EXPECT_THROW(writer.WriteVLQ(0x10000000), InvalidArgumentException); }
+
+		stream->SetPosition(0);
+		StreamReader reader(stream, Endian::BigEndian, buffered ? 0x10 : 0);
+		for (int i = 0; i < unsignedCount; i++)
+			EXPECT_EQ(unsignedValues[i], reader.ReadVarUInt());
+		for (int i = 0; i < signedCount; i++)
+			EXPECT_EQ(signedValues[i], reader.ReadVarInt());
+		for (int i = 0; i < vlqCount; i++)
+			EXPECT_EQ(vlqValues[i], reader.ReadVLQ());
+		EXPECT_TRUE(reader.IsEndOfFile());
+		EXPECT_THROW(reader.ReadVarUInt(), EndOfStreamException);
+	}
+
+	// Known encodings: LEB128 624485 and the MIDI examples from the standard.
+	static const u8 encoded[] = { 0xe5, 0x8e, 0x26, 0x81, 0x80, 0x00, 0xff, 0xff, 0x7f, 0x7f };
+	AutoPointer<MemoryStream> stream = autonew MemoryStream(encoded, sizeof(encoded));
+	StreamReader reader(stream);
+	EXPECT_EQ(624485u, reader.ReadVarUInt());
+	EXPECT_EQ(0x4000u, reader.ReadVLQ());
+	EXPECT_EQ(0x1fffffu, reader.ReadVLQ());
+	EXPECT_EQ(0x7fu, reader.ReadVLQ());
+
+	static const u8 overlong[] = { 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x00 };
+	stream = autonew MemoryStream(overlong, sizeof(overlong));
+	StreamReader overlongReader(stream, Endian::Native, 0x20);
+	EXPECT_THROW(overlongReader.ReadVarUInt(), FormatException);
+	overlongReader.SetPosition(0);
+	EXPECT_THROW(overlongReader.ReadVLQ(), FormatException);
+
+	Serializer serializer(SerializerFormat::Compact);
+	AutoPointer<SerializationArray> array = autonew SerializationArray();
+	for (int i = 0; i < 100; i++)
+		array->AddItem(autonew String(String::Format("item %d", i)));
+	AutoPointer<MemoryStream> compact = autonew MemoryStream();
+	AutoPointer<MemoryStream> fixed = autonew MemoryStream();
+	serializer.Serialize(compact, array);
+	Serializer().Serialize(fixed, array);
+	EXPECT_EQ(fixed->GetLength() - 100 * 3 - 3, compact->GetLength());
+	compact->SetPosition(0);
+	AutoPointer<SerializationArray> result = CastTo<SerializationArray>(serializer.Deserialize(compact));
+	EXPECT_EQ(100, result->GetCount());
+	EXPECT_EQ(String("item 99"), *CastTo<String>(result->GetItem(99)));
+}
+
+class NavigatorTestPoint : public Object
+{
+public:
+	int x, y;
+	NavigatorTestPoint(int x, int y) : x(x), y(y) { }
+};
+
+template<int N>
+class NavigatorTestPointSerializer : public ObjectSerializer<NavigatorTestPoint, N>
+{
+public:
+	void SerializeData(StreamWriter* writer, NavigatorTestPoint* point) const { writer->WriteInt32(point->x); writer->WriteInt32(point->y); }
+	ReturnPointer<NavigatorTestPoint> DeserializeData(StreamReader* reader) const { int x = reader->ReadInt32(); return autonew NavigatorTestPoint(x, reader->ReadInt32()); }
+};
+
+TEST(BricksIoNavigatorTest, SerializerDispatchTest) {
+	Serializer serializer;
+	AutoPointer<IO::Internal::ObjectSerializer> pointSerializer = autonew NavigatorTestPointSerializer<0x2f1c9a07>();
+	serializer.RegisterSerializer(pointSerializer);
+
+	AutoPointer<SerializationArray> array = autonew SerializationArray();
+	for (int i = 0; i < 10; i++) {
+		array->AddItem(autonew NavigatorTestPoint(i, -i));
+		array->AddItem(autonew String("point"));
+	}
+	array->AddItem(NULL);
+	AutoPointer<MemoryStream> stream = autonew MemoryStream();
+	serializer.Serialize(stream, array);
+	stream->SetPosition(0);
+	AutoPointer<SerializationArray> result = CastTo<SerializationArray>(serializer.Deserialize(stream));
+	ASSERT_EQ(21, result->GetCount());
+	EXPECT_EQ(7, CastTo<NavigatorTestPoint>(result->GetItem(14))->x);
+	EXPECT_EQ(-7, CastTo<NavigatorTestPoint>(result->GetItem(14))->y);
+	EXPECT_EQ(String("point"), *CastTo<String>(result->GetItem(15)));
+	EXPECT_FALSE(result->GetItem(20));
+
+	serializer.UnregisterSerializer(pointSerializer);
+	stream->SetPosition(0);
+	EXPECT_THROW(serializer.Deserialize(stream), InvalidArgumentException);
+	EXPECT_THROW(serializer.Serialize(stream, tempnew NavigatorTestPoint(0, 0)), InvalidArgumentException);
+}
+
+TEST(BricksIoNavigatorTest, DISABLED_SerializerDispatchBenchmark) {
+	static const int Count = 1000000;
+	Serializer serializer;
+	// Extra registrations are what made the old identifier scan slow.
+	serializer.RegisterSerializer(autonew NavigatorTestPointSerializer<1>());
+	AutoPointer<SerializationArray> array = autonew SerializationArray();
+	for (int i = 0; i < Count; i++)
+		array->AddItem(autonew NavigatorTestPoint(i, i));
+
+	AutoPointer<MemoryStream> stream = autonew MemoryStream();
+	Time start = Time::GetCurrentTime();
+	serializer.Serialize(stream, array);
+	float serializeTime = (Time::GetCurrentTime() - start).GetTotalSeconds();
+	stream->SetPosition(0);
+	start = Time::GetCurrentTime();
+	AutoPointer<SerializationArray> result = CastTo<SerializationArray>(serializer.Deserialize(stream));
+	float deserializeTime = (Time::GetCurrentTime() - start).GetTotalSeconds();
+	EXPECT_EQ(Count, result->GetCount());
+
+	printf("%d objects: Serialize %.3fs, Deserialize %.3fs\n", Count, serializeTime, deserializeTime);
+}
+
+TEST(BricksIoNavigatorTest, SerializationStreamingTest) {
+	for (int format = 0; format < 2; format++) {
+		Serializer serializer((SerializerFormat::Enum)format);
+		AutoPointer<MemoryStream> stream = autonew MemoryStream();
+		{	SerializationWriter writer(tempnew serializer, stream);
+			writer.SetChunkLimits(7, 0x1000);
+			writer.BeginDictionary(3);
+			writer.WriteKey("name");
+			writer.WriteValue(tempnew String("stream"));
+			writer.WriteKey("items");
+			writer.BeginArray();
+			for (int i = 0; i < 1000; i++)
+				writer.WriteValue(tempnew Value(i));
+			EXPECT_THROW(writer.EndDictionary(), InvalidOperationException);
+			writer.EndArray();
+			EXPECT_THROW(writer.WriteValue(NULL), InvalidOperationException);
+			writer.WriteKey("nested");
+			writer.BeginArray(2);
+			writer.BeginArray();
+			writer.EndArray();
+			writer.BeginArray();
+			writer.BeginDictionary(0);
+			writer.EndDictionary();
+			writer.WriteValue(NULL);
+			writer.EndArray();
+			EXPECT_THROW(writer.WriteValue(NULL), InvalidOperationException);
+			writer.EndArray();
+			writer.EndDictionary();
+			EXPECT_EQ(0, writer.GetDepth()); }
+
+		stream->SetPosition(0);
+		AutoPointer<SerializationDictionary> result = CastTo<SerializationDictionary>(serializer.Deserialize(stream));
+		EXPECT_EQ(String("stream"), *CastTo<String>(result->GetItem("name")));
+		AutoPointer<SerializationArray> items = CastTo<SerializationArray>(result->GetItem("items"));
+		ASSERT_EQ(1000, items->GetCount());
+		EXPECT_EQ(999, CastTo<Value>(items->GetItem(999))->GetIntValue());
+		AutoPointer<SerializationArray> nested = CastTo<SerializationArray>(result->GetItem("nested"));
+		ASSERT_EQ(2, nested->GetCount());
+		EXPECT_EQ(0, CastTo<SerializationArray>(nested->GetItem(0))->GetCount());
+		EXPECT_EQ(2, CastTo<SerializationArray>(nested->GetItem(1))->GetCount());
+		EXPECT_TRUE(stream->GetPosition() == stream->GetLength());
+
+		stream->SetPosition(0);
+		SerializationReader reader(tempnew serializer, stream);
+		EXPECT_EQ(SerializationEvent::BeginDictionary, reader.Next());
+		EXPECT_EQ(3, reader.GetCount());
+		int sum = 0;
+		while (reader.Next() == SerializationEvent::Key) {
+			String key = reader.GetKey();
+			SerializationEvent::Enum event = reader.Next();
+			if (key == "name") {
+				EXPECT_EQ(SerializationEvent::Value, event);
+				EXPECT_EQ(String("stream"), *CastTo<String>(reader.GetValue()));
+			} else if (key == "items") {
+				EXPECT_EQ(SerializationEvent::BeginArray, event);
+				EXPECT_EQ(-1, reader.GetCount());
+				while (reader.Next() == SerializationEvent::Value)
+					sum += CastTo<Value>(reader.GetValue())->GetIntValue();
+				EXPECT_EQ(SerializationEvent::EndArray, reader.GetEvent());
+			} else {
+				EXPECT_EQ(SerializationEvent::BeginArray, event);
+				EXPECT_EQ(2, reader.GetCount());
+				reader.Skip();
+				EXPECT_EQ(SerializationEvent::EndArray, reader.GetEvent());
+				EXPECT_EQ(1, reader.GetDepth());
+			}
+		}
+		EXPECT_EQ(SerializationEvent::EndDictionary, reader.GetEvent());
+		EXPECT_EQ(SerializationEvent::End, reader.Next());
+		EXPECT_EQ(999 * 1000 / 2, sum);
+
+		// Graphs written by Serializer read the same way.
+		stream = autonew MemoryStream();
+		serializer.Serialize(stream, result);
+		stream->SetPosition(0);
+		SerializationReader objectReader(tempnew serializer, stream);
+		objectReader.Next();
+		AutoPointer<SerializationDictionary> copy = CastTo<SerializationDictionary>(objectReader.ReadObject());
+		EXPECT_EQ(1000, CastTo<SerializationArray>(copy->GetItem("items"))->GetCount());
+		EXPECT_EQ(SerializationEvent::End, objectReader.Next());
+	}
+}
+
+TEST(BricksIoNavigatorTest, SerializationNestedChunkTest) {
+	Serializer serializer;
+	AutoPointer<MemoryStream> stream = autonew MemoryStream();
+	{	SerializationWriter writer(tempnew serializer, stream);
+		writer.SetChunkLimits(4, 0x1000);
+		writer.BeginArray();
+		writer.WriteValue(tempnew Value(-1));
+		for (int i = 0; i < 3; i++) {
+			writer.BeginDictionary(1);
+			writer.WriteKey("rows");
+			writer.BeginArray();
+			for (int j = 0; j < 100; j++)
+				writer.WriteValue(tempnew Value(i * 100 + j));
+			// The inner array's chunks are not held back by the outer one.
+			writer.Flush();
+			EXPECT_GT(stream->GetLength(), (u64)(i * 100 + 96));
+			writer.EndArray();
+			writer.EndDictionary();
+		}
+		writer.BeginArray();
+		writer.BeginArray();
+		writer.WriteValue(tempnew Value(300));
+		writer.EndArray();
+		writer.EndArray();
+		writer.EndArray();
+		writer.Flush(); }
+
+	stream->SetPosition(0);
+	AutoPointer<SerializationArray> result = CastTo<SerializationArray>(serializer.Deserialize(stream));
+	ASSERT_EQ(5, result->GetCount());
+	EXPECT_EQ(-1, CastTo<Value>(result->GetItem(0))->GetIntValue());
+	for (int i = 0; i < 3; i++) {
+		AutoPointer<SerializationArray> rows = CastTo<SerializationArray>(CastTo<SerializationDictionary>(result->GetItem(i + 1))->GetItem("rows"));
+		ASSERT_EQ(100, rows->GetCount());
+		EXPECT_EQ(i * 100 + 99, CastTo<Value>(rows->GetItem(99))->GetIntValue());
+	}
+	AutoPointer<SerializationArray> inner = CastTo<SerializationArray>(CastTo<SerializationArray>(result->GetItem(4))->GetItem(0));
+	EXPECT_EQ(300, CastTo<Value>(inner->GetItem(0))->GetIntValue());
+	EXPECT_TRUE(stream->GetPosition() == stream->GetLength());
+}
+
+TEST(BricksIoNavigatorTest, SerializerReferenceTest) {
+	AutoPointer<SerializationDictionary> shared = autonew SerializationDictionary();
+	shared->Add("payload", autonew Data(0x100));
+	AutoPointer<String> label = autonew String("label");
+	AutoPointer<SerializationArray> root = autonew SerializationArray();
+	for (int i = 0; i < 50; i++) {
+		AutoPointer<SerializationDictionary> item = autonew SerializationDictionary();
+		item->Add("shared", shared);
+		item->Add("label", label);
+		item->Add("copy", autonew String("label"));
+		root->AddItem(item);
+	}
+	root->AddItem(NULL);
+
+	Serializer plain;
+	Serializer preserving;
+	preserving.SetPreserveReferences(true);
+	AutoPointer<MemoryStream> plainStream = autonew MemoryStream();
+	AutoPointer<MemoryStream> stream = autonew MemoryStream();
+	plain.Serialize(plainStream, root);
+	preserving.Serialize(stream, root);
+	preserving.Serialize(stream, root);
+	// Both graphs together still take well under half the plain output.
+	EXPECT_LT(stream->GetLength() * 2, plainStream->GetLength());
+
+	stream->SetPosition(0);
+	for (int pass = 0; pass < 2; pass++) {
+		AutoPointer<SerializationArray> result = CastTo<SerializationArray>(preserving.Deserialize(stream));
+		ASSERT_EQ(51, result->GetCount());
+		AutoPointer<SerializationDictionary> first = CastTo<SerializationDictionary>(result->GetItem(0));
+		AutoPointer<SerializationDictionary> last = CastTo<SerializationDictionary>(result->GetItem(49));
+		EXPECT_NE(first.GetValue(), last.GetValue());
+		EXPECT_EQ(first->GetItem("shared").GetValue(), last->GetItem("shared").GetValue());
+		EXPECT_EQ(first->GetItem("label").GetValue(), last->GetItem("label").GetValue());
+		EXPECT_NE(first->GetItem("copy").GetValue(), last->GetItem("copy").GetValue());
+		EXPECT_NE(first->GetItem("label").GetValue(), first->GetItem("copy").GetValue());
+		EXPECT_EQ(0x100, CastTo<Data>(CastTo<SerializationDictionary>(last->GetItem("shared"))->GetItem("payload"))->GetSize());
+		EXPECT_FALSE(result->GetItem(50));
+	}
+
+	AutoPointer<SerializationArray> cycle = autonew SerializationArray();
+	cycle->AddItem(root);
+	root->AddItem(cycle);
+	EXPECT_THROW(preserving.Serialize(stream, cycle), InvalidArgumentException);
+	root->RemoveItemAt(root->GetCount() - 1);
+	EXPECT_EQ(51, root->GetCount());
+	EXPECT_THROW(SerializationWriter(tempnew preserving, stream), NotSupportedException);
+}
+
+TEST(BricksIoNavigatorTest, SerializationViewTest) {
+	AutoPointer<SerializationDictionary> root = autonew SerializationDictionary();
+	AutoPointer<SerializationArray> items = autonew SerializationArray();
+	for (int i = 0; i < 100; i++) {
+		AutoPointer<SerializationDictionary> item = autonew SerializationDictionary();
+		item->Add("name", autonew String(String::Format("item %d", i)));
+		item->Add("index", autonew Value(i));
+		item->Add("weight", autonew Value(i * 0.25));
+		items->AddItem(item);
+	}
+	items->AddItem(NULL);
+	root->Add("items", items);
+	root->Add("blob", autonew Data("\x01\x02\x03", 3));
+	root->Add("", autonew String("empty key"));
+	root->Add("flag", autonew Value(true));
+
+	SerializationViewWriter writer;
+	AutoPointer<Data> data = writer.Write(root);
+	SerializationView view(data);
+	SerializationNode node = view.GetRoot();
+	ASSERT_EQ(SerializationNodeType::Dictionary, node.GetType());
+	EXPECT_EQ(4, node.GetCount());
+	EXPECT_EQ(String(""), node.GetKey(0).GetString());
+	EXPECT_EQ(String("empty key"), node.Find("").GetString());
+	EXPECT_TRUE(node.Find("missing").IsNull());
+	EXPECT_TRUE(node.Find("flag").GetValue().GetBooleanValue());
+	Data blob = node.Find("blob").GetData();
+	ASSERT_EQ(3, blob.GetSize());
+	EXPECT_EQ(3, blob[2]);
+
+	SerializationNode array = node.Find("items");
+	ASSERT_EQ(101, array.GetCount());
+	EXPECT_TRUE(array.GetItem(100).IsNull());
+	SerializationNode item = array.GetItem(42);
+	EXPECT_STREQ("item 42", item.Find("name").GetCString());
+	EXPECT_EQ(ValueType::Int32, item.Find("index").GetValueType());
+	EXPECT_EQ(42, item.Find("index").GetValue().GetIntValue());
+	EXPECT_EQ(10.5, item.Find("weight").GetValue().GetFloat64Value());
+	EXPECT_THROW(item.GetItem(0), InvalidOperationException);
+	EXPECT_THROW(array.GetItem(101), InvalidArgumentException);
+	// Keys are shared between the items rather than stored again.
+	EXPECT_EQ(item.GetKey(0).GetCString(), array.GetItem(7).GetKey(0).GetCString());
+
+	AutoPointer<SerializationDictionary> copy = CastTo<SerializationDictionary>(node.ToObject());
+	EXPECT_EQ(String("item 99"), *CastTo<String>(CastTo<SerializationDictionary>(CastTo<SerializationArray>(copy->GetItem("items"))->GetItem(99))->GetItem("name")));
+
+	String path = "/tmp/libbricks-test-view.bin";
+	{ FileStream stream(path, FileOpenMode::Create, FileMode::WriteOnly, FilePermissions::OwnerReadWrite);
+	writer.Write(tempnew stream, root); }
+	{ AutoPointer<Filesystem> filesystem = Filesystem::GetDefault();
+	FileHandle handle = filesystem->Open(path, FileOpenMode::Open, FileMode::ReadOnly);
+	AutoPointer<FileMapping> mapping = autonew FileMapping(filesystem, handle, false);
+	mapping->Map(filesystem->FileStat(handle).GetSize());
+	{ SerializationView mapped(mapping);
+	EXPECT_EQ(view.GetSize(), mapped.GetSize());
+	EXPECT_STREQ("item 3", mapped.GetRoot().Find("items").GetItem(3).Find("name").GetCString()); }
+	mapping->Unmap();
+	filesystem->Close(handle); }
+	Filesystem::GetDefault()->DeleteFile(path);
+
+	u8* corrupt = (u8*)data->GetData();
+	corrupt[SerializationView::HeaderSize - sizeof(u32)] = 0xff;
+	EXPECT_THROW(SerializationView(data->GetData(), data->GetSize()), FormatException);
+
+	// An inner array pointing back at the outer one must not be followed around the loop.
+	AutoPointer<SerializationArray> inner = autonew SerializationArray();
+	inner->AddItem(NULL);
+	AutoPointer<SerializationArray> outer = autonew SerializationArray();
+	outer->AddItem(inner);
+	AutoPointer<Data> cyclic = writer.Write(outer);
+	u8* bytes = (u8*)cyclic->GetData();
+	u32 outerOffset = EndianConvertLE32(bytes + sizeof(u32) * 2);
+	u32 innerOffset = EndianConvertLE32(bytes + outerOffset + sizeof(u32) * 2);
+	EndianConvertLE32(bytes + innerOffset + sizeof(u32) * 2, outerOffset);
+	SerializationView cyclicView(cyclic);
+	EXPECT_THROW(cyclicView.GetRoot().GetItem(0).GetItem(0), FormatException);
+	EXPECT_THROW(cyclicView.GetRoot().ToObject(), FormatException);
+}
+
+TEST(BricksIoNavigatorTest, DISABLED_ArrayReadBenchmark) {
+	static const int Count = 0x1000000;
+	u32* values = new u32[Count];
+	for (int i = 0; i < Count; i++)
+		values[i] = i;
+	AutoPointer<MemoryStream> stream = autonew MemoryStream(values, Count * sizeof(u32));
+	StreamReader reader(stream, Endian::BigEndian);
+
+	Time start = Time::GetCurrentTime();
+	u32 sum = 0;
+	for (int i = 0; i < Count; i++)
+		sum += reader.ReadInt32();
+	float singleTime = (Time::GetCurrentTime() - start).GetTotalSeconds();
+
+	stream->SetPosition(0);
+	start = Time::GetCurrentTime();
+	reader.ReadInt32Array<Endian::BigEndian>(values, Count);
+	float arrayTime = (Time::GetCurrentTime() - start).GetTotalSeconds();
+	for (int i = 0; i < Count; i++)
+		sum -= values[i];
+	EXPECT_EQ(0, sum);
+
+	printf("%d big endian u32s: ReadInt32 %.3fs, ReadInt32Array %.3fs\n", Count, singleTime, arrayTime);
+	delete[] values;
+}
+
 int main(int argc, char* argv[])
 {
 	testing::InitGoogleTest(&argc, argv);
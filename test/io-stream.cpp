@@ -4,8 +4,18 @@
 #include <bricks/io/memorystream.h>
 #include <bricks/io/cachestream.h>
 #include <bricks/io/substream.h>
+#include <bricks/io/mappedarray.h>
+#include <bricks/io/mappedfilestream.h>
+#include <bricks/io/asyncfilesystem.h>
+#include <bricks/io/streamwriter.h>
+#include <bricks/io/serializer.h>
+#include <bricks/collections/autoarray.h>
+#include <bricks/core/random.h>
+#include <bricks/core/time.h>
+#include <bricks/core/timespan.h>
 
 using namespace Bricks;
+using namespace Bricks::Collections;
 using namespace Bricks::IO;
 
 TEST(BricksIoStreamTest, NonExistentFile) {
@@ -71,6 +81,44 @@ TEST(BricksIoStreamTest, WriteReadSubstreamTest) {
 	Filesystem::GetDefault()->DeleteFile(path);
 }
 
+TEST(BricksIoStreamTest, PositionalSubstreamTest) {
+	String path = "/tmp/libbricks-test.bin";
+	{
+		FileStream stream(path, FileOpenMode::Create, FileMode::ReadWrite, FilePermissions::OwnerReadWrite);
+		u8 bytes[0x100];
+		for (int i = 0; i < 0x100; i++)
+			bytes[i] = i;
+		EXPECT_EQ(0x100, stream.Write(bytes, sizeof(bytes)));
+		EXPECT_EQ(4, stream.WriteAt(0x10, "test", 4));
+		EXPECT_EQ(0x100, stream.GetPosition());
+
+		stream.SetPosition(0x20);
+		Substream first(tempnew stream, 0x10, 0x40);
+		Substream second(tempnew stream, 0x80, 0x40);
+		u8 buffer[0x40];
+		EXPECT_EQ(4, first.Read(buffer, 4));
+		EXPECT_EQ(0, memcmp(buffer, "test", 4));
+		EXPECT_EQ(0x10, second.Read(buffer, 0x10));
+		EXPECT_EQ(0x80, buffer[0]);
+		EXPECT_EQ(4, first.Read(buffer, 4));
+		EXPECT_EQ(0x14, buffer[0]);
+		EXPECT_EQ(0x20, stream.GetPosition());
+
+		EXPECT_EQ(0x10, second.ReadAt(0x30, buffer, 0x20));
+		EXPECT_EQ(0xb0, buffer[0]);
+		EXPECT_EQ(0, second.ReadAt(0x40, buffer, 1));
+		EXPECT_EQ(0, first.WriteAt(0x40, buffer, 1));
+		EXPECT_EQ(0x10, second.GetPosition());
+
+		MemoryStream memory(bytes, sizeof(bytes));
+		EXPECT_EQ(2, memory.ReadAt(0xfe, buffer, 4));
+		EXPECT_EQ(0xfe, buffer[0]);
+		EXPECT_EQ(0, memory.GetPosition());
+	}
+
+	Filesystem::GetDefault()->DeleteFile(path);
+}
+
 TEST(BricksIoStreamTest, WriteReadCacheStreamTest) {
 	String path = "/tmp/libbricks-test.bin";
 	{
@@ -87,6 +135,142 @@ TEST(BricksIoStreamTest, WriteReadCacheStreamTest) {
 	Filesystem::GetDefault()->DeleteFile(path);
 }
 
+TEST(BricksIoStreamTest, CacheStreamPagesTest) {
+	AutoPointer<MemoryStream> memory = autonew MemoryStream();
+	{
+		CacheStream stream(memory, 0x100, 4);
+		u8 data[0x1000];
+		for (size_t i = 0; i < sizeof(data); i++)
+			data[i] = i * 7;
+		EXPECT_EQ(sizeof(data), stream.Write(data, sizeof(data)));
+		EXPECT_EQ(sizeof(data), stream.GetLength());
+		EXPECT_GT(memory->GetLength(), 0);
+
+		stream.SetPosition(0x230);
+		u8 value = 0xFF;
+		stream.Write(&value, 1);
+		stream.Flush();
+		EXPECT_EQ(sizeof(data), memory->GetLength());
+
+		stream.ResetStatistics();
+		u8 buffer[0x10];
+		for (int i = 0; i < 8; i++) {
+			stream.SetPosition((i * 5 % 8) * 0x200 + 3);
+			EXPECT_EQ(sizeof(buffer), stream.Read(buffer, sizeof(buffer)));
+			EXPECT_EQ((u8)(((i * 5 % 8) * 0x200 + 3) * 7), buffer[0]);
+		}
+		EXPECT_EQ(8, stream.GetStatistics().misses);
+
+		stream.SetPosition(0);
+		stream.ResetStatistics();
+		EXPECT_EQ(sizeof(data), stream.Read(data, sizeof(data)));
+		EXPECT_EQ(0xFF, data[0x230]);
+		EXPECT_EQ((u8)(0x231 * 7), data[0x231]);
+		EXPECT_GT(stream.GetStatistics().hits, stream.GetStatistics().misses);
+		EXPECT_EQ(0, stream.Read(data, 1));
+
+		stream.SetPosition(0x1010);
+		stream.Write(&value, 1);
+	}
+	EXPECT_EQ(0x1011, memory->GetLength());
+}
+
+TEST(BricksIoStreamTest, CacheStreamSetLengthTest) {
+	AutoPointer<MemoryStream> memory = autonew MemoryStream();
+	memory->Write("0123456789", 10);
+	CacheStream stream(memory, 0x100, 4);
+	stream.SetPosition(0);
+	u8 buffer[4];
+	EXPECT_EQ(4, stream.Read(buffer, 4));
+
+	// The cached page grows with the stream and reads back the zeroes it was extended with.
+	stream.SetLength(100);
+	stream.SetPosition(50);
+	memset(buffer, 0xFF, sizeof(buffer));
+	EXPECT_EQ(4, stream.Read(buffer, 4));
+	EXPECT_EQ(0, buffer[0]);
+	stream.SetPosition(8);
+	EXPECT_EQ(4, stream.Read(buffer, 4));
+	EXPECT_EQ('9', buffer[1]);
+	EXPECT_EQ(0, buffer[2]);
+}
+
+TEST(BricksIoStreamTest, WriteReadMappedFileStreamTest) {
+	String path = "/tmp/libbricks-test.bin";
+	{
+		MappedFileStream stream(path, FileOpenMode::Create, FileMode::ReadWrite);
+		WriteTest(tempnew stream);
+		EXPECT_EQ(8, stream.GetLength());
+		EXPECT_GE(stream.GetMapping()->GetLength(), 8);
+		stream.SetPosition(0);
+		ReadTest(tempnew stream);
+
+		u8 block[0x1000] = { 0x5A };
+		stream.SetPosition(0x10000);
+		for (int i = 0; i < 0x200; i++)
+			stream.Write(block, sizeof(block));
+		EXPECT_EQ(0x10000 + 0x200000, stream.GetLength());
+		EXPECT_EQ(0, stream.GetData()[0x100]);
+		EXPECT_EQ(0x5A, stream.GetData()[0x10000]);
+		stream.Flush();
+		stream.SetLength(8);
+	}
+	EXPECT_EQ(8, Filesystem::GetDefault()->Stat(path).GetSize());
+
+	{
+		MappedFileStream stream(path);
+		stream.Advise(MappingAdvice::Sequential);
+		ReadTest(tempnew stream);
+		u8 buffer[1];
+		EXPECT_EQ(0, stream.Read(buffer, 1));
+		EXPECT_FALSE(stream.CanWrite());
+	}
+
+	{
+		MappedFileStream stream(path, FileOpenMode::Open, FileMode::WriteOnly);
+		stream.SetPosition(8);
+		WriteTest(tempnew stream);
+		EXPECT_EQ(16, stream.GetLength());
+	}
+	EXPECT_EQ(16, Filesystem::GetDefault()->Stat(path).GetSize());
+
+	Filesystem::GetDefault()->DeleteFile(path);
+}
+
+TEST(BricksIoStreamTest, MappedArrayTest) {
+	String path = "/tmp/libbricks-mapped.bin";
+	{
+		MappedArray<s32> array(path, FileOpenMode::Create);
+		EXPECT_EQ(0, array.GetCount());
+		for (s32 i = 0; i < 1000; i++)
+			array.AddItem(999 - i);
+		EXPECT_GE(array.GetCapacity(), 1000);
+		array.Advise(MappingAdvice::Random);
+		array.Sort();
+		EXPECT_EQ(0, array[0]);
+		EXPECT_EQ(999, array[999]);
+		EXPECT_EQ(500, array.BinarySearch(500));
+		EXPECT_EQ(-1, array.BinarySearch(1000));
+		array.RemoveItemAt(0);
+		array.InsertItem(0, -1);
+		EXPECT_TRUE(array.ContainsItem(-1));
+		array.Flush();
+	}
+	EXPECT_EQ(1000 * sizeof(s32), Filesystem::GetDefault()->Stat(path).GetSize());
+
+	{
+		MappedArray<s32> array(path, FileOpenMode::Open, FileMode::ReadOnly);
+		ASSERT_EQ(1000, array.GetCount());
+		EXPECT_EQ(-1, array[0]);
+		EXPECT_EQ(998, array.IndexOfItem(998));
+		EXPECT_THROW(array.AddItem(0), NotSupportedException);
+		EXPECT_THROW(array.SetItem(0, 0), NotSupportedException);
+		EXPECT_EQ(-1, array[0]);
+	}
+
+	Filesystem::GetDefault()->DeleteFile(path);
+}
+
 TEST(BricksIoStreamTest, WriteReadMemoryStreamTest) {
 	{
 		MemoryStream stream;
@@ -96,6 +280,182 @@ TEST(BricksIoStreamTest, WriteReadMemoryStreamTest) {
 	}
 }
 
+TEST(BricksIoStreamTest, ChunkedMemoryStreamTest) {
+	MemoryStream stream(MemoryStreamMode::Chunked);
+	WriteTest(tempnew stream);
+	stream.SetPosition(0);
+	ReadTest(tempnew stream);
+
+	u8 bytes[0x3000];
+	for (size_t i = 0; i < sizeof(bytes); i++)
+		bytes[i] = i * 7;
+	stream.SetLength(0);
+	stream.SetPosition(0);
+	for (size_t i = 0; i < sizeof(bytes); i += 0x300)
+		EXPECT_EQ(0x300, stream.Write(bytes + i, 0x300));
+	EXPECT_EQ(sizeof(bytes), stream.GetLength());
+
+	u8 buffer[0x3000];
+	EXPECT_EQ(0x800, stream.ReadAt(0x300, buffer, 0x800));
+	EXPECT_EQ(0, memcmp(bytes + 0x300, buffer, 0x800));
+	stream.SetPosition(0x3ff);
+	EXPECT_EQ(bytes[0x3ff], stream.ReadByte());
+	EXPECT_EQ(bytes[0x400], stream.ReadByte());
+
+	MemoryStream copy(stream);
+	EXPECT_EQ(0x401, copy.GetPosition());
+	EXPECT_EQ(sizeof(bytes), copy.ReadAt(0, buffer, sizeof(buffer)));
+	EXPECT_EQ(0, memcmp(bytes, buffer, sizeof(bytes)));
+
+	EXPECT_EQ(0, memcmp(bytes, stream.GetBuffer(), sizeof(bytes)));
+	AutoPointer<Data> data = stream.Detach();
+	EXPECT_EQ(sizeof(bytes), data->GetSize());
+	EXPECT_EQ(0, memcmp(bytes, data->GetData(), sizeof(bytes)));
+	EXPECT_EQ(0, stream.GetLength());
+	EXPECT_EQ(-1, stream.ReadByte());
+
+	MemoryStream contiguous(bytes, sizeof(bytes));
+	const void* buffered = contiguous.GetBuffer();
+	data = contiguous.Detach();
+	EXPECT_EQ(buffered, data->GetData());
+}
+
+TEST(BricksIoStreamTest, DISABLED_MemoryStreamBenchmark) {
+	static const int TotalSize = 100 * 1024 * 1024;
+	static const int BlockSize = 0x1000;
+	u8 block[BlockSize];
+	memset(block, 0x5a, sizeof(block));
+
+	MemoryStreamMode::Enum modes[] = { MemoryStreamMode::Contiguous, MemoryStreamMode::Chunked };
+	for (int m = 0; m < 2; m++) {
+		const char* name = modes[m] == MemoryStreamMode::Contiguous ? "contiguous" : "chunked";
+
+		Time start = Time::GetCurrentTime();
+		{
+			MemoryStream stream(modes[m]);
+			for (int i = 0; i < TotalSize; i += BlockSize)
+				stream.Write(block, BlockSize);
+			AutoPointer<Data> data = stream.Detach();
+		}
+		printf("%s: 100 MiB in 4 KiB writes %.3fs\n", name, (Time::GetCurrentTime() - start).GetTotalSeconds());
+
+		Serializer serializer;
+		AutoPointer<SerializationArray> array = autonew SerializationArray();
+		for (int i = 0; i < 100000; i++)
+			array->AddItem(autonew String(String::Format("item %d", i)));
+		start = Time::GetCurrentTime();
+		{
+			MemoryStream stream(modes[m]);
+			for (int i = 0; i < 20; i++)
+				serializer.Serialize(tempnew stream, array);
+		}
+		printf("%s: serializer output %.3fs\n", name, (Time::GetCurrentTime() - start).GetTotalSeconds());
+	}
+}
+
+struct BricksIoStreamTestAsyncCounter
+{
+	volatile int* count;
+	BricksIoStreamTestAsyncCounter(volatile int* count) : count(count) { }
+
+	void operator()(AsyncRequest* request) const { if (request->GetResult() == request->GetSize()) __sync_fetch_and_add(count, 1); }
+};
+
+static void BricksIoStreamTestAsyncFilesystem(AsyncEngine::Enum engine)
+{
+	static const int BlockSize = 0x1000;
+	static const int BlockCount = 32;
+	String path = "/tmp/libbricks-test-async.bin";
+	{
+		AutoPointer<FileStream> stream = autonew FileStream(path, FileOpenMode::Create, FileMode::ReadWrite, FilePermissions::OwnerReadWrite);
+		AutoPointer<AsyncFilesystem> filesystem = autonew AsyncFilesystem(NULL, 8, engine);
+		EXPECT_EQ(engine, filesystem->GetEngine());
+		AsyncStream async(stream, filesystem);
+
+		u8 blocks[BlockCount][BlockSize];
+		for (int i = 0; i < BlockCount; i++)
+			memset(blocks[i], i, BlockSize);
+
+		volatile int written = 0;
+		AutoArray<AsyncRequest> requests;
+		filesystem->BeginBatch();
+		for (int i = 0; i < BlockCount; i++)
+			requests.AddItem(async.Write(blocks[i], BlockSize, BricksIoStreamTestAsyncCounter(&written)));
+		EXPECT_EQ(BlockCount * BlockSize, async.GetPosition());
+		filesystem->EndBatch();
+		foreach (AsyncRequest* request, requests)
+			EXPECT_EQ(BlockSize, request->Wait());
+		EXPECT_EQ(BlockCount, written);
+		EXPECT_EQ(BlockCount * BlockSize, stream->GetLength());
+		requests.Clear();
+
+		u8 buffer[BlockCount][BlockSize];
+		for (int i = BlockCount - 1; i >= 0; i--)
+			requests.AddItem(async.ReadAt((u64)i * BlockSize, buffer[i], BlockSize));
+		foreach (AsyncRequest* request, requests)
+			EXPECT_EQ(BlockSize, request->Wait());
+		EXPECT_EQ(0, memcmp(blocks, buffer, sizeof(buffer)));
+
+		AutoPointer<AsyncRequest> request = filesystem->Read(stream->GetHandle(), buffer[0], BlockSize, (u64)BlockCount * BlockSize);
+		EXPECT_EQ(0, request->Wait());
+
+		request = filesystem->Read(-1, buffer[0], BlockSize, 0);
+		EXPECT_THROW(request->Wait(), ErrnoException);
+		EXPECT_EQ(EBADF, request->GetError());
+	}
+	Filesystem::GetDefault()->DeleteFile(path);
+}
+
+TEST(BricksIoStreamTest, AsyncFilesystemThreads) {
+	BricksIoStreamTestAsyncFilesystem(AsyncEngine::Threads);
+}
+
+TEST(BricksIoStreamTest, AsyncFilesystemUring) {
+	if (!AsyncFilesystem::IsUringSupported())
+		return;
+	BricksIoStreamTestAsyncFilesystem(AsyncEngine::Uring);
+}
+
+TEST(BricksIoStreamTest, DISABLED_AsyncFilesystemBenchmark) {
+	static const int BlockSize = 0x1000;
+	static const u64 FileSize = 0x10000000;
+	static const int ReadCount = 0x10000;
+	String path = "/tmp/libbricks-test-async-benchmark.bin";
+	{
+		FileStream stream(path, FileOpenMode::Create, FileMode::ReadWrite, FilePermissions::OwnerReadWrite);
+		stream.SetLength(FileSize);
+
+		AsyncEngine::Enum engines[] = { AsyncEngine::Uring, AsyncEngine::Threads };
+		for (int e = 0; e < 2; e++) {
+			if (engines[e] == AsyncEngine::Uring && !AsyncFilesystem::IsUringSupported())
+				continue;
+			for (int depth = 1; depth <= 64; depth *= 2) {
+				AutoPointer<AsyncFilesystem> filesystem = autonew AsyncFilesystem(NULL, depth, engines[e]);
+				u8* buffers = new u8[depth * BlockSize];
+				AutoArray<AsyncRequest> requests;
+				Random random(depth);
+				Time start = Time::GetCurrentTime();
+				for (int i = 0; i < ReadCount; i++) {
+					int slot = i % depth;
+					u64 offset = (u64)random.Generate(0, FileSize / BlockSize - 1) * BlockSize;
+					if (requests.GetCount() < depth)
+						requests.AddItem(filesystem->Read(stream.GetHandle(), buffers + slot * BlockSize, BlockSize, offset));
+					else {
+						requests[slot]->Wait();
+						requests.SetItem(slot, filesystem->Read(stream.GetHandle(), buffers + slot * BlockSize, BlockSize, offset));
+					}
+				}
+				foreach (AsyncRequest* request, requests)
+					request->Wait();
+				float seconds = (Time::GetCurrentTime() - start).GetTotalSeconds();
+				printf("%s QD %d: %d random 4 KiB reads in %.3fs, %.0f IOPS\n", engines[e] == AsyncEngine::Uring ? "io_uring" : "threads", depth, ReadCount, seconds, ReadCount / seconds);
+				delete[] buffers;
+			}
+		}
+	}
+	Filesystem::GetDefault()->DeleteFile(path);
+}
+
 int main(int argc, char* argv[])
 {
 	testing::InitGoogleTest(&argc, argv);
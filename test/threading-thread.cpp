@@ -6,11 +6,15 @@
 #include <bricks/threading/monitor.h>
 #include <bricks/threading/taskqueue.h>
 #include <bricks/threading/task.h>
+#include <bricks/threading/parallelsort.h>
+#include <bricks/collections/autoarray.h>
+#include <bricks/core/random.h>
 #include <bricks/core/timespan.h>
 #include <bricks/core/value.h>
 
 using namespace Bricks;
 using namespace Bricks::Threading;
+using namespace Bricks::Collections;
 
 struct BricksThreadingThreadTestBasicFunctor
 {
@@ -198,6 +202,63 @@ TEST(BricksThreadingThreadTest, TaskSync) {
 	EXPECT_EQ(400, task->Wait());
 }
 
+struct BricksThreadingThreadTestParallelSortItem
+{
+	int key;
+	int order;
+	// No default constructor, which the parallel sort must not need.
+	BricksThreadingThreadTestParallelSortItem(int key, int order) : key(key), order(order) { }
+};
+
+class BricksThreadingThreadTestParallelSortComparison : public ValueComparison<BricksThreadingThreadTestParallelSortItem>
+{
+public:
+	ComparisonResult::Enum Compare(const BricksThreadingThreadTestParallelSortItem& v1, const BricksThreadingThreadTestParallelSortItem& v2) {
+		if (v1.key < v2.key)
+			return ComparisonResult::Less;
+		return v1.key > v2.key ? ComparisonResult::Greater : ComparisonResult::Equal;
+	}
+};
+
+TEST(BricksThreadingThreadTest, ParallelSort) {
+	Random random(1337);
+	Array<int> array;
+	Array<int> expected;
+	for (int i = 0; i < 200000; i++) {
+		int value = random.Generate(-100000, 100000);
+		array.AddItem(value);
+		expected.AddItem(value);
+	}
+
+	AutoPointer<TaskQueue> queue = autonew TaskQueue(4);
+	queue->Start();
+	ParallelSort(tempnew array, queue);
+	expected.Sort();
+	for (int i = 0; i < expected.GetCount(); i++)
+		ASSERT_EQ(expected[i], array[i]);
+
+	// The queue keeps its workers after draining, so it can be reused.
+	ParallelSort(tempnew array, queue);
+	for (int i = 0; i < expected.GetCount(); i++)
+		ASSERT_EQ(expected[i], array[i]);
+	queue->Stop(true);
+}
+
+TEST(BricksThreadingThreadTest, ParallelStableSort) {
+	Random random(1337);
+	Array<BricksThreadingThreadTestParallelSortItem> array;
+	for (int i = 0; i < 100000; i++)
+		array.AddItem(BricksThreadingThreadTestParallelSortItem(random.Generate(0, 100), i));
+
+	ParallelStableSort(tempnew array, NULL, tempnew BricksThreadingThreadTestParallelSortComparison());
+	for (int i = 1; i < array.GetCount(); i++) {
+		ASSERT_LE(array[i - 1].key, array[i].key);
+		if (array[i - 1].key == array[i].key) {
+			ASSERT_LT(array[i - 1].order, array[i].order);
+		}
+	}
+}
+
 TEST(BricksThreadingThreadTest, TaskAsync) {
 	AutoMonitor<Value> monitor = autonew Value((s32)0);
 